@@ -0,0 +1,59 @@
+###############################################################################
+# Project file for the Game of Life benchmark suite
+#
+#   qmake bench.pro && make && ./life-bench
+#
+# Builds the engines from the parent directory together with life-bench.cpp
+# into a command-line program driven by Google Benchmark, which must be
+# installed where the compiler can find it (libbenchmark-dev on Debian and
+# Ubuntu, google-benchmark on Homebrew). The engines use the CS106 library's
+# Grid, so the library is found the same way conway.pro finds it.
+###############################################################################
+
+TEMPLATE    =   app
+TARGET      =   life-bench
+QT          +=  core gui widgets network
+CONFIG      +=  console c++17 release silent sdk_no_version_check
+CONFIG      -=  app_bundle depend_includepath
+
+win32|win64     { QTP_EXE = qtpaths.exe } else { QTP_EXE = qtpaths }
+USER_DATA_DIR   =   $$system($$[QT_INSTALL_BINS]/$$QTP_EXE --writable-path GenericDataLocation)
+SPL_DIR         =   $${USER_DATA_DIR}/cs106
+
+LIBS            +=  -lbenchmark -lcs106 -lpthread
+QMAKE_LFLAGS    +=  -L$$shell_quote($${SPL_DIR}/lib)
+INCLUDEPATH     +=  $$PWD/.. "$${SPL_DIR}/include"
+DEPENDPATH      +=  $$PWD/..
+
+# time the same code the app runs; CONFIG+=native builds for the host CPU
+native {
+    QMAKE_CXXFLAGS  +=  -march=native
+}
+profiling {
+    DEFINES         +=  LIFE_PROFILING
+}
+opencl {
+    DEFINES         +=  LIFE_HAVE_OPENCL
+    macx {
+        LIBS        +=  -framework OpenCL
+    } else {
+        LIBS        +=  -lOpenCL
+    }
+}
+
+# every engine source from the app, but none of its interactive front end
+SOURCES     +=  life-bench.cpp \
+                ../life-auto.cpp \
+                ../life-engine.cpp \
+                ../life-gpu.cpp \
+                ../life-hashlife.cpp \
+                ../life-mapped-file.cpp \
+                ../life-packed.cpp \
+                ../life-patterns.cpp \
+                ../life-profile.cpp \
+                ../life-reference.cpp \
+                ../life-rules.cpp \
+                ../life-snapshot.cpp \
+                ../life-sparse.cpp \
+                ../life-stepper.cpp \
+                ../life-thread-pool.cpp
@@ -0,0 +1,209 @@
+/**
+ * File: life-bench.cpp
+ * --------------------
+ * Micro-benchmarks the reference rules and every stepping engine on seeded
+ * random boards, from the 40-60 cell boards the app generates up to
+ * 16k x 16k. Every board comes from a fixed seed, so runs on the same
+ * machine are comparable and a slowdown in a kernel shows up as a number.
+ *
+ * Benchmarks are named after what they time, then the board side and the
+ * density in percent, for example BM_EngineStep/packed/4096/35, with
+ * BM_EngineStep/packed/torus/4096/35 the same board wrapped around. Filter them
+ * with --benchmark_filter, for example --benchmark_filter=/1024/ to compare
+ * every engine on the same board.
+ */
+
+#include <benchmark/benchmark.h>
+#include <memory> // for unique_ptr
+#include <string> // for string
+#include <vector> // for vector
+using namespace std;
+
+#include "life-constants.h" // for kMaxAge
+#include "life-engine.h"    // for class LifeEngine, createEngine
+#include "life-hashlife.h"  // for class HashLife
+#include "life-patterns.h"  // for generateRandomGrid
+#include "life-reference.h" // for the reference rules
+
+static const uint64_t kSeed = 106;
+
+// generations stepped per timed iteration; boards are reloaded between
+// iterations so every iteration times the same generations
+static const int kGenerationsPerIteration = 16;
+
+static Grid<int> benchGrid(const benchmark::State &state) {
+  int side = int(state.range(0));
+  return generateRandomGrid(side, side, state.range(1) / 100.0, kSeed);
+}
+
+static void setCellsProcessed(benchmark::State &state, const Grid<int> &grid,
+                              int generationsPerIteration) {
+  state.SetItemsProcessed(state.iterations() * generationsPerIteration *
+                          int64_t(grid.numRows()) * grid.numCols());
+}
+
+/**
+ * Function: BM_ReferenceStep
+ * --------------------------
+ * Times one generation of generateNextGenerationGrid, allocation included,
+ * which is what every tick cost before the engines.
+ */
+static void BM_ReferenceStep(benchmark::State &state) {
+  Grid<int> grid = benchGrid(state);
+  for (auto _ : state) {
+    Grid<int> next = generateNextGenerationGrid(grid);
+    benchmark::DoNotOptimize(next);
+  }
+  setCellsProcessed(state, grid, 1);
+}
+
+/**
+ * Function: BM_CountNeighborCell
+ * ------------------------------
+ * Times the bounds-checked neighbor count over every cell of the board.
+ */
+static void BM_CountNeighborCell(benchmark::State &state) {
+  Grid<int> grid = benchGrid(state);
+  for (auto _ : state) {
+    int total = 0;
+    for (int row = 0; row < grid.numRows(); ++row) {
+      for (int col = 0; col < grid.numCols(); ++col) {
+        total += countNeighborCell(grid, row, col);
+      }
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  setCellsProcessed(state, grid, 1);
+}
+
+/**
+ * Function: BM_IsStableGrid
+ * -------------------------
+ * Times the stability check in its worst case, two equal boards of cells at
+ * kMaxAge, where it has to compare every cell.
+ */
+static void BM_IsStableGrid(benchmark::State &state) {
+  Grid<int> grid = benchGrid(state);
+  for (auto &cell : grid) {
+    cell = cell > 0 ? kMaxAge : 0;
+  }
+  Grid<int> same = grid;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(isStableGrid(grid, same));
+  }
+  setCellsProcessed(state, grid, 1);
+}
+
+/**
+ * Function: BM_EngineStep
+ * -----------------------
+ * Times kGenerationsPerIteration calls to step on the named engine, from
+ * the same starting board each iteration, stability check included. With
+ * torus set the board wraps around, which should cost the same.
+ */
+static void BM_EngineStep(benchmark::State &state, const string &name,
+                          bool torus) {
+  Grid<int> grid = benchGrid(state);
+  unique_ptr<LifeEngine> engine = createEngine(name);
+  engine->setTorus(torus);
+  for (auto _ : state) {
+    state.PauseTiming();
+    engine->load(grid);
+    state.ResumeTiming();
+    for (int i = 0; i < kGenerationsPerIteration; ++i) {
+      benchmark::DoNotOptimize(engine->step());
+    }
+  }
+  setCellsProcessed(state, grid, kGenerationsPerIteration);
+}
+
+/**
+ * Function: BM_HashLifeJump
+ * -------------------------
+ * Times a jump of 2^k generations without age tracking, the case HashLife
+ * exists for, with k the third argument. Items are generations here.
+ */
+static void BM_HashLifeJump(benchmark::State &state) {
+  Grid<int> grid = benchGrid(state);
+  HashLife engine;
+  for (auto _ : state) {
+    state.PauseTiming();
+    engine.load(grid);
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(engine.stepBy(1LL << state.range(2), false));
+  }
+  state.SetItemsProcessed(state.iterations() << state.range(2));
+}
+
+// board sides from the app's random boards up to 16k, and the densities
+// they are filled at, in percent
+static const int kSides[] = {48, 256, 1024, 4096, 16384};
+static const int kDensities[] = {10, 35, 50};
+
+/**
+ * Function: addBoards
+ * -------------------
+ * Registers the benchmark for every board side up to maxSide at every
+ * density. The dense boards cost an int per cell twice over, so the larger
+ * sides are left to the engines that can hold them.
+ */
+static void addBoards(benchmark::internal::Benchmark *bench, int maxSide) {
+  for (int side : kSides) {
+    if (side > maxSide)
+      continue;
+    for (int density : kDensities) {
+      bench->Args({side, density});
+    }
+  }
+  bench->Unit(benchmark::kMicrosecond);
+}
+
+static void registerBenchmarks() {
+  addBoards(benchmark::RegisterBenchmark("BM_ReferenceStep", BM_ReferenceStep),
+            4096);
+  addBoards(benchmark::RegisterBenchmark("BM_CountNeighborCell",
+                                         BM_CountNeighborCell),
+            4096);
+  addBoards(benchmark::RegisterBenchmark("BM_IsStableGrid", BM_IsStableGrid),
+            16384);
+  vector<string> names = {"dense",  "parallel", "packed",
+                          "hashlife", "sparse",   "auto"};
+#ifdef LIFE_HAVE_OPENCL
+  names.push_back("gpu");
+#endif
+  for (const string &name : names) {
+    // the dense engines need 2 GiB at 16k, and HashLife stepping a random
+    // soup one generation at a time is its worst case, so it stops at 1k;
+    // the automatic choice puts a random soup on the packed engine
+    int maxSide =
+        name == "packed" || name == "gpu" || name == "auto" ? 16384
+        : name == "hashlife"                                ? 1024
+                                                            : 4096;
+    addBoards(benchmark::RegisterBenchmark(("BM_EngineStep/" + name).c_str(),
+                                           BM_EngineStep, name, false),
+              maxSide);
+    if (name != "hashlife" && name != "sparse")
+      addBoards(benchmark::RegisterBenchmark(
+                    ("BM_EngineStep/" + name + "/torus").c_str(),
+                    BM_EngineStep, name, true),
+                maxSide);
+  }
+  benchmark::internal::Benchmark *jump =
+      benchmark::RegisterBenchmark("BM_HashLifeJump", BM_HashLifeJump);
+  for (int side : {48, 256, 1024}) {
+    for (int stepLog : {10, 20}) {
+      jump->Args({side, 35, stepLog});
+    }
+  }
+  jump->Unit(benchmark::kMillisecond);
+}
+
+int main(int argc, char **argv) {
+  registerBenchmarks();
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
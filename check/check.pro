@@ -0,0 +1,59 @@
+###############################################################################
+# Project file for the differential check of the engines
+#
+#   qmake check.pro && make check
+#
+# Builds the engines from the parent directory together with life-check.cpp
+# into a command-line program that steps every engine in lockstep with the
+# reference rules, on the patterns in ../res/files and on random boards, and
+# exits with a failure if any of them computes a different board. make check
+# runs it from this directory; run ./life-check by hand to pass it flags,
+# which are described at the top of life-check.cpp. The engines use the
+# CS106 library's Grid, so the library is found the same way conway.pro
+# finds it.
+###############################################################################
+
+TEMPLATE    =   app
+TARGET      =   life-check
+QT          +=  core gui widgets network
+CONFIG      +=  console c++17 release silent sdk_no_version_check testcase
+CONFIG      -=  app_bundle depend_includepath
+
+win32|win64     { QTP_EXE = qtpaths.exe } else { QTP_EXE = qtpaths }
+USER_DATA_DIR   =   $$system($$[QT_INSTALL_BINS]/$$QTP_EXE --writable-path GenericDataLocation)
+SPL_DIR         =   $${USER_DATA_DIR}/cs106
+
+LIBS            +=  -lcs106 -lpthread
+QMAKE_LFLAGS    +=  -L$$shell_quote($${SPL_DIR}/lib)
+INCLUDEPATH     +=  $$PWD/.. "$${SPL_DIR}/include"
+DEPENDPATH      +=  $$PWD/..
+
+# check the same code the app runs; CONFIG+=native builds for the host CPU
+native {
+    QMAKE_CXXFLAGS  +=  -march=native
+}
+opencl {
+    DEFINES         +=  LIFE_HAVE_OPENCL
+    macx {
+        LIBS        +=  -framework OpenCL
+    } else {
+        LIBS        +=  -lOpenCL
+    }
+}
+
+# every engine source from the app, but none of its interactive front end
+SOURCES     +=  life-check.cpp \
+                ../life-auto.cpp \
+                ../life-engine.cpp \
+                ../life-gpu.cpp \
+                ../life-hashlife.cpp \
+                ../life-mapped-file.cpp \
+                ../life-packed.cpp \
+                ../life-patterns.cpp \
+                ../life-profile.cpp \
+                ../life-reference.cpp \
+                ../life-rules.cpp \
+                ../life-snapshot.cpp \
+                ../life-sparse.cpp \
+                ../life-stepper.cpp \
+                ../life-thread-pool.cpp
@@ -0,0 +1,384 @@
+/**
+ * File: life-check.cpp
+ * --------------------
+ * Runs every stepping engine in lockstep with the reference rules of
+ * life-reference.h, on each pattern in res/files and on seeded random
+ * boards, and checks that they agree on every cell, ages included, after
+ * every generation. Each generation the board of every engine is hashed
+ * and the hash compared with the reference's; on a mismatch the first cell
+ * that differs, in row order, is reported with both ages, and that engine
+ * is not stepped any further on that board. The time each engine spends
+ * stepping is measured in the same pass and reported as its speed relative
+ * to the reference.
+ *
+ * HashLife and the sparse engine run on the unbounded plane, where cells
+ * carry on past the edge of the board rather than dying there. The cells on
+ * the board still agree with the reference in the generation a cell first
+ * leaves it, which is checked, but not afterwards, so from then on the
+ * board is reported as having left the board rather than as a divergence.
+ *
+ * The program exits with status 1 if any engine diverged, so make check
+ * fails with it.
+ */
+
+#include <algorithm>  // for sort
+#include <chrono>     // for steady_clock
+#include <cstdint>    // for uint64_t
+#include <filesystem> // for directory_iterator
+#include <iomanip>    // for setw, setprecision
+#include <iostream>   // for cout, cerr
+#include <memory>     // for unique_ptr
+#include <string>     // for string, to_string
+#include <utility>    // for move
+#include <vector>     // for vector
+using namespace std;
+
+#include "error.h"          // for error, ErrorException
+#include "life-constants.h" // for BoardView
+#include "life-engine.h"    // for class LifeEngine, createEngine
+#include "life-patterns.h"  // for readGridFromFile, generateRandomGrid
+#include "life-reference.h" // for the reference rules
+#include "life-rules.h"     // for parseRule
+
+typedef chrono::steady_clock Clock;
+
+/**
+ * Type: CheckOptions
+ * ------------------
+ * What to check, as given on the command line:
+ *
+ *   --patterns DIR     the pattern files to check, ../res/files by default
+ *   --random COUNT     how many random boards to check, 6 by default
+ *   --seed N           the seed of the first random board, 106 by default
+ *   --generations N    generations stepped on each board, 200 by default
+ *   --rule B3/S23      the rule every engine runs, B3/S23 by default
+ *   --engine NAME      check only the named engine rather than all of them
+ */
+struct CheckOptions {
+  string patterns = "../res/files";
+  int randomBoards = 6;
+  uint64_t seed = 106;
+  long long generations = 200;
+  LifeRule rule = kConwayRule;
+  string engine;
+};
+
+// the random boards cycle through these sides, from the app's own random
+// boards up, and these densities
+static const int kRandomSides[] = {48, 256, 1024};
+static const double kRandomDensities[] = {0.35, 0.1, 0.5};
+
+/**
+ * Type: EngineRun
+ * ---------------
+ * One engine being checked on one board.
+ */
+struct EngineRun {
+  string name;
+  unique_ptr<LifeEngine> engine;
+  Clock::duration elapsed = Clock::duration::zero();
+  long long checked = 0;  // generations compared with the reference
+  bool diverged = false;
+  bool leftBoard = false; // a cell left the board of an unbounded engine
+  string detail;          // what went wrong, or where the board was left
+};
+
+/**
+ * Type: CheckTotals
+ * -----------------
+ * Each engine's stepping time and generations, over every board checked,
+ * and how many boards it diverged on.
+ */
+struct CheckTotals {
+  string name;
+  Clock::duration elapsed = Clock::duration::zero();
+  Clock::duration referenceElapsed = Clock::duration::zero();
+  int boards = 0;
+  int divergences = 0;
+};
+
+static long long parseCount(const string &flag, const string &value) {
+  size_t used = 0;
+  long long count = -1;
+  try {
+    count = stoll(value, &used);
+  } catch (...) {
+  }
+  if (value.empty() || used != value.size() || count < 0)
+    error(flag + " expects a non-negative whole number, got \"" + value +
+          "\"");
+  return count;
+}
+
+/**
+ * Function: parseOptions
+ * ----------------------
+ * Reads the flags described at CheckOptions, reporting bad ones through
+ * error.
+ */
+static CheckOptions parseOptions(int argc, char **argv) {
+  CheckOptions options;
+  for (int i = 1; i < argc; ++i) {
+    string flag = argv[i];
+    if (i + 1 >= argc)
+      error("unknown flag or missing value for " + flag);
+    string value = argv[++i];
+    if (flag == "--patterns") {
+      options.patterns = value;
+    } else if (flag == "--random") {
+      options.randomBoards = int(parseCount(flag, value));
+    } else if (flag == "--seed") {
+      options.seed = parseCount(flag, value);
+    } else if (flag == "--generations") {
+      options.generations = parseCount(flag, value);
+    } else if (flag == "--rule") {
+      options.rule = parseRule(value);
+    } else if (flag == "--engine") {
+      if (!createEngine(value))
+        error("the engine " + value + " is not supported");
+      options.engine = value;
+    } else {
+      error("unknown flag " + flag);
+    }
+  }
+  return options;
+}
+
+/**
+ * Function: engineNames
+ * ---------------------
+ * Returns the engines to check: every engine this build has, except the
+ * reference engine, which steps with the rules it would be checked against,
+ * and the distributed engine, which needs mpirun.
+ */
+static vector<string> engineNames(const CheckOptions &options) {
+  if (!options.engine.empty())
+    return {options.engine};
+  vector<string> names = {"dense",  "parallel", "packed",
+                          "hashlife", "sparse",   "auto"};
+#ifdef LIFE_HAVE_OPENCL
+  names.push_back("gpu");
+#endif
+  return names;
+}
+
+/**
+ * Function: hashAges
+ * ------------------
+ * Returns a 64-bit hash of every age on the board, in row order, so two
+ * boards of the same size almost surely hash alike only if they are equal.
+ */
+static uint64_t hashAges(const Grid<int> &grid) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (int row = 0; row < grid.numRows(); ++row) {
+    for (int col = 0; col < grid.numCols(); ++col) {
+      hash = (hash ^ uint64_t(grid[row][col])) * 0x100000001b3ULL;
+    }
+  }
+  return hash;
+}
+
+/**
+ * Function: describeDivergence
+ * ----------------------------
+ * Returns where the engine's board first differs from the reference's, in
+ * row order, with the age each of them has there.
+ */
+static string describeDivergence(const Grid<int> &expected,
+                                 const Grid<int> &actual) {
+  if (expected.numRows() != actual.numRows() ||
+      expected.numCols() != actual.numCols())
+    return "board is " + to_string(actual.numRows()) + " x " +
+           to_string(actual.numCols()) + ", expected " +
+           to_string(expected.numRows()) + " x " +
+           to_string(expected.numCols());
+  for (int row = 0; row < expected.numRows(); ++row) {
+    for (int col = 0; col < expected.numCols(); ++col) {
+      if (expected[row][col] != actual[row][col])
+        return "cell (" + to_string(row) + ", " + to_string(col) +
+               ") has age " + to_string(actual[row][col]) + ", expected " +
+               to_string(expected[row][col]);
+    }
+  }
+  return "hashes differ on equal boards";
+}
+
+/**
+ * Function: boardPopulation
+ * -------------------------
+ * Returns the number of live cells on the engine's board, leaving out any
+ * an unbounded engine has past its edges, as a single block of countBlocks.
+ */
+static long long boardPopulation(const LifeEngine &engine) {
+  BoardView board = {0, 0, 1, 1,
+                     max(max(engine.numRows(), engine.numCols()), 1)};
+  vector<int> counts;
+  engine.countBlocks(board, counts);
+  return counts[0];
+}
+
+/**
+ * Function: checkBoard
+ * --------------------
+ * Steps the reference and every engine from the given board in lockstep,
+ * comparing each engine with the reference after every generation. Prints
+ * a line per engine and adds its times into totals. Returns the number of
+ * engines that diverged.
+ */
+static int checkBoard(const string &label, const Grid<int> &start,
+                      const CheckOptions &options,
+                      vector<CheckTotals> &totals) {
+  vector<EngineRun> runs;
+  for (const string &name : engineNames(options)) {
+    EngineRun run;
+    run.name = name;
+    run.engine = createEngine(name);
+    run.engine->setRule(options.rule);
+    run.engine->load(start);
+    runs.push_back(move(run));
+  }
+
+  Grid<int> reference = start;
+  Clock::duration referenceElapsed = Clock::duration::zero();
+  Grid<int> actual;
+  for (long long gen = 1; gen <= options.generations; ++gen) {
+    Clock::time_point begin = Clock::now();
+    reference = generateNextGenerationGrid(reference, options.rule);
+    referenceElapsed += Clock::now() - begin;
+    uint64_t expectedHash = hashAges(reference);
+
+    for (EngineRun &run : runs) {
+      if (run.diverged || run.leftBoard)
+        continue;
+      begin = Clock::now();
+      run.engine->step();
+      run.elapsed += Clock::now() - begin;
+      run.engine->exportGrid(actual);
+      if (actual.numRows() != reference.numRows() ||
+          actual.numCols() != reference.numCols() ||
+          hashAges(actual) != expectedHash) {
+        run.diverged = true;
+        run.detail = "diverged at generation " + to_string(gen) + ": " +
+                     describeDivergence(reference, actual);
+        continue;
+      }
+      run.checked = gen;
+      if (run.engine->population() != boardPopulation(*run.engine)) {
+        run.leftBoard = true;
+        run.detail = "left the board at generation " + to_string(gen);
+      }
+    }
+  }
+
+  int divergences = 0;
+  for (EngineRun &run : runs) {
+    // the reference time over the same generations the engine was stepped
+    double referenceSeconds =
+        chrono::duration<double>(referenceElapsed).count() *
+        (options.generations == 0 ? 0.0
+                                  : double(run.checked + run.diverged) /
+                                        options.generations);
+    double seconds = chrono::duration<double>(run.elapsed).count();
+    cout << left << setw(20) << label << setw(10) << run.name << right
+         << setw(6) << run.checked << " gens  " << setw(8) << fixed
+         << setprecision(1)
+         << (seconds > 0 ? referenceSeconds / seconds : 0.0) << "x  "
+         << (run.diverged ? "FAIL " : "ok   ") << run.detail << endl;
+    divergences += run.diverged;
+
+    CheckTotals *total = nullptr;
+    for (CheckTotals &t : totals) {
+      if (t.name == run.name)
+        total = &t;
+    }
+    if (!total) {
+      totals.push_back(CheckTotals());
+      total = &totals.back();
+      total->name = run.name;
+    }
+    total->elapsed += run.elapsed;
+    total->referenceElapsed +=
+        chrono::duration_cast<Clock::duration>(
+            chrono::duration<double>(referenceSeconds));
+    total->boards++;
+    total->divergences += run.diverged;
+  }
+  return divergences;
+}
+
+/**
+ * Function: randomBoard
+ * ---------------------
+ * Returns a board of the given side with a random soup in the middle half
+ * of it and a dead margin a quarter of the side wide around that, so the
+ * engines on the unbounded plane are checked for a while before the soup
+ * reaches the edge.
+ */
+static Grid<int> randomBoard(int side, double density, uint64_t seed) {
+  Grid<int> soup = generateRandomGrid(side / 2, side / 2, density, seed);
+  Grid<int> board(side, side, 0);
+  for (int row = 0; row < soup.numRows(); ++row) {
+    for (int col = 0; col < soup.numCols(); ++col) {
+      board[side / 4 + row][side / 4 + col] = soup[row][col];
+    }
+  }
+  return board;
+}
+
+/**
+ * Function: patternFiles
+ * ----------------------
+ * Returns the paths of the files in the named directory, sorted by name.
+ */
+static vector<string> patternFiles(const string &dir) {
+  vector<string> files;
+  error_code ec;
+  for (const auto &entry : filesystem::directory_iterator(dir, ec)) {
+    if (entry.is_regular_file())
+      files.push_back(entry.path().string());
+  }
+  if (ec)
+    error("cannot list the patterns in " + dir + ": " + ec.message());
+  sort(files.begin(), files.end());
+  return files;
+}
+
+int main(int argc, char **argv) {
+  try {
+    CheckOptions options = parseOptions(argc, argv);
+    cout << "rule " << ruleString(options.rule) << ", "
+         << options.generations
+         << " generations a board, speed relative to the reference" << endl;
+    vector<CheckTotals> totals;
+    int divergences = 0;
+    for (const string &file : patternFiles(options.patterns)) {
+      string name = filesystem::path(file).filename().string();
+      divergences += checkBoard(name, readGridFromFile(file), options, totals);
+    }
+    for (int i = 0; i < options.randomBoards; ++i) {
+      int side = kRandomSides[i % 3];
+      double density = kRandomDensities[i / 3 % 3];
+      uint64_t seed = options.seed + i;
+      string label = "random " + to_string(side) + "/" +
+                     to_string(int(density * 100)) + "/" + to_string(seed);
+      divergences += checkBoard(label, randomBoard(side, density, seed),
+                                options, totals);
+    }
+
+    cout << endl;
+    for (const CheckTotals &total : totals) {
+      double seconds = chrono::duration<double>(total.elapsed).count();
+      double referenceSeconds =
+          chrono::duration<double>(total.referenceElapsed).count();
+      cout << left << setw(10) << total.name << right << setw(8) << fixed
+           << setprecision(1)
+           << (seconds > 0 ? referenceSeconds / seconds : 0.0)
+           << "x the reference, diverged on " << total.divergences << " of "
+           << total.boards << " boards" << endl;
+    }
+    return divergences == 0 ? 0 : 1;
+  } catch (const ErrorException &ex) {
+    cerr << "life-check: " << ex.getMessage() << endl;
+    return 2;
+  }
+}
@@ -80,6 +80,12 @@ HEADERS         *=  ""
 SOURCES         *=  $$files(*.cpp, true)
 HEADERS         *=  $$files(*.h, true)
 
+# The benchmark suite under bench/ and the differential check of the engines
+# under check/ have their own mains and their own project files
+# (bench/bench.pro, check/check.pro), so keep them out of the app
+SOURCES         -=  $$files(bench/*.cpp, true) $$files(check/*.cpp, true)
+HEADERS         -=  $$files(bench/*.h, true) $$files(check/*.h, true)
+
 # Gather resource files (image/sound/etc) from res dir, list under "Other files"
 OTHER_FILES     *=  $$files(res/*, true)
 # Gather text files from root dir or anywhere recursively
@@ -99,6 +105,38 @@ CONFIG          +=  sdk_no_version_check   # removes spurious warnings on Mac OS
 # rather than special case
 CONFIG          +=  c++17
 
+# opt-in: qmake CONFIG+=native builds for the host CPU, which lets the packed
+# engine's vector kernel use AVX2 (x86) or NEON (ARM) instructions
+native {
+    QMAKE_CXXFLAGS  +=  -march=native
+}
+
+# opt-in: qmake CONFIG+=profiling compiles in the phase timers and counters of
+# life-profile.h, which headless mode reports with --profile FILE
+profiling {
+    DEFINES         +=  LIFE_PROFILING
+}
+
+# opt-in: qmake CONFIG+=opencl builds the gpu engine of life-gpu.h, which
+# needs the OpenCL headers and library (an ICD loader and a driver)
+opencl {
+    DEFINES         +=  LIFE_HAVE_OPENCL
+    macx {
+        LIBS        +=  -framework OpenCL
+    } else {
+        LIBS        +=  -lOpenCL
+    }
+}
+
+# opt-in: qmake CONFIG+=mpi builds the distributed engine of life-mpi.h with
+# the MPI compiler wrappers; run it under mpirun, e.g.
+#   mpirun -n 4 ./conway --headless --engine mpi --random 65536x65536
+mpi {
+    DEFINES         +=  LIFE_HAVE_MPI
+    QMAKE_CXX       =   mpicxx
+    QMAKE_LINK      =   mpicxx
+}
+
 # WARN_ON has -Wall -Wextra, add/remove a few specific warnings
 QMAKE_CXXFLAGS_WARN_ON      +=  -Werror=return-type
 QMAKE_CXXFLAGS_WARN_ON      +=  -Werror=uninitialized
@@ -0,0 +1,178 @@
+/**
+ * File: life-auto.cpp
+ * -------------------
+ * Implements the engine that picks an engine. A board moves from one engine
+ * to the other as a snapshot, which both of them load a word at a time.
+ */
+
+#include <algorithm> // for max
+#include <cstdint>   // for uint64_t
+#include <utility>   // for move
+using namespace std;
+
+#include "life-auto.h"
+#include "life-packed.h" // for class PackedLife
+#include "life-sparse.h" // for class SparseLife
+
+AutoLife::AutoLife() : inner(new PackedLife), sparse(false), torus(false) {}
+
+void AutoLife::load(const Grid<int> &grid) {
+  startPacked();
+  inner->load(grid);
+  choose();
+}
+
+void AutoLife::loadPattern(const PackedPattern &pattern) {
+  startPacked();
+  inner->loadPattern(pattern);
+  choose();
+}
+
+void AutoLife::loadSnapshot(const SnapshotView &snapshot) {
+  startPacked();
+  inner->loadSnapshot(snapshot);
+  choose();
+}
+
+/**
+ * Function: startPacked
+ * ---------------------
+ * Replaces the engine with an empty packed engine, before a board is
+ * loaded.
+ */
+void AutoLife::startPacked() {
+  inner.reset(new PackedLife);
+  inner->setRule(lifeRule);
+  inner->setTorus(torus);
+  sparse = false;
+}
+
+/**
+ * Function: choose
+ * ----------------
+ * Moves a board just loaded into the packed engine on to the sparse engine
+ * if it is large and mostly empty, counting which tiles hold live cells
+ * without unpacking them.
+ */
+void AutoLife::choose() {
+  generationCount = inner->generation();
+  changes.clear();
+  int rows = inner->numRows();
+  int cols = inner->numCols();
+  if (torus || (long long)rows * cols < kSparseMinCells)
+    return;
+  BoardView tiles = {0, 0, (rows + 63) / 64, (cols + 63) / 64, 64};
+  vector<int> counts;
+  inner->countBlocks(tiles, counts);
+  long long occupied = 0;
+  for (int count : counts) {
+    occupied += count > 0;
+  }
+  if (occupied * kSparseTileRatio <= (long long)counts.size()) {
+    moveTo(unique_ptr<LifeEngine>(new SparseLife));
+    sparse = true;
+  }
+}
+
+/**
+ * Function: moveTo
+ * ----------------
+ * Makes the given engine the one stepped, carrying the current board over
+ * to it, ages and generation count included, along with the rule and the
+ * border.
+ */
+void AutoLife::moveTo(unique_ptr<LifeEngine> engine) {
+  SnapshotBuffer buffer;
+  buffer.rows = inner->numRows();
+  buffer.cols = inner->numCols();
+  buffer.wordsPerRow = (buffer.cols + 63) / 64;
+  buffer.generation = inner->generation();
+  size_t planeWords = size_t(buffer.rows) * size_t(buffer.wordsPerRow);
+  vector<uint64_t> words((1 + kSnapshotAgePlanes) * planeWords, 0);
+  buffer.live = words.data();
+  for (int b = 0; b < kSnapshotAgePlanes; ++b) {
+    buffer.ages[b] = words.data() + (b + 1) * planeWords;
+  }
+  inner->exportSnapshot(buffer);
+
+  SnapshotView view;
+  view.rows = buffer.rows;
+  view.cols = buffer.cols;
+  view.wordsPerRow = buffer.wordsPerRow;
+  view.generation = buffer.generation;
+  view.live = buffer.live;
+  for (int b = 0; b < kSnapshotAgePlanes; ++b) {
+    view.ages[b] = buffer.ages[b];
+  }
+  engine->setRule(lifeRule);
+  engine->setTorus(torus);
+  engine->loadSnapshot(view);
+  inner = move(engine);
+}
+
+/**
+ * Function: boardPopulation
+ * -------------------------
+ * Returns the number of live cells on the board, leaving out any the
+ * sparse engine keeps past its edges, as a single block of countBlocks.
+ */
+long long AutoLife::boardPopulation() const {
+  BoardView board = {0, 0, 1, 1, max(max(numRows(), numCols()), 1)};
+  vector<int> counts;
+  inner->countBlocks(board, counts);
+  return counts[0];
+}
+
+bool AutoLife::step() {
+  // on the sparse engine the change list tells whether the board's own
+  // cells changed, should any past the edges have changed as well
+  inner->setRecordChanges(recordChanges || sparse);
+  bool changed = inner->step();
+  generationCount = inner->generation();
+  if (recordChanges)
+    changes = inner->changedCells();
+  if (sparse && inner->population() != boardPopulation()) {
+    // a cell was born past the edge, which a dead border never lets happen;
+    // every cell on the board is right, so the packed engine can take over
+    // from them
+    changed = !inner->changedCells().empty();
+    moveTo(unique_ptr<LifeEngine>(new PackedLife));
+    sparse = false;
+  }
+  return changed;
+}
+
+bool AutoLife::stepBy(long long generations) {
+  for (long long i = 0; i < generations && sparse; ++i) {
+    if (!step()) {
+      // nothing past the edges changes on a stable board either, so the
+      // sparse engine can pass the rest of the generations by itself
+      inner->stepBy(generations - i - 1);
+      generationCount = inner->generation();
+      return false;
+    }
+    if (!sparse)
+      generations -= i + 1; // the rest go to the packed engine
+  }
+  if (sparse)
+    return true;
+  bool changed = inner->stepBy(generations);
+  generationCount = inner->generation();
+  return changed;
+}
+
+void AutoLife::clear() { inner->clear(); }
+
+bool AutoLife::setTorus(bool torus) {
+  if (torus && sparse) {
+    moveTo(unique_ptr<LifeEngine>(new PackedLife));
+    sparse = false;
+  }
+  this->torus = torus;
+  return inner->setTorus(torus);
+}
+
+void AutoLife::setRule(const LifeRule &rule) {
+  LifeEngine::setRule(rule);
+  inner->setRule(rule);
+}
@@ -0,0 +1,105 @@
+/**
+ * File: life-auto.h
+ * -----------------
+ * Defines an engine that hands the board to whichever of the other engines
+ * suits it best, so the main module and the headless mode can leave the
+ * choice to the board. Each board loaded goes to the packed engine, which
+ * is the fastest wherever much of the board is alive, unless the board is
+ * large and almost all of it is empty, in which case it goes to the sparse
+ * engine, which only steps the parts that are alive.
+ *
+ * The sparse engine runs on the unbounded plane, while the board here has
+ * a dead border like the packed engine's. The two only disagree once a
+ * cell is born past the board's edge, which this engine checks for after
+ * every step: the cells on the board are still right then, so it hands them
+ * back to the packed engine and carries on.
+ */
+
+#pragma once
+#include "grid.h"        // for Grid
+#include "life-engine.h" // for LifeEngine
+#include <memory>        // for std::unique_ptr
+#include <vector>        // for std::vector
+
+class AutoLife : public LifeEngine {
+public:
+  /**
+   * Constructs an empty engine, on the packed engine until the first load.
+   */
+  AutoLife();
+
+  /**
+   * These load the board into the packed engine and then, if the board is
+   * large enough and few enough of its tiles hold live cells, move it to
+   * the sparse engine.
+   */
+  void load(const Grid<int> &grid) override;
+  void loadPattern(const PackedPattern &pattern) override;
+  void loadSnapshot(const SnapshotView &snapshot) override;
+
+  /**
+   * Steps the chosen engine, and moves the board back to the packed engine
+   * if the sparse engine grew cells past the board's edge.
+   */
+  bool step() override;
+
+  /**
+   * Skips ahead as the packed engine does once it is chosen; on the sparse
+   * engine every generation is stepped and checked.
+   */
+  bool stepBy(long long generations) override;
+  void clear() override;
+
+  int numRows() const override { return inner->numRows(); }
+  int numCols() const override { return inner->numCols(); }
+
+  /**
+   * A board that wraps around always runs on the packed engine.
+   */
+  bool setTorus(bool torus) override;
+  void setRule(const LifeRule &rule) override;
+
+  int ageAt(int row, int col) const override {
+    return inner->ageAt(row, col);
+  }
+  void exportGrid(Grid<int> &grid) const override { inner->exportGrid(grid); }
+  void exportPattern(PackedPattern &pattern) const override {
+    inner->exportPattern(pattern);
+  }
+  void exportSnapshot(SnapshotBuffer &snapshot) const override {
+    inner->exportSnapshot(snapshot);
+  }
+  long long population() const override { return inner->population(); }
+  void countBlocks(const BoardView &view,
+                   std::vector<int> &counts) const override {
+    inner->countBlocks(view, counts);
+  }
+  void exportView(const BoardView &view,
+                  std::vector<uint8_t> &ages) const override {
+    inner->exportView(view, ages);
+  }
+
+  /**
+   * Returns the name createEngine knows the chosen engine by.
+   */
+  const char *engineName() const { return sparse ? "sparse" : "packed"; }
+
+  // boards with fewer cells than this always run on the packed engine
+  static const long long kSparseMinCells = 1LL << 22;
+  // and larger ones run on the sparse engine while no more than one in
+  // this many of their 64 x 64 tiles holds a live cell
+  static const int kSparseTileRatio = 8;
+
+private:
+  std::unique_ptr<LifeEngine> inner;
+  bool sparse; // whether inner is the sparse engine
+  bool torus;
+
+  void startPacked();
+  void choose();
+  void moveTo(std::unique_ptr<LifeEngine> engine);
+  long long boardPopulation() const;
+
+  AutoLife(const AutoLife &original);
+  void operator=(const AutoLife &rhs) const;
+};
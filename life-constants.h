@@ -1,7 +1,7 @@
 /**
  * File: life-constants.h
  * ----------------------
- * Defines those constants which are shared by both the
+ * Defines those constants and types which are shared by both the
  * life-graphics module and the main life module.
  */
 
@@ -16,3 +16,40 @@
  */
 const int kMaxAge = 12;
 
+
+/**
+ * Type: CellUpdate
+ * ----------------
+ * A cell whose age changed from one generation to the next, along with its
+ * new age. The engines report these so the display can redraw only the
+ * cells that changed.
+ */
+struct CellUpdate {
+  int row;
+  int col;
+  int age;
+};
+
+/**
+ * Type: BoardView
+ * ---------------
+ * The part of the board the display shows: rows x cols blocks of
+ * blockSize x blockSize cells, the first with its upper left cell at (top,
+ * left). With a blockSize of 1 every cell is shown on its own; larger
+ * blocks are zoomed-out views, shaded by how many of their cells are alive,
+ * which the engines count with countBlocks. Blocks past the edge of the
+ * board only count the cells on it.
+ */
+struct BoardView {
+  int top;
+  int left;
+  int rows;
+  int cols;
+  int blockSize;
+
+  bool operator==(const BoardView &other) const {
+    return top == other.top && left == other.left && rows == other.rows &&
+           cols == other.cols && blockSize == other.blockSize;
+  }
+  bool operator!=(const BoardView &other) const { return !(*this == other); }
+};
@@ -0,0 +1,72 @@
+/**
+ * File: life-cycle.cpp
+ * --------------------
+ * Implements the cycle detector. Each cell's Zobrist key is a strong 64-bit
+ * mix of its index rather than an entry in a table, so the keys cost no
+ * memory and the hash of the board is the XOR of the keys of its live cells.
+ */
+
+#include <algorithm> // for min
+using namespace std;
+
+#include "life-cycle.h"
+#include "life-profile.h" // for LIFE_PROFILE_SCOPE
+
+/**
+ * Function: cellKey
+ * -----------------
+ * Returns the Zobrist key of the cell with the given index, by the splitmix64
+ * finalizer.
+ */
+static uint64_t cellKey(uint64_t index) {
+  uint64_t z = index + 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+CycleDetector::CycleDetector()
+    : cols(0), currentHash(0), generation(0), foundPeriod(0), history{} {}
+
+void CycleDetector::toggle(int index) {
+  alive[index] ^= 1;
+  currentHash ^= cellKey(uint64_t(index));
+}
+
+void CycleDetector::reset(const LifeEngine &engine) {
+  LIFE_PROFILE_SCOPE(kPhaseCycleDetect);
+  cols = engine.numCols();
+  alive.assign(size_t(engine.numRows()) * cols, 0);
+  currentHash = 0;
+  for (int row = 0; row < engine.numRows(); ++row) {
+    for (int col = 0; col < cols; ++col) {
+      if (engine.ageAt(row, col) > 0)
+        toggle(row * cols + col);
+    }
+  }
+  generation = 0;
+  foundPeriod = 0;
+  history[0] = currentHash;
+}
+
+int CycleDetector::update(const vector<CellUpdate> &changes) {
+  LIFE_PROFILE_SCOPE(kPhaseCycleDetect);
+  for (const CellUpdate &change : changes) {
+    int index = change.row * cols + change.col;
+    if ((change.age > 0) != (alive[index] != 0))
+      toggle(index);
+  }
+  ++generation;
+
+  // the most recent match is the shortest period
+  foundPeriod = 0;
+  int depth = int(min(generation, (long long)kMaxPeriod));
+  for (int lag = 1; lag <= depth; ++lag) {
+    if (history[(generation - lag) % kMaxPeriod] == currentHash) {
+      foundPeriod = lag;
+      break;
+    }
+  }
+  history[generation % kMaxPeriod] = currentHash;
+  return foundPeriod;
+}
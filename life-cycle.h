@@ -0,0 +1,59 @@
+/**
+ * File: life-cycle.h
+ * ------------------
+ * Defines a detector for boards that have fallen into a cycle. It keeps a
+ * 64-bit Zobrist-style hash of which cells are alive, updated from each
+ * step's change list, and a short history of past hashes, so finding the
+ * period costs the same every generation however large the board is.
+ *
+ * Only the board is hashed, so for HashLife, whose cells can leave the
+ * board, a cycle means the board repeats even if the plane does not.
+ */
+
+#pragma once
+#include "life-constants.h" // for CellUpdate
+#include "life-engine.h"    // for LifeEngine
+#include <cstdint>          // for uint64_t, uint8_t
+#include <vector>           // for std::vector
+
+class CycleDetector {
+public:
+  CycleDetector();
+
+  /**
+   * Hashes the engine's whole board and forgets the history. Call this after
+   * loading a board and after any step whose change list was not recorded,
+   * such as a multi-generation jump.
+   */
+  void reset(const LifeEngine &engine);
+
+  /**
+   * Accounts for one generation from its change list and returns the
+   * shortest period, up to kMaxPeriod, after which the live cells repeat,
+   * or 0 if they have not repeated yet. A period of 1 means the live cells
+   * have stopped changing, though their ages may still be catching up.
+   */
+  int update(const std::vector<CellUpdate> &changes);
+
+  /**
+   * Returns the period found by the last update, 0 if none.
+   */
+  int period() const { return foundPeriod; }
+
+  /**
+   * Returns the hash of the current live cells.
+   */
+  uint64_t hash() const { return currentHash; }
+
+  static const int kMaxPeriod = 64; // longest period the history can show
+
+private:
+  int cols;
+  uint64_t currentHash;
+  long long generation; // generations since the last reset
+  int foundPeriod;
+  std::vector<uint8_t> alive;    // liveness the hash was built from
+  uint64_t history[kMaxPeriod];  // past hashes, by generation % kMaxPeriod
+
+  void toggle(int index);
+};
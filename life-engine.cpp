@@ -0,0 +1,151 @@
+/**
+ * File: life-engine.cpp
+ * ---------------------
+ * Implements the parts of the engine interface shared by every engine, along
+ * with the factory that maps engine names to implementations.
+ */
+
+#include <algorithm> // for max, min
+#include <thread>    // for thread::hardware_concurrency
+using namespace std;
+
+#include "life-auto.h"      // for class AutoLife
+#include "life-engine.h"
+#include "life-gpu.h"       // for class GpuLife
+#include "life-hashlife.h"  // for class HashLife
+#include "life-mpi.h"       // for class MpiLife
+#include "life-packed.h"    // for class PackedLife
+#include "life-reference.h" // for class ReferenceLife
+#include "life-sparse.h"    // for class SparseLife
+#include "life-stepper.h"   // for class LifeStepper
+
+void LifeEngine::exportGrid(Grid<int> &grid) const {
+  grid.resize(numRows(), numCols());
+  for (int row = 0; row < numRows(); ++row) {
+    for (int col = 0; col < numCols(); ++col) {
+      grid[row][col] = ageAt(row, col);
+    }
+  }
+}
+
+void LifeEngine::exportPattern(PackedPattern &pattern) const {
+  pattern.rows = numRows();
+  pattern.cols = numCols();
+  pattern.wordsPerRow = (pattern.cols + 63) / 64;
+  pattern.bits.assign(size_t(pattern.rows) * pattern.wordsPerRow, 0);
+  for (int row = 0; row < pattern.rows; ++row) {
+    uint64_t *words = pattern.bits.data() + size_t(row) * pattern.wordsPerRow;
+    for (int col = 0; col < pattern.cols; ++col) {
+      words[col / 64] |= uint64_t(ageAt(row, col) > 0) << (col % 64);
+    }
+  }
+}
+
+long long LifeEngine::population() const {
+  long long count = 0;
+  for (int row = 0; row < numRows(); ++row) {
+    for (int col = 0; col < numCols(); ++col) {
+      count += ageAt(row, col) > 0;
+    }
+  }
+  return count;
+}
+
+void LifeEngine::countBlocks(const BoardView &view,
+                             vector<int> &counts) const {
+  counts.assign(size_t(view.rows) * view.cols, 0);
+  int bottom = min(view.top + view.rows * view.blockSize, numRows());
+  int right = min(view.left + view.cols * view.blockSize, numCols());
+  for (int row = max(view.top, 0); row < bottom; ++row) {
+    int *blockRow = counts.data() +
+                    size_t((row - view.top) / view.blockSize) * view.cols;
+    for (int col = max(view.left, 0); col < right; ++col) {
+      blockRow[(col - view.left) / view.blockSize] += ageAt(row, col) > 0;
+    }
+  }
+}
+
+void LifeEngine::exportView(const BoardView &view,
+                            vector<uint8_t> &ages) const {
+  ages.assign(size_t(view.rows) * view.cols, 0);
+  int bottom = min(view.top + view.rows, numRows());
+  int right = min(view.left + view.cols, numCols());
+  for (int row = max(view.top, 0); row < bottom; ++row) {
+    uint8_t *rowAges = ages.data() + size_t(row - view.top) * view.cols;
+    for (int col = max(view.left, 0); col < right; ++col) {
+      rowAges[col - view.left] = uint8_t(ageAt(row, col));
+    }
+  }
+}
+
+void LifeEngine::loadSnapshot(const SnapshotView &snapshot) {
+  Grid<int> grid(snapshot.rows, snapshot.cols);
+  for (int row = 0; row < snapshot.rows; ++row) {
+    for (int col = 0; col < snapshot.cols; ++col) {
+      grid[row][col] = snapshot.ageAt(row, col);
+    }
+  }
+  load(grid);
+  generationCount = snapshot.generation;
+}
+
+void LifeEngine::exportSnapshot(SnapshotBuffer &snapshot) const {
+  for (int row = 0; row < snapshot.rows; ++row) {
+    size_t rowStart = size_t(row) * snapshot.wordsPerRow;
+    for (int col = 0; col < snapshot.cols; ++col) {
+      int age = ageAt(row, col);
+      uint64_t bit = uint64_t(1) << (col % 64);
+      if (age > 0)
+        snapshot.live[rowStart + col / 64] |= bit;
+      for (int b = 0; b < kSnapshotAgePlanes; ++b) {
+        if ((age >> b) & 1)
+          snapshot.ages[b][rowStart + col / 64] |= bit;
+      }
+    }
+  }
+}
+
+void LifeEngine::loadPattern(const PackedPattern &pattern) {
+  load(unpackPattern(pattern));
+}
+
+bool LifeEngine::stepBy(long long generations) {
+  for (long long i = 0; i < generations; ++i) {
+    if (!step()) {
+      // a stable board stays stable, so the rest of the generations pass
+      // without needing to be stepped
+      generationCount += generations - i - 1;
+      return false;
+    }
+  }
+  return true;
+}
+
+unique_ptr<LifeEngine> createEngine(const string &name) {
+  if (name.empty() || name == "dense") {
+    return unique_ptr<LifeEngine>(new LifeStepper);
+  } else if (name == "parallel") {
+    LifeStepper *stepper = new LifeStepper;
+    stepper->setThreadCount(max(int(thread::hardware_concurrency()), 1));
+    return unique_ptr<LifeEngine>(stepper);
+  } else if (name == "packed") {
+    return unique_ptr<LifeEngine>(new PackedLife);
+  } else if (name == "hashlife") {
+    return unique_ptr<LifeEngine>(new HashLife);
+  } else if (name == "sparse") {
+    return unique_ptr<LifeEngine>(new SparseLife);
+  } else if (name == "reference") {
+    return unique_ptr<LifeEngine>(new ReferenceLife);
+  } else if (name == "auto") {
+    return unique_ptr<LifeEngine>(new AutoLife);
+#ifdef LIFE_HAVE_OPENCL
+  } else if (name == "gpu") {
+    return unique_ptr<LifeEngine>(new GpuLife);
+#endif
+#ifdef LIFE_HAVE_MPI
+  } else if (name == "mpi") {
+    return unique_ptr<LifeEngine>(new MpiLife);
+#endif
+  }
+  return nullptr;
+}
@@ -0,0 +1,176 @@
+/**
+ * File: life-engine.h
+ * -------------------
+ * Defines the interface every Game of Life stepping engine implements, so
+ * the main module can drive any of them without knowing how the board is
+ * stored.
+ */
+
+#pragma once
+#include "grid.h"           // for Grid
+#include "life-constants.h" // for CellUpdate, BoardView
+#include "life-patterns.h"  // for PackedPattern
+#include "life-rules.h"     // for LifeRule
+#include "life-snapshot.h"  // for SnapshotView, SnapshotBuffer
+#include <cstdint>          // for uint8_t
+#include <memory>           // for std::unique_ptr
+#include <string>           // for std::string
+#include <vector>           // for std::vector
+
+class LifeEngine {
+public:
+  LifeEngine()
+      : recordChanges(false), generationCount(0), lifeRule(kConwayRule) {}
+  virtual ~LifeEngine() {}
+
+  /**
+   * Replaces the board with the given grid of ages.
+   */
+  virtual void load(const Grid<int> &grid) = 0;
+
+  /**
+   * Replaces the board with the given packed pattern, with every live cell
+   * at age 1. Engines that can take the bits as they are override this; by
+   * default the pattern is unpacked into a grid and loaded.
+   */
+  virtual void loadPattern(const PackedPattern &pattern);
+
+  /**
+   * Replaces the board with the one in the snapshot, ages and generation
+   * count included. By default the snapshot is expanded into a grid and
+   * loaded.
+   */
+  virtual void loadSnapshot(const SnapshotView &snapshot);
+
+  /**
+   * Advances the board by one generation. Returns true if the new generation
+   * differs from the previous one, false if the board is stable.
+   */
+  virtual bool step() = 0;
+
+  /**
+   * Advances the board by the given number of generations. Returns false if
+   * the board is stable afterwards. Engines that can skip ahead override
+   * this; by default it steps one generation at a time and stops early once
+   * the board is stable.
+   */
+  virtual bool stepBy(long long generations);
+
+  /**
+   * Kills every cell on the board, keeping its dimensions.
+   */
+  virtual void clear() = 0;
+
+  virtual int numRows() const = 0;
+  virtual int numCols() const = 0;
+
+  /**
+   * Picks what lies past the edges of the board: dead cells, the default,
+   * or with torus set, the cells on the opposite edge, so the board wraps
+   * around in both directions. Returns false if the engine has no such
+   * choice, as the engines on the unbounded plane do not; by default a dead
+   * border is all an engine supports.
+   */
+  virtual bool setTorus(bool torus) { return !torus; }
+
+  /**
+   * Switches the engine to the given rule from the next step on. Every
+   * engine starts out running B3/S23. Engines with a kernel per rule
+   * override this to pick the kernel, and call up to it.
+   */
+  virtual void setRule(const LifeRule &rule) { lifeRule = rule; }
+  const LifeRule &rule() const { return lifeRule; }
+
+  /**
+   * Returns the age of the cell at the given row and column, 0 if the cell
+   * is empty. Ages are capped at kMaxAge.
+   */
+  virtual int ageAt(int row, int col) const = 0;
+
+  /**
+   * Copies the current generation out into the given grid, resizing it to
+   * match the board.
+   */
+  virtual void exportGrid(Grid<int> &grid) const;
+
+  /**
+   * Copies the liveness of the current generation out into the given
+   * pattern, replacing its contents.
+   */
+  virtual void exportPattern(PackedPattern &pattern) const;
+
+  /**
+   * Fills the given buffer, already sized to the board and zeroed, with the
+   * liveness and ages of the current generation.
+   */
+  virtual void exportSnapshot(SnapshotBuffer &snapshot) const;
+
+  /**
+   * Returns the number of live cells. The engines on the unbounded plane
+   * count every cell, including those that have left the board. By default
+   * the board is scanned with ageAt; the engines here override it with a
+   * count they keep up as they step.
+   */
+  virtual long long population() const;
+
+  /**
+   * Fills counts with the number of live cells in each block of the view,
+   * row by row, so a zoomed-out display can shade blocks without reading
+   * every cell. By default each cell is asked for with ageAt; the engines
+   * that store liveness as bits count it a word at a time, the GPU engine
+   * counts on the device, the dense engine skips empty tiles, and HashLife
+   * adds up whole quadtree nodes.
+   */
+  virtual void countBlocks(const BoardView &view,
+                           std::vector<int> &counts) const;
+
+  /**
+   * Fills ages with the age of every cell of a view of single cells, row
+   * by row, with 0 for the cells off the board, so a display can copy out
+   * the part of the board it shows in one call. By default each cell is
+   * asked for with ageAt; the engines that store liveness as bits skip
+   * empty words whole.
+   */
+  virtual void exportView(const BoardView &view,
+                          std::vector<uint8_t> &ages) const;
+
+  /**
+   * Returns the number of generations stepped since the board was loaded.
+   */
+  long long generation() const { return generationCount; }
+
+  /**
+   * Turns the change list on or off. While it is on, every call to step
+   * records the cells whose age changed, which changedCells returns. It is
+   * off by default, since building it costs time proportional to the number
+   * of changes.
+   */
+  void setRecordChanges(bool record) { recordChanges = record; }
+
+  /**
+   * Returns the cells whose age changed in the last call to step, in no
+   * particular order. Only meaningful while recording is on, and only for a
+   * single step: after stepBy or load the whole board should be redrawn.
+   */
+  const std::vector<CellUpdate> &changedCells() const { return changes; }
+
+protected:
+  bool recordChanges;
+  std::vector<CellUpdate> changes;
+  long long generationCount; // engines count every generation they step
+  LifeRule lifeRule;
+};
+
+/**
+ * Function: createEngine
+ * ----------------------
+ * Returns a new engine for the given name, or nullptr if no engine has that
+ * name. The engines are "dense", "parallel" (the dense engine stepping bands
+ * of rows on one thread per core), "packed", "hashlife", "sparse" and
+ * "reference" (the original grid-at-a-time rules of life-reference.h), in
+ * builds with OpenCL (see life-gpu.h) "gpu" and in builds with MPI (see
+ * life-mpi.h) "mpi". "auto" picks one of these for each board it loads,
+ * from the board's size and how much of it is alive, see life-auto.h. The
+ * empty string selects the default engine.
+ */
+std::unique_ptr<LifeEngine> createEngine(const std::string &name);
@@ -0,0 +1,102 @@
+/**
+ * File: life-ensemble.cpp
+ * -----------------------
+ * Implements ensemble runs. Every run has its own engine and cycle detector
+ * and writes only its own slot of the results, so the runs share nothing
+ * but the pool's task counter. A thread that finishes a short-lived board
+ * takes the next run at once, which keeps the threads busy however unevenly
+ * the boards' lifetimes fall.
+ */
+
+#include <fstream> // for ofstream
+#include <memory>  // for unique_ptr
+using namespace std;
+
+#include "error.h" // for error
+
+#include "life-cycle.h"       // for class CycleDetector
+#include "life-engine.h"      // for class LifeEngine, createEngine
+#include "life-ensemble.h"
+#include "life-patterns.h"    // for counterRandom, generateRandomPattern
+#include "life-thread-pool.h" // for class LifeThreadPool
+
+uint64_t ensembleSeed(uint64_t baseSeed, int run) {
+  return counterRandom(baseSeed, uint64_t(run));
+}
+
+/**
+ * Function: runOne
+ * ----------------
+ * Evolves one board until its live cells repeat or the generation limit is
+ * reached.
+ */
+static EnsembleRun runOne(const EnsembleSpec &spec, uint64_t seed) {
+  unique_ptr<LifeEngine> engine = createEngine(spec.engine);
+  engine->setRule(spec.rule);
+  engine->setTorus(spec.torus);
+  engine->setRecordChanges(true);
+  engine->loadPattern(
+      generateRandomPattern(spec.rows, spec.cols, spec.density, seed));
+  CycleDetector cycles;
+  cycles.reset(*engine);
+
+  EnsembleRun run = {seed, engine->population(), false, 0, 0, 0};
+  for (long long generation = 1; generation <= spec.generations;
+       ++generation) {
+    engine->step();
+    int period = cycles.update(engine->changedCells());
+    if (period > 0) {
+      // the detector reports the first repeat, so the cycle began exactly
+      // one period earlier
+      run.settled = true;
+      run.settledAt = generation - period;
+      run.period = period;
+      break;
+    }
+    run.settledAt = generation;
+  }
+  run.finalPopulation = engine->population();
+  return run;
+}
+
+vector<EnsembleRun> runEnsemble(const EnsembleSpec &spec, int numRuns,
+                                int numThreads) {
+  if (spec.rows <= 0 || spec.cols <= 0)
+    error("an ensemble needs boards with positive dimensions");
+  // the runs already take a thread each, and a parallel engine in every
+  // run would start a pool of a thread per core on top of them
+  if (spec.engine == "parallel")
+    error("an ensemble runs one board per thread, so use the dense engine "
+          "rather than the parallel one");
+  unique_ptr<LifeEngine> probe = createEngine(spec.engine);
+  if (!probe)
+    error("the engine " + spec.engine + " is not supported");
+  if (spec.torus && !probe->setTorus(true))
+    error("the engine " + spec.engine + " can not wrap around");
+
+  vector<EnsembleRun> runs(numRuns);
+  LifeThreadPool pool(numThreads);
+  pool.run(numRuns, [&](int i) {
+    runs[i] = runOne(spec, ensembleSeed(spec.seed, i));
+  });
+  return runs;
+}
+
+void writeEnsembleCsv(const vector<EnsembleRun> &runs,
+                      const string &filename) {
+  ofstream out(filename);
+  if (!out)
+    error("Can not write file " + filename);
+  out << "run,seed,initial_population,outcome,settled_at,period,"
+         "final_population\n";
+  for (size_t i = 0; i < runs.size(); ++i) {
+    const EnsembleRun &run = runs[i];
+    const char *outcome =
+        !run.settled ? "unsettled" : run.period == 1 ? "stable" : "oscillating";
+    out << i << ',' << run.seed << ',' << run.initialPopulation << ','
+        << outcome << ',' << run.settledAt << ',' << run.period << ','
+        << run.finalPopulation << '\n';
+  }
+  if (!out)
+    error("Can not write file " + filename);
+}
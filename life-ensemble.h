@@ -0,0 +1,76 @@
+/**
+ * File: life-ensemble.h
+ * ---------------------
+ * Defines ensemble runs, which evolve many independent random boards, one
+ * per seed, to see how long random soups live and what they settle into.
+ * The runs are spread over a pool of threads; each run's seed depends only
+ * on the base seed and the run's index, so the results are the same for
+ * any number of threads.
+ */
+
+#pragma once
+#include "life-rules.h" // for LifeRule, kConwayRule
+#include <cstdint>      // for uint64_t
+#include <string>       // for std::string
+#include <vector>       // for std::vector
+
+/**
+ * Type: EnsembleSpec
+ * ------------------
+ * What every run of an ensemble starts from and how long it may go on.
+ */
+struct EnsembleSpec {
+  int rows = 0;
+  int cols = 0;
+  double density = 0.5;
+  uint64_t seed = 1;             // the base seed the runs' seeds come from
+  long long generations = 1000;  // a run that has not settled by then stops
+  std::string engine;            // as accepted by createEngine, but for
+                                 // "parallel"
+  LifeRule rule = kConwayRule;
+  bool torus = false;
+};
+
+/**
+ * Type: EnsembleRun
+ * -----------------
+ * The outcome of one run. A run has settled once its live cells repeat:
+ * with period 1 it is stable, otherwise it oscillates. settledAt is the
+ * first generation of the repeating part.
+ */
+struct EnsembleRun {
+  uint64_t seed;
+  long long initialPopulation;
+  bool settled;
+  long long settledAt;        // generations run if the run did not settle
+  int period;                 // 0 if the run did not settle
+  long long finalPopulation;
+};
+
+/**
+ * Function: ensembleSeed
+ * ----------------------
+ * Returns the seed of the given run, a well-mixed function of the base seed
+ * and the run's index, so neighboring runs get unrelated boards.
+ */
+uint64_t ensembleSeed(uint64_t baseSeed, int run);
+
+/**
+ * Function: runEnsemble
+ * ---------------------
+ * Runs numRuns boards as the spec says on numThreads threads and returns
+ * their outcomes in run order. Problems with the spec, such as an unknown
+ * engine, are reported through error before any run starts.
+ */
+std::vector<EnsembleRun> runEnsemble(const EnsembleSpec &spec, int numRuns,
+                                     int numThreads);
+
+/**
+ * Function: writeEnsembleCsv
+ * --------------------------
+ * Writes one line per run to the named CSV file, under a header line:
+ * run, seed, initial_population, outcome (stable, oscillating or
+ * unsettled), settled_at, period and final_population.
+ */
+void writeEnsembleCsv(const std::vector<EnsembleRun> &runs,
+                      const std::string &filename);
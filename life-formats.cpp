@@ -0,0 +1,260 @@
+/**
+ * File: life-formats.cpp
+ * ----------------------
+ * Implements the RLE reader and writer and the dispatch on file extensions.
+ */
+
+#include <algorithm> // for find
+#include <cctype>    // for isdigit, isspace
+#include <fstream>   // for ofstream
+using namespace std;
+
+#include "error.h"  // for error
+#include "strlib.h" // for endsWith, stringIsInteger, toLowerCase, trim
+
+#include "life-formats.h"
+#include "life-hashlife.h"    // for class HashLife
+#include "life-mapped-file.h" // for class MappedFile
+#include "life-mpi.h"         // for class MpiLife
+#include "life-packed.h"      // for class PackedLife
+#include "life-rules.h"       // for parseFileRule, ruleString
+#include "life-snapshot.h"    // for class SnapshotFile, saveSnapshot
+
+/**
+ * Function: parseRleHeader
+ * ------------------------
+ * Reads the width and height out of an RLE header line such as
+ * "x = 3, y = 3, rule = B36/S23", along with the rule, B3/S23 if the line
+ * names none.
+ */
+static void parseRleHeader(const string &line, const string &filename,
+                           PackedPattern &pattern) {
+  string header;
+  for (char ch : line) {
+    if (!isspace((unsigned char)ch))
+      header += ch;
+  }
+  pattern.rows = -1;
+  pattern.cols = -1;
+  pattern.rule = ruleString(kConwayRule);
+  size_t start = 0;
+  while (start <= header.size()) {
+    size_t comma = header.find(',', start);
+    string field = header.substr(start, comma - start);
+    start = comma == string::npos ? header.size() + 1 : comma + 1;
+    size_t equals = field.find('=');
+    string key = toLowerCase(field.substr(0, equals));
+    string value = equals == string::npos ? "" : field.substr(equals + 1);
+    if (key == "x" || key == "y") {
+      if (!stringIsInteger(value) || stringToInteger(value) <= 0)
+        error(filename + ": bad " + key + " in the RLE header");
+      (key == "x" ? pattern.cols : pattern.rows) = stringToInteger(value);
+    } else if (key == "rule") {
+      pattern.rule = ruleString(parseFileRule(value, filename));
+    }
+  }
+  if (pattern.rows < 0 || pattern.cols < 0)
+    error(filename + ": the RLE header needs both x and y");
+}
+
+PackedPattern readRlePattern(const string &filename) {
+  MappedFile file(filename);
+  const char *pos = file.data();
+  const char *end = pos + file.size();
+
+  // skip the '#' lines, then read the header line
+  PackedPattern pattern;
+  while (true) {
+    if (pos == end)
+      error(filename + ": the file has no RLE header");
+    const char *lineEnd = find(pos, end, '\n');
+    string line = trim(string(pos, lineEnd));
+    pos = lineEnd == end ? end : lineEnd + 1;
+    if (line.empty() || line[0] == '#')
+      continue;
+    parseRleHeader(line, filename, pattern);
+    break;
+  }
+  pattern.wordsPerRow = (pattern.cols + 63) / 64;
+  pattern.bits.assign(size_t(pattern.rows) * pattern.wordsPerRow, 0);
+
+  long long row = 0;
+  long long col = 0;
+  long long count = 0;
+  for (; pos != end && *pos != '!'; ++pos) {
+    char ch = *pos;
+    if (isdigit((unsigned char)ch)) {
+      count = count * 10 + (ch - '0');
+      if (count > (1LL << 40))
+        error(filename + ": run length out of range");
+      continue;
+    }
+    if (isspace((unsigned char)ch))
+      continue;
+    long long run = count == 0 ? 1 : count;
+    count = 0;
+    if (ch == '$') {
+      row += run;
+      col = 0;
+    } else if (ch == 'b' || ch == '.') {
+      col += run;
+    } else if (ch == 'o' || ch == 'A') {
+      if (row >= pattern.rows || col + run > pattern.cols)
+        error(filename + ": a live cell lies outside the " +
+              to_string(pattern.cols) + " x " + to_string(pattern.rows) +
+              " box in the header");
+      uint64_t *words = pattern.bits.data() + row * pattern.wordsPerRow;
+      for (long long c = col; c < col + run; ++c) {
+        words[c / 64] |= uint64_t(1) << (c % 64);
+      }
+      col += run;
+    } else {
+      error(filename + ": unexpected '" + string(1, ch) + "' in the RLE data");
+    }
+  }
+  return pattern;
+}
+
+/**
+ * Type: RleWriter
+ * ---------------
+ * Appends runs to an RLE file, wrapping lines before they pass 70
+ * characters as the format asks.
+ */
+struct RleWriter {
+  ofstream &out;
+  size_t lineLength = 0;
+
+  void emit(long long run, char tag) {
+    if (run == 0)
+      return;
+    string item = (run > 1 ? to_string(run) : string()) + tag;
+    if (lineLength + item.size() > 70) {
+      out << '\n';
+      lineLength = 0;
+    }
+    out << item;
+    lineLength += item.size();
+  }
+};
+
+void writeRlePattern(const PackedPattern &pattern, const string &filename) {
+  ofstream out(filename);
+  if (!out)
+    error("Can not write file " + filename);
+  out << "x = " << pattern.cols << ", y = " << pattern.rows << ", rule = "
+      << (pattern.rule.empty() ? ruleString(kConwayRule) : pattern.rule)
+      << "\n";
+
+  RleWriter writer{out};
+  long long pendingRows = 0; // row ends not yet written, so trailing empty
+                             // rows are dropped
+  for (int row = 0; row < pattern.rows; ++row) {
+    int col = 0;
+    while (col < pattern.cols) {
+      bool isAlive = pattern.isAlive(row, col);
+      int runEnd = col;
+      while (runEnd < pattern.cols && pattern.isAlive(row, runEnd) == isAlive) {
+        ++runEnd;
+      }
+      // trailing dead cells of a row are implied by the row end
+      if (isAlive || runEnd < pattern.cols) {
+        writer.emit(pendingRows, '$');
+        pendingRows = 0;
+        writer.emit(runEnd - col, isAlive ? 'o' : 'b');
+      }
+      col = runEnd;
+    }
+    ++pendingRows;
+  }
+  out << "!\n";
+  if (!out)
+    error("Can not write file " + filename);
+}
+
+static bool hasExtension(const string &filename, const string &extension) {
+  return endsWith(toLowerCase(filename), extension);
+}
+
+PackedPattern readPatternFile(const string &filename) {
+  if (hasExtension(filename, ".rle"))
+    return readRlePattern(filename);
+  if (hasExtension(filename, ".mc")) {
+    HashLife universe;
+    universe.loadMacrocell(filename);
+    PackedPattern pattern;
+    universe.exportPattern(pattern);
+    pattern.rule = ruleString(universe.rule());
+    return pattern;
+  }
+  if (hasExtension(filename, ".snap")) {
+    SnapshotFile snapshot(filename);
+    const SnapshotView &view = snapshot.view();
+    PackedPattern pattern;
+    pattern.rows = view.rows;
+    pattern.cols = view.cols;
+    pattern.wordsPerRow = view.wordsPerRow;
+    pattern.bits.assign(view.live,
+                        view.live + size_t(view.rows) * view.wordsPerRow);
+    return pattern;
+  }
+  return readPackedPattern(filename);
+}
+
+void loadPatternFile(LifeEngine &engine, const string &filename) {
+  HashLife *hashLife = dynamic_cast<HashLife *>(&engine);
+  if (hashLife && hasExtension(filename, ".mc")) {
+    hashLife->loadMacrocell(filename);
+  } else if (hasExtension(filename, ".snap")) {
+    restoreSnapshot(engine, filename);
+  } else {
+    PackedPattern pattern = readPatternFile(filename);
+    if (!pattern.rule.empty())
+      engine.setRule(parseRule(pattern.rule));
+    engine.loadPattern(pattern);
+  }
+}
+
+void savePatternFile(const LifeEngine &engine, const string &filename) {
+#ifdef LIFE_HAVE_MPI
+  // every rank of the distributed engine gets here; they write a snapshot
+  // together, and the first of them writes anything else from a copy of
+  // the whole board
+  const MpiLife *mpiLife = dynamic_cast<const MpiLife *>(&engine);
+  if (mpiLife && hasExtension(filename, ".snap")) {
+    mpiLife->saveSnapshot(filename);
+    return;
+  }
+  if (mpiLife && (hasExtension(filename, ".rle") ||
+                  hasExtension(filename, ".mc"))) {
+    PackedLife whole;
+    whole.setRule(engine.rule());
+    if (mpiLife->gatherOnRoot(whole))
+      savePatternFile(whole, filename);
+    return;
+  }
+#endif
+  if (hasExtension(filename, ".mc")) {
+    const HashLife *hashLife = dynamic_cast<const HashLife *>(&engine);
+    if (hashLife) {
+      hashLife->saveMacrocell(filename);
+      return;
+    }
+    PackedPattern pattern;
+    engine.exportPattern(pattern);
+    HashLife universe;
+    universe.loadPattern(pattern);
+    universe.setRule(engine.rule());
+    universe.saveMacrocell(filename);
+  } else if (hasExtension(filename, ".rle")) {
+    PackedPattern pattern;
+    engine.exportPattern(pattern);
+    pattern.rule = ruleString(engine.rule());
+    writeRlePattern(pattern, filename);
+  } else if (hasExtension(filename, ".snap")) {
+    saveSnapshot(engine, filename);
+  } else {
+    error("Can not save " + filename +
+          ", pick a .snap, .rle or .mc file name");
+  }
+}
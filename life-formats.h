@@ -0,0 +1,67 @@
+/**
+ * File: life-formats.h
+ * --------------------
+ * Defines reading and writing of the pattern file formats: the text layout
+ * of res/files, run-length encoded (.rle) files and Macrocell (.mc) files,
+ * along with snapshots (.snap). The format is picked from the file's
+ * extension.
+ */
+
+#pragma once
+#include "life-engine.h"   // for LifeEngine
+#include "life-patterns.h" // for PackedPattern
+#include <string>          // for std::string
+
+/**
+ * Function: readRlePattern
+ * ------------------------
+ * Reads a pattern in the standard RLE format: '#' lines, a header line
+ * "x = width, y = height, rule = B3/S23", where the rule may be left out,
+ * then runs of 'b' (dead) and 'o' (alive) cells, with '$' ending a row and
+ * '!' ending the pattern. Problems with the file are reported through error.
+ */
+PackedPattern readRlePattern(const std::string &filename);
+
+/**
+ * Function: writeRlePattern
+ * -------------------------
+ * Writes the pattern to the named file in the RLE format, under its rule or
+ * B3/S23 if it has none.
+ */
+void writeRlePattern(const PackedPattern &pattern, const std::string &filename);
+
+/**
+ * Function: readPatternFile
+ * -------------------------
+ * Reads a pattern in whichever format the file's extension names: .rle,
+ * .mc, .snap, or the text layout of res/files for anything else. A
+ * Macrocell file is loaded into a HashLife tree and the bounding box of its
+ * cells taken. Only the liveness of a snapshot is read.
+ */
+PackedPattern readPatternFile(const std::string &filename);
+
+/**
+ * Function: loadPatternFile
+ * -------------------------
+ * Loads the named pattern file into the engine, switching it to the rule the
+ * file records; RLE and Macrocell files always record one, B3/S23 when they
+ * leave it out, while the other formats keep the engine's rule. A HashLife
+ * engine reads Macrocell files into its tree directly, without expanding
+ * them into cells. Snapshots are restored with their ages and generation
+ * count.
+ */
+void loadPatternFile(LifeEngine &engine, const std::string &filename);
+
+/**
+ * Function: savePatternFile
+ * -------------------------
+ * Saves the engine's current generation to the named file, as RLE for .rle,
+ * as Macrocell for .mc and as a snapshot for .snap. RLE and Macrocell files
+ * record the engine's rule. A HashLife engine writes
+ * its whole tree to Macrocell files, cells that have left the board
+ * included. Every rank of the distributed engine of life-mpi.h calls this
+ * together: a snapshot is written by all of them at once, and the other
+ * formats by the first rank alone. Any other extension is reported through
+ * error.
+ */
+void savePatternFile(const LifeEngine &engine, const std::string &filename);
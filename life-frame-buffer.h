@@ -0,0 +1,79 @@
+/**
+ * File: life-frame-buffer.h
+ * -------------------------
+ * Defines a lock-free triple buffer of frames passed from one producer
+ * thread to one consumer thread. The producer fills its own slot and swaps
+ * it into the middle, replacing any frame the consumer has not taken yet;
+ * the consumer swaps the middle out whenever it wants the newest frame.
+ * Neither ever waits for the other, and frames are filled and read in
+ * place, so a slot keeps its buffers from one frame to the next and nothing
+ * is allocated once every slot has been used.
+ */
+
+#pragma once
+#include <atomic> // for std::atomic
+
+template <typename Frame> class FrameBuffer {
+public:
+  FrameBuffer() { reset(); }
+
+  /**
+   * Forgets any frame published and not taken. Only call it while neither
+   * thread is using the buffer.
+   */
+  void reset() {
+    back = 0;
+    front = 1;
+    middle.store(2, std::memory_order_relaxed);
+  }
+
+  /**
+   * Producer: returns the slot to fill with the next frame. The consumer
+   * never sees it until publish.
+   */
+  Frame *slotToFill() { return &slots[back]; }
+
+  /**
+   * Producer: hands the slot returned by slotToFill to the consumer in
+   * place of any frame it has not taken, and takes back the slot that frame
+   * was in.
+   */
+  void publish() {
+    back = middle.exchange(back | kFresh, std::memory_order_acq_rel) &
+           kIndexMask;
+  }
+
+  /**
+   * Returns whether a frame has been published that the consumer has not
+   * taken. Either thread may ask.
+   */
+  bool pending() const {
+    return (middle.load(std::memory_order_acquire) & kFresh) != 0;
+  }
+
+  /**
+   * Consumer: returns the newest frame published since the last call, or
+   * nullptr if there is none. The frame stays the consumer's, untouched by
+   * the producer, until the next call that returns one.
+   */
+  Frame *takeLatest() {
+    if (!pending())
+      return nullptr;
+    front = middle.exchange(front, std::memory_order_acq_rel) & kIndexMask;
+    return &slots[front];
+  }
+
+private:
+  // middle holds the index of the slot between the two threads, with
+  // kFresh set while it holds a frame the consumer has not taken
+  static const unsigned kIndexMask = 3;
+  static const unsigned kFresh = 4;
+
+  Frame slots[3];
+  unsigned back;  // the producer's slot
+  unsigned front; // the consumer's slot
+  alignas(64) std::atomic<unsigned> middle;
+
+  FrameBuffer(const FrameBuffer &original);
+  void operator=(const FrameBuffer &rhs) const;
+};
@@ -0,0 +1,708 @@
+/**
+ * File: life-gpu.cpp
+ * ------------------
+ * Implements the OpenCL stepping engine. A generation takes three kernels:
+ * one refilling the halo on a torus, one stepping every word with the same
+ * adder logic as life-kernel.h, and one summing each tile's population and
+ * whether it changed. Stepping reads back just those sums; the cells
+ * themselves come back a tile at a time, only for the tiles in the
+ * viewport when changes are recorded and otherwise only when asked for.
+ * A fourth kernel counts the live cells of each block of a zoomed-out
+ * view, so only the counts come back.
+ */
+
+#ifdef LIFE_HAVE_OPENCL
+#include <algorithm> // for copy, fill, max, min
+#include <string>    // for string, to_string
+#include <utility>   // for swap
+using namespace std;
+
+#include "error.h" // for error
+
+#include "life-constants.h" // for kMaxAge
+#include "life-gpu.h"
+#include "life-kernel.h"    // for countBits, countTrailingZeros
+#include "life-profile.h"   // for LIFE_PROFILE_SCOPE, LIFE_PROFILE_COUNT
+
+static_assert(GpuLife::kAgePlanes == kSnapshotAgePlanes,
+              "snapshots copy the age planes as they are");
+
+// The kernels, in OpenCL C. MAX_AGE, AGE_PLANES, TILE_ROWS and TILE_WORDS
+// are defined when the program is built.
+static const char *const kKernelSource = R"(
+__kernel void halo(__global ulong *live, int rows, int cols, int wordsPerRow,
+                   int stride, ulong lastWordMask, int wrap) {
+  int row = get_global_id(0);
+  if (row >= rows)
+    return;
+  __global ulong *words = live + (size_t)(row + 1) * stride + 1;
+  words[wordsPerRow - 1] &= lastWordMask;
+  if (!wrap) {
+    words[-1] = 0;
+    words[wordsPerRow] = 0;
+    return;
+  }
+  ulong first = words[0] & 1;
+  ulong last = (words[(cols - 1) / 64] >> ((cols - 1) % 64)) & 1;
+  words[-1] = last << 63;
+  if (cols % 64 == 0)
+    words[wordsPerRow] = first;
+  else
+    words[wordsPerRow - 1] |= first << (cols % 64);
+}
+
+__kernel void step(__global const ulong *live, __global ulong *next,
+                   __global ulong *ages, __global ulong *changed, int rows,
+                   int wordsPerRow, int stride, ulong lastWordMask,
+                   uint birth, uint survival) {
+  int w = get_global_id(0);
+  int row = get_global_id(1);
+  if (w >= wordsPerRow || row >= rows)
+    return;
+  size_t padded = (size_t)(row + 1) * stride + 1 + w;
+  __global const ulong *mid = live + padded;
+  __global const ulong *up = mid - stride;
+  __global const ulong *down = mid + stride;
+
+  ulong u = up[0];
+  ulong uw = (u << 1) | (up[-1] >> 63);
+  ulong ue = (u >> 1) | (up[1] << 63);
+  ulong m = mid[0];
+  ulong mw = (m << 1) | (mid[-1] >> 63);
+  ulong me = (m >> 1) | (mid[1] << 63);
+  ulong d = down[0];
+  ulong dw = (d << 1) | (down[-1] >> 63);
+  ulong de = (d >> 1) | (down[1] << 63);
+
+  ulong u0 = uw ^ u ^ ue;
+  ulong u1 = (uw & u) | (ue & (uw ^ u));
+  ulong d0 = dw ^ d ^ de;
+  ulong d1 = (dw & d) | (de & (dw ^ d));
+  ulong m0 = mw ^ me;
+  ulong m1 = mw & me;
+  ulong ones = u0 ^ d0 ^ m0;
+  ulong carry = (u0 & d0) | (m0 & (u0 ^ d0));
+  ulong twosLow = u1 ^ d1;
+  ulong twosHigh = m1 ^ carry;
+  ulong twos = twosLow ^ twosHigh;
+  ulong upDownPair = u1 & d1;
+  ulong middlePair = m1 & carry;
+  ulong fours = upDownPair ^ middlePair ^ (twosLow & twosHigh);
+  ulong eights = upDownPair & middlePair;
+  ulong born = 0;
+  ulong survives = 0;
+  for (int count = 0; count <= 8; ++count) {
+    ulong isCount = ((count & 1) ? ones : ~ones) &
+                    ((count & 2) ? twos : ~twos) &
+                    ((count & 4) ? fours : ~fours) &
+                    ((count & 8) ? eights : ~eights);
+    if ((birth >> count) & 1)
+      born |= isCount;
+    if ((survival >> count) & 1)
+      survives |= isCount;
+  }
+
+  ulong mask = w == wordsPerRow - 1 ? lastWordMask : ~(ulong)0;
+  ulong was = m & mask;
+  ulong now = ((born & ~m) | (survives & m)) & mask;
+  next[padded] = now;
+  size_t at = (size_t)row * wordsPerRow + w;
+  size_t planeWords = (size_t)rows * wordsPerRow;
+  ulong births = now & ~was;
+  ulong deaths = was & ~now;
+  if (!(was | now)) {
+    changed[at] = 0;
+    return;
+  }
+
+  ulong age[AGE_PLANES];
+  ulong atMax = ~(ulong)0;
+  for (int b = 0; b < AGE_PLANES; ++b) {
+    age[b] = ages[b * planeWords + at];
+    atMax &= ((MAX_AGE >> b) & 1) ? age[b] : ~age[b];
+  }
+  ulong survived = now & was;
+  ulong grow = survived & ~atMax;
+  ulong keep = survived & atMax;
+  ulong ageCarry = ~(ulong)0;
+  for (int b = 0; b < AGE_PLANES; ++b) {
+    ulong incremented = age[b] ^ ageCarry;
+    ageCarry &= age[b];
+    ulong updated = (grow & incremented) | (keep & age[b]);
+    if (b == 0)
+      updated |= births;
+    ages[b * planeWords + at] = updated;
+  }
+  changed[at] = births | deaths | grow;
+}
+
+__kernel void summarize(__global const ulong *live,
+                        __global const ulong *changed, __global uint *stats,
+                        int rows, int wordsPerRow, int stride,
+                        int tileCols) {
+  int tileCol = get_global_id(0);
+  int tileRow = get_global_id(1);
+  if (tileCol >= tileCols || tileRow * TILE_ROWS >= rows)
+    return;
+  int rowEnd = min(rows, (tileRow + 1) * TILE_ROWS);
+  int wordEnd = min(wordsPerRow, (tileCol + 1) * TILE_WORDS);
+  uint population = 0;
+  ulong any = 0;
+  for (int row = tileRow * TILE_ROWS; row < rowEnd; ++row) {
+    for (int w = tileCol * TILE_WORDS; w < wordEnd; ++w) {
+      population += popcount(live[(size_t)(row + 1) * stride + 1 + w]);
+      any |= changed[(size_t)row * wordsPerRow + w];
+    }
+  }
+  size_t tile = (size_t)tileRow * tileCols + tileCol;
+  stats[2 * tile] = population;
+  stats[2 * tile + 1] = any != 0;
+}
+
+__kernel void countBlocks(__global const ulong *live, __global uint *counts,
+                          int rows, int cols, int stride, int top, int left,
+                          int viewRows, int viewCols, int blockSize) {
+  int blockCol = get_global_id(0);
+  int blockRow = get_global_id(1);
+  if (blockCol >= viewCols || blockRow >= viewRows)
+    return;
+  int rowBegin = max(top + blockRow * blockSize, 0);
+  int rowEnd = min(top + (blockRow + 1) * blockSize, rows);
+  int colBegin = max(left + blockCol * blockSize, 0);
+  int colEnd = min(left + (blockCol + 1) * blockSize, cols);
+  uint count = 0;
+  for (int row = rowBegin; row < rowEnd && colBegin < colEnd; ++row) {
+    __global const ulong *words = live + (size_t)(row + 1) * stride + 1;
+    for (int w = colBegin / 64; w <= (colEnd - 1) / 64; ++w) {
+      int low = max(colBegin - w * 64, 0);
+      int high = min(colEnd - w * 64, 64);
+      ulong mask = (high == 64 ? ~(ulong)0 : ((ulong)1 << high) - 1) &
+                   ~(((ulong)1 << low) - 1);
+      count += popcount(words[w] & mask);
+    }
+  }
+  counts[(size_t)blockRow * viewCols + blockCol] = count;
+}
+)";
+
+/**
+ * Function: check
+ * ---------------
+ * Reports an OpenCL call that failed through error.
+ */
+static void check(cl_int status, const char *what) {
+  if (status != CL_SUCCESS)
+    error(string("OpenCL: ") + what + " failed with error " +
+          to_string(status));
+}
+
+/**
+ * Function: pickDevice
+ * --------------------
+ * Returns the first GPU on any platform, or failing that the first device
+ * of any kind.
+ */
+static cl_device_id pickDevice() {
+  cl_uint numPlatforms = 0;
+  if (clGetPlatformIDs(0, nullptr, &numPlatforms) != CL_SUCCESS ||
+      numPlatforms == 0)
+    error("OpenCL: no platform is installed");
+  vector<cl_platform_id> platforms(numPlatforms);
+  check(clGetPlatformIDs(numPlatforms, platforms.data(), nullptr),
+        "listing the platforms");
+  const cl_device_type types[] = {CL_DEVICE_TYPE_GPU, CL_DEVICE_TYPE_ALL};
+  for (cl_device_type type : types) {
+    for (cl_platform_id platform : platforms) {
+      cl_device_id device;
+      if (clGetDeviceIDs(platform, type, 1, &device, nullptr) == CL_SUCCESS)
+        return device;
+    }
+  }
+  error("OpenCL: no device is available");
+  return nullptr;
+}
+
+GpuLife::GpuLife()
+    : rows(0), cols(0), wordsPerRow(0), stride(2), tileRows(0), tileCols(0),
+      torus(false), lastWordMask(~uint64_t(0)), livePopulation(0),
+      viewTop(0), viewLeft(0), viewRows(0), viewCols(0), context(nullptr),
+      queue(nullptr), program(nullptr), haloKernel(nullptr),
+      stepKernel(nullptr), summaryKernel(nullptr), blockKernel(nullptr),
+      live(nullptr), nextLive(nullptr), ages(nullptr), changedWords(nullptr),
+      tileStats(nullptr), blockCounts(nullptr), blockCountCapacity(0) {
+  try {
+    cl_device_id device = pickDevice();
+    cl_int status;
+    context = clCreateContext(nullptr, 1, &device, nullptr, nullptr, &status);
+    check(status, "creating a context");
+    queue = clCreateCommandQueue(context, device, 0, &status);
+    check(status, "creating a command queue");
+    const char *source = kKernelSource;
+    program =
+        clCreateProgramWithSource(context, 1, &source, nullptr, &status);
+    check(status, "creating the program");
+    string options = "-cl-std=CL1.2 -DMAX_AGE=" + to_string(kMaxAge) +
+                     " -DAGE_PLANES=" + to_string(kAgePlanes) +
+                     " -DTILE_ROWS=" + to_string(kTileRows) +
+                     " -DTILE_WORDS=" + to_string(kTileWords);
+    if (clBuildProgram(program, 1, &device, options.c_str(), nullptr,
+                       nullptr) != CL_SUCCESS) {
+      size_t length = 0;
+      clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, nullptr,
+                            &length);
+      string log(length, '\0');
+      clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, length,
+                            &log[0], nullptr);
+      error("OpenCL: the kernels did not build:\n" + log);
+    }
+    haloKernel = clCreateKernel(program, "halo", &status);
+    check(status, "creating the halo kernel");
+    stepKernel = clCreateKernel(program, "step", &status);
+    check(status, "creating the step kernel");
+    summaryKernel = clCreateKernel(program, "summarize", &status);
+    check(status, "creating the summary kernel");
+    blockKernel = clCreateKernel(program, "countBlocks", &status);
+    check(status, "creating the block count kernel");
+  } catch (...) {
+    releaseDevice();
+    throw;
+  }
+}
+
+GpuLife::~GpuLife() { releaseDevice(); }
+
+void GpuLife::releaseBuffers() {
+  for (cl_mem *buffer :
+       {&live, &nextLive, &ages, &changedWords, &tileStats, &blockCounts}) {
+    if (*buffer)
+      clReleaseMemObject(*buffer);
+    *buffer = nullptr;
+  }
+  blockCountCapacity = 0;
+}
+
+void GpuLife::releaseDevice() {
+  releaseBuffers();
+  for (cl_kernel kernel :
+       {haloKernel, stepKernel, summaryKernel, blockKernel}) {
+    if (kernel)
+      clReleaseKernel(kernel);
+  }
+  if (program)
+    clReleaseProgram(program);
+  if (queue)
+    clReleaseCommandQueue(queue);
+  if (context)
+    clReleaseContext(context);
+}
+
+/**
+ * Function: newBuffer
+ * -------------------
+ * Returns a device buffer of the given number of words, all zero.
+ */
+static cl_mem newBuffer(cl_context context, cl_command_queue queue,
+                        size_t words) {
+  cl_int status;
+  // OpenCL has no empty buffers, so an empty board still gets a word
+  size_t bytes = max(words, size_t(1)) * sizeof(uint64_t);
+  cl_mem buffer =
+      clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, nullptr, &status);
+  check(status, "allocating device memory");
+  uint64_t zero = 0;
+  check(clEnqueueFillBuffer(queue, buffer, &zero, sizeof(zero), 0, bytes, 0,
+                            nullptr, nullptr),
+        "clearing device memory");
+  return buffer;
+}
+
+void GpuLife::resize(int numRows, int numCols) {
+  releaseBuffers();
+  rows = numRows;
+  cols = numCols;
+  generationCount = 0;
+  wordsPerRow = (cols + 63) / 64;
+  stride = wordsPerRow + 2;
+  tileRows = (rows + kTileRows - 1) / kTileRows;
+  tileCols = (wordsPerRow + kTileWords - 1) / kTileWords;
+  lastWordMask =
+      cols % 64 == 0 ? ~uint64_t(0) : (uint64_t(1) << (cols % 64)) - 1;
+  size_t paddedWords = size_t(rows + 2) * stride;
+  live = newBuffer(context, queue, paddedWords);
+  nextLive = newBuffer(context, queue, paddedWords);
+  ages = newBuffer(context, queue, kAgePlanes * planeWords());
+  changedWords = newBuffer(context, queue, planeWords());
+  tileStats = newBuffer(context, queue, size_t(tileRows) * tileCols);
+  hostLive.assign(planeWords(), 0);
+  hostAges.assign(kAgePlanes * planeWords(), 0);
+  hostChanged.assign(planeWords(), 0);
+  tileFresh.assign(size_t(tileRows) * tileCols, 1);
+  hostStats.assign(2 * size_t(tileRows) * tileCols, 0);
+  LIFE_PROFILE_COUNT(kAllocations, 5);
+  viewTop = viewLeft = 0;
+  viewRows = rows;
+  viewCols = cols;
+}
+
+void GpuLife::setViewport(int top, int left, int numRows, int numCols) {
+  viewTop = max(top, 0);
+  viewLeft = max(left, 0);
+  viewRows = max(min(top + numRows, rows) - viewTop, 0);
+  viewCols = max(min(left + numCols, cols) - viewLeft, 0);
+}
+
+/**
+ * Function: uploadBoard
+ * ---------------------
+ * Copies the host's copy of the board, which must be entirely up to date,
+ * to the device and counts its population.
+ */
+void GpuLife::uploadBoard() {
+  livePopulation = 0;
+  for (uint64_t word : hostLive) {
+    livePopulation += countBits(word);
+  }
+  if (planeWords() == 0)
+    return;
+  size_t bufferOrigin[3] = {sizeof(uint64_t), 1, 0};
+  size_t hostOrigin[3] = {0, 0, 0};
+  size_t region[3] = {wordsPerRow * sizeof(uint64_t), size_t(rows), 1};
+  check(clEnqueueWriteBufferRect(queue, live, CL_FALSE, bufferOrigin,
+                                 hostOrigin, region,
+                                 stride * sizeof(uint64_t), 0,
+                                 wordsPerRow * sizeof(uint64_t), 0,
+                                 hostLive.data(), 0, nullptr, nullptr),
+        "copying the board to the device");
+  check(clEnqueueWriteBuffer(queue, ages, CL_TRUE, 0,
+                             hostAges.size() * sizeof(uint64_t),
+                             hostAges.data(), 0, nullptr, nullptr),
+        "copying the ages to the device");
+  LIFE_PROFILE_COUNT(kBytesCopied,
+                     (long long)(kAgePlanes + 1) * planeWords() * 8);
+  fill(tileFresh.begin(), tileFresh.end(), 1);
+}
+
+void GpuLife::load(const Grid<int> &grid) {
+  resize(grid.numRows(), grid.numCols());
+  for (int row = 0; row < rows; ++row) {
+    for (int col = 0; col < cols; ++col) {
+      int age = min(grid[row][col], kMaxAge);
+      if (age <= 0)
+        continue;
+      size_t word = size_t(row) * wordsPerRow + col / 64;
+      uint64_t bit = uint64_t(1) << (col % 64);
+      hostLive[word] |= bit;
+      for (int b = 0; b < kAgePlanes; ++b) {
+        if ((age >> b) & 1)
+          hostAges[b * planeWords() + word] |= bit;
+      }
+    }
+  }
+  uploadBoard();
+}
+
+void GpuLife::loadPattern(const PackedPattern &pattern) {
+  resize(pattern.rows, pattern.cols);
+  for (int row = 0; row < rows; ++row) {
+    const uint64_t *words =
+        pattern.bits.data() + size_t(row) * pattern.wordsPerRow;
+    copy(words, words + wordsPerRow,
+         hostLive.begin() + size_t(row) * wordsPerRow);
+  }
+  copy(hostLive.begin(), hostLive.end(), hostAges.begin());
+  uploadBoard();
+}
+
+void GpuLife::loadSnapshot(const SnapshotView &snapshot) {
+  resize(snapshot.rows, snapshot.cols);
+  copy(snapshot.live, snapshot.live + planeWords(), hostLive.begin());
+  for (int b = 0; b < kAgePlanes; ++b) {
+    copy(snapshot.ages[b], snapshot.ages[b] + planeWords(),
+         hostAges.begin() + b * planeWords());
+  }
+  uploadBoard();
+  generationCount = snapshot.generation;
+}
+
+void GpuLife::exportPattern(PackedPattern &pattern) const {
+  readAllTiles();
+  pattern.rows = rows;
+  pattern.cols = cols;
+  pattern.wordsPerRow = wordsPerRow;
+  pattern.bits = hostLive;
+}
+
+void GpuLife::exportSnapshot(SnapshotBuffer &snapshot) const {
+  readAllTiles();
+  copy(hostLive.begin(), hostLive.end(), snapshot.live);
+  for (int b = 0; b < kAgePlanes; ++b) {
+    copy(hostAges.begin() + b * planeWords(),
+         hostAges.begin() + (b + 1) * planeWords(), snapshot.ages[b]);
+  }
+}
+
+void GpuLife::clear() {
+  fill(hostLive.begin(), hostLive.end(), 0);
+  fill(hostAges.begin(), hostAges.end(), 0);
+  uploadBoard();
+}
+
+int GpuLife::ageAt(int row, int col) const {
+  int tile = tileOf(row, col);
+  if (!tileFresh[tile])
+    readTiles({tile}, false);
+  size_t word = size_t(row) * wordsPerRow + col / 64;
+  int age = 0;
+  for (int b = 0; b < kAgePlanes; ++b) {
+    age |= int((hostAges[b * planeWords() + word] >> (col % 64)) & 1) << b;
+  }
+  return age;
+}
+
+void GpuLife::countBlocks(const BoardView &view, vector<int> &counts) const {
+  static_assert(sizeof(int) == sizeof(cl_uint),
+                "the counts are read back into the ints as they are");
+  counts.assign(size_t(view.rows) * view.cols, 0);
+  if (counts.empty() || planeWords() == 0)
+    return;
+  if (counts.size() > blockCountCapacity) {
+    // grows to the largest view asked for and stays, as the view changes
+    // size only when the window does
+    if (blockCounts)
+      clReleaseMemObject(blockCounts);
+    cl_int status;
+    blockCounts = clCreateBuffer(context, CL_MEM_WRITE_ONLY,
+                                 counts.size() * sizeof(cl_uint), nullptr,
+                                 &status);
+    check(status, "allocating the block counts");
+    blockCountCapacity = counts.size();
+    LIFE_PROFILE_COUNT(kAllocations, 1);
+  }
+  clSetKernelArg(blockKernel, 0, sizeof(cl_mem), &live);
+  clSetKernelArg(blockKernel, 1, sizeof(cl_mem), &blockCounts);
+  clSetKernelArg(blockKernel, 2, sizeof(int), &rows);
+  clSetKernelArg(blockKernel, 3, sizeof(int), &cols);
+  clSetKernelArg(blockKernel, 4, sizeof(int), &stride);
+  clSetKernelArg(blockKernel, 5, sizeof(int), &view.top);
+  clSetKernelArg(blockKernel, 6, sizeof(int), &view.left);
+  clSetKernelArg(blockKernel, 7, sizeof(int), &view.rows);
+  clSetKernelArg(blockKernel, 8, sizeof(int), &view.cols);
+  clSetKernelArg(blockKernel, 9, sizeof(int), &view.blockSize);
+  size_t blocks[2] = {size_t(view.cols), size_t(view.rows)};
+  check(clEnqueueNDRangeKernel(queue, blockKernel, 2, nullptr, blocks,
+                               nullptr, 0, nullptr, nullptr),
+        "running the block count kernel");
+  check(clEnqueueReadBuffer(queue, blockCounts, CL_TRUE, 0,
+                            counts.size() * sizeof(cl_uint), counts.data(), 0,
+                            nullptr, nullptr),
+        "reading the block counts back");
+  LIFE_PROFILE_COUNT(kBytesCopied,
+                     (long long)(counts.size() * sizeof(cl_uint)));
+}
+
+/**
+ * Function: readTiles
+ * -------------------
+ * Reads the given tiles' liveness and ages back from the device into the
+ * host's copy of the board, along with their changed words if asked.
+ */
+void GpuLife::readTiles(const vector<int> &tiles, bool withChanges) const {
+  const size_t word = sizeof(uint64_t);
+  for (int tile : tiles) {
+    size_t firstRow = size_t(tile / tileCols) * kTileRows;
+    size_t firstWord = size_t(tile % tileCols) * kTileWords;
+    size_t region[3] = {
+        (min(firstWord + kTileWords, size_t(wordsPerRow)) - firstWord) * word,
+        min(firstRow + kTileRows, size_t(rows)) - firstRow, 1};
+    size_t paddedOrigin[3] = {(firstWord + 1) * word, firstRow + 1, 0};
+    size_t origin[3] = {firstWord * word, firstRow, 0};
+    check(clEnqueueReadBufferRect(queue, live, CL_FALSE, paddedOrigin, origin,
+                                  region, stride * word, 0,
+                                  wordsPerRow * word, 0, hostLive.data(), 0,
+                                  nullptr, nullptr),
+          "reading the board back");
+    if (withChanges) {
+      check(clEnqueueReadBufferRect(queue, changedWords, CL_FALSE, origin,
+                                    origin, region, wordsPerRow * word, 0,
+                                    wordsPerRow * word, 0, hostChanged.data(),
+                                    0, nullptr, nullptr),
+            "reading the changes back");
+    }
+    // each age plane is a slice
+    region[2] = kAgePlanes;
+    check(clEnqueueReadBufferRect(queue, ages, CL_FALSE, origin, origin,
+                                  region, wordsPerRow * word,
+                                  planeWords() * word, wordsPerRow * word,
+                                  planeWords() * word, hostAges.data(), 0,
+                                  nullptr, nullptr),
+          "reading the ages back");
+    tileFresh[tile] = 1;
+    LIFE_PROFILE_COUNT(kBytesCopied, (long long)(region[0] * region[1]) *
+                                         (kAgePlanes + 1 + withChanges));
+  }
+  check(clFinish(queue), "reading back from the device");
+}
+
+void GpuLife::readAllTiles() const {
+  vector<int> stale;
+  for (int tile = 0; tile < int(tileFresh.size()); ++tile) {
+    if (!tileFresh[tile])
+      stale.push_back(tile);
+  }
+  if (!stale.empty())
+    readTiles(stale, false);
+}
+
+bool GpuLife::setTorus(bool torus) {
+  if (this->torus && !torus) {
+    runHalo(live, false);
+    runHalo(nextLive, false);
+  }
+  this->torus = torus;
+  return true;
+}
+
+/**
+ * Function: runHalo
+ * -----------------
+ * Refills the padding around the board in the given buffer with the
+ * opposite edges if wrap is set, or empties it.
+ */
+void GpuLife::runHalo(cl_mem words, bool wrap) {
+  if (planeWords() == 0)
+    return;
+  cl_int wrapArg = wrap;
+  cl_ulong maskArg = lastWordMask;
+  clSetKernelArg(haloKernel, 0, sizeof(cl_mem), &words);
+  clSetKernelArg(haloKernel, 1, sizeof(int), &rows);
+  clSetKernelArg(haloKernel, 2, sizeof(int), &cols);
+  clSetKernelArg(haloKernel, 3, sizeof(int), &wordsPerRow);
+  clSetKernelArg(haloKernel, 4, sizeof(int), &stride);
+  clSetKernelArg(haloKernel, 5, sizeof(cl_ulong), &maskArg);
+  clSetKernelArg(haloKernel, 6, sizeof(cl_int), &wrapArg);
+  size_t global = rows;
+  check(clEnqueueNDRangeKernel(queue, haloKernel, 1, nullptr, &global,
+                               nullptr, 0, nullptr, nullptr),
+        "running the halo kernel");
+  // the padding rows are copied with their padding words, which fills the
+  // corners
+  const size_t rowBytes = stride * sizeof(uint64_t);
+  const size_t lastRow = size_t(rows) * rowBytes;
+  const size_t belowRow = size_t(rows + 1) * rowBytes;
+  if (wrap) {
+    check(clEnqueueCopyBuffer(queue, words, words, lastRow, 0, rowBytes, 0,
+                              nullptr, nullptr),
+          "wrapping the last row");
+    check(clEnqueueCopyBuffer(queue, words, words, rowBytes, belowRow,
+                              rowBytes, 0, nullptr, nullptr),
+          "wrapping the first row");
+  } else {
+    uint64_t zero = 0;
+    check(clEnqueueFillBuffer(queue, words, &zero, sizeof(zero), 0, rowBytes,
+                              0, nullptr, nullptr),
+          "clearing the top padding");
+    check(clEnqueueFillBuffer(queue, words, &zero, sizeof(zero), belowRow,
+                              rowBytes, 0, nullptr, nullptr),
+          "clearing the bottom padding");
+  }
+}
+
+bool GpuLife::step() {
+  LIFE_PROFILE_SCOPE(kPhaseStep);
+  ++generationCount;
+  changes.clear();
+  if (planeWords() == 0)
+    return false;
+  if (torus)
+    runHalo(live, true);
+
+  cl_ulong maskArg = lastWordMask;
+  cl_uint birth = lifeRule.birth;
+  cl_uint survival = lifeRule.survival;
+  clSetKernelArg(stepKernel, 0, sizeof(cl_mem), &live);
+  clSetKernelArg(stepKernel, 1, sizeof(cl_mem), &nextLive);
+  clSetKernelArg(stepKernel, 2, sizeof(cl_mem), &ages);
+  clSetKernelArg(stepKernel, 3, sizeof(cl_mem), &changedWords);
+  clSetKernelArg(stepKernel, 4, sizeof(int), &rows);
+  clSetKernelArg(stepKernel, 5, sizeof(int), &wordsPerRow);
+  clSetKernelArg(stepKernel, 6, sizeof(int), &stride);
+  clSetKernelArg(stepKernel, 7, sizeof(cl_ulong), &maskArg);
+  clSetKernelArg(stepKernel, 8, sizeof(cl_uint), &birth);
+  clSetKernelArg(stepKernel, 9, sizeof(cl_uint), &survival);
+  size_t cells[2] = {size_t(wordsPerRow), size_t(rows)};
+  check(clEnqueueNDRangeKernel(queue, stepKernel, 2, nullptr, cells, nullptr,
+                               0, nullptr, nullptr),
+        "running the step kernel");
+  swap(live, nextLive);
+
+  clSetKernelArg(summaryKernel, 0, sizeof(cl_mem), &live);
+  clSetKernelArg(summaryKernel, 1, sizeof(cl_mem), &changedWords);
+  clSetKernelArg(summaryKernel, 2, sizeof(cl_mem), &tileStats);
+  clSetKernelArg(summaryKernel, 3, sizeof(int), &rows);
+  clSetKernelArg(summaryKernel, 4, sizeof(int), &wordsPerRow);
+  clSetKernelArg(summaryKernel, 5, sizeof(int), &stride);
+  clSetKernelArg(summaryKernel, 6, sizeof(int), &tileCols);
+  size_t tiles[2] = {size_t(tileCols), size_t(tileRows)};
+  check(clEnqueueNDRangeKernel(queue, summaryKernel, 2, nullptr, tiles,
+                               nullptr, 0, nullptr, nullptr),
+        "running the summary kernel");
+  check(clEnqueueReadBuffer(queue, tileStats, CL_TRUE, 0,
+                            hostStats.size() * sizeof(cl_uint),
+                            hostStats.data(), 0, nullptr, nullptr),
+        "reading the tile sums back");
+  LIFE_PROFILE_COUNT(kCellsEvaluated, (long long)rows * cols);
+
+  livePopulation = 0;
+  vector<int> changedTiles;
+  for (int tile = 0; tile < int(tileFresh.size()); ++tile) {
+    livePopulation += hostStats[2 * tile];
+    if (hostStats[2 * tile + 1]) {
+      tileFresh[tile] = 0;
+      changedTiles.push_back(tile);
+    }
+  }
+  if (recordChanges) {
+    recordChangedCells(changedTiles);
+    LIFE_PROFILE_COUNT(kCellsChanged, (long long)changes.size());
+  }
+  return !changedTiles.empty();
+}
+
+/**
+ * Function: recordChangedCells
+ * ----------------------------
+ * Reads back the changed tiles that overlap the viewport and lists the
+ * changed cells in it.
+ */
+void GpuLife::recordChangedCells(const vector<int> &changedTiles) {
+  int viewBottom = viewTop + viewRows;
+  int viewRight = viewLeft + viewCols;
+  vector<int> visible;
+  for (int tile : changedTiles) {
+    int firstRow = tile / tileCols * kTileRows;
+    int firstCol = tile % tileCols * kTileWords * 64;
+    if (firstRow < viewBottom && firstRow + kTileRows > viewTop &&
+        firstCol < viewRight && firstCol + kTileWords * 64 > viewLeft)
+      visible.push_back(tile);
+  }
+  if (visible.empty())
+    return;
+  readTiles(visible, true);
+  for (int tile : visible) {
+    int firstRow = max(tile / tileCols * kTileRows, viewTop);
+    int lastRow = min((tile / tileCols + 1) * kTileRows, viewBottom);
+    int firstWord = tile % tileCols * kTileWords;
+    int lastWord = min(firstWord + kTileWords, wordsPerRow);
+    for (int row = firstRow; row < lastRow; ++row) {
+      for (int w = firstWord; w < lastWord; ++w) {
+        for (uint64_t bits = hostChanged[size_t(row) * wordsPerRow + w];
+             bits != 0; bits &= bits - 1) {
+          int col = w * 64 + countTrailingZeros(bits);
+          if (col >= viewLeft && col < viewRight)
+            changes.push_back({row, col, ageAt(row, col)});
+        }
+      }
+    }
+  }
+}
+#endif
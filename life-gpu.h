@@ -0,0 +1,166 @@
+/**
+ * File: life-gpu.h
+ * ----------------
+ * Defines a stepping engine that keeps the board on an OpenCL device, for
+ * boards so large that even the packed engine is bound by the host's memory
+ * bandwidth. The board is stored in the packed engine's layout, one bit per
+ * cell plus four age planes, and every generation is computed on the device
+ * a word per work item. Only the tiles the host asks about are read back.
+ *
+ * The engine is only built with LIFE_HAVE_OPENCL defined (qmake
+ * CONFIG+=opencl), which also links the OpenCL library.
+ */
+
+#pragma once
+#ifdef LIFE_HAVE_OPENCL
+#include "grid.h"        // for Grid
+#include "life-engine.h" // for LifeEngine
+#include <cstdint>       // for uint64_t
+#include <vector>        // for std::vector
+
+#define CL_TARGET_OPENCL_VERSION 120
+#ifdef __APPLE__
+#include <OpenCL/opencl.h>
+#else
+#include <CL/cl.h>
+#endif
+
+class GpuLife : public LifeEngine {
+public:
+  /**
+   * Constructs an empty engine on the first GPU found, or on the first
+   * OpenCL device of any kind if there is no GPU. Reports through error if
+   * there is no device or the kernels do not build. Call load before
+   * stepping.
+   */
+  GpuLife();
+  ~GpuLife() override;
+
+  /**
+   * Copies the board to the device. Ages above kMaxAge are stored as
+   * kMaxAge.
+   */
+  void load(const Grid<int> &grid) override;
+
+  /**
+   * Copies the pattern's bits to the device as they are, with every live
+   * cell at age 1.
+   */
+  void loadPattern(const PackedPattern &pattern) override;
+  void loadSnapshot(const SnapshotView &snapshot) override;
+
+  /**
+   * These read every tile that changed since it was last read back from
+   * the device first.
+   */
+  void exportPattern(PackedPattern &pattern) const override;
+  void exportSnapshot(SnapshotBuffer &snapshot) const override;
+
+  bool step() override;
+  void clear() override;
+
+  int numRows() const override { return rows; }
+  int numCols() const override { return cols; }
+
+  /**
+   * Reads the cell's tile back from the device if it changed since it was
+   * last read, so asking about cells the board has left alone is free.
+   */
+  int ageAt(int row, int col) const override;
+
+  /**
+   * The population is counted on the device by step, so this is free.
+   */
+  long long population() const override { return livePopulation; }
+
+  /**
+   * Counts the blocks on the device, a work item per block, and reads back
+   * only the counts, so no tile of the board comes back.
+   */
+  void countBlocks(const BoardView &view,
+                   std::vector<int> &counts) const override;
+
+  /**
+   * Limits the change list to the cells of the given rectangle, which is
+   * all that is read back after each step; the rest of the board stays on
+   * the device. By default the viewport is the whole board, which the cycle
+   * detector needs, since it hashes the change list. Loading a board resets
+   * it. The display sets it through followView (see life-simulation.h).
+   */
+  void setViewport(int top, int left, int numRows, int numCols);
+
+  /**
+   * Returns whether the viewport takes in the whole board, so the change
+   * list covers every cell that changed.
+   */
+  bool viewportCoversBoard() const {
+    return viewTop == 0 && viewLeft == 0 && viewRows == rows &&
+           viewCols == cols;
+  }
+
+  bool setTorus(bool torus) override;
+
+  static const int kAgePlanes = 4;  // enough bits to count up to kMaxAge
+  static const int kTileRows = 64;  // rows per tile
+  static const int kTileWords = 16; // words per tile row, 1024 columns
+
+private:
+  int rows;
+  int cols;
+  int wordsPerRow; // words holding real cells in each row
+  int stride;      // words per row including one padding word on each side
+  int tileRows;    // tiles down the board
+  int tileCols;    // tiles across the board
+  bool torus;
+  uint64_t lastWordMask; // the bits of the last word in a row that are cells
+  long long livePopulation;
+  int viewTop, viewLeft, viewRows, viewCols;
+
+  cl_context context;
+  cl_command_queue queue;
+  cl_program program;
+  cl_kernel haloKernel;
+  cl_kernel stepKernel;
+  cl_kernel summaryKernel;
+  cl_kernel blockKernel;
+
+  // Liveness is padded as in the packed engine, with one row above and
+  // below the board and one word to the left and right of each row; the
+  // age planes and the changed words are not. Each tile's population and
+  // whether any of its cells changed are summed into tileStats, two words
+  // per tile, which is all step reads back unless it records changes.
+  cl_mem live;
+  cl_mem nextLive;
+  cl_mem ages;
+  cl_mem changedWords;
+  cl_mem tileStats;
+  mutable cl_mem blockCounts; // countBlocks' results, kept between calls
+  mutable size_t blockCountCapacity;
+
+  // The host's copy of the board, unpadded. A tile's part of it is only up
+  // to date while its flag in tileFresh is set; step clears the flags of
+  // the tiles that changed, and ageAt reads those back when asked.
+  mutable std::vector<uint64_t> hostLive;
+  mutable std::vector<uint64_t> hostAges; // kAgePlanes planes, one by one
+  mutable std::vector<uint64_t> hostChanged;
+  mutable std::vector<uint8_t> tileFresh;
+  std::vector<cl_uint> hostStats;
+
+  int tileOf(int row, int col) const {
+    return (row / kTileRows) * tileCols + col / 64 / kTileWords;
+  }
+  size_t planeWords() const { return size_t(rows) * wordsPerRow; }
+
+  void resize(int numRows, int numCols);
+  void releaseBuffers();
+  void releaseDevice();
+  void runHalo(cl_mem words, bool wrap);
+  void uploadBoard();
+  void readTiles(const std::vector<int> &tiles, bool withChanges) const;
+  void readAllTiles() const;
+  void recordChangedCells(const std::vector<int> &changedTiles);
+
+  GpuLife(const GpuLife &original);
+  void operator=(const GpuLife &rhs) const;
+};
+#endif
@@ -7,24 +7,38 @@
  * welcome to read over this code, but you will not need to edit it unless
  * you're attempting some sort of fancy extension.
  *
+ * Cells are rasterized straight into a single pixel buffer the size of the
+ * canvas, which is handed to the window once per repaint. There is no
+ * graphical object per cell, so boards of any size cost the same to set up.
+ * Only the cells in view are drawn, and when they would be smaller than a
+ * pixel each pixel shows a block of them instead, so the work and memory
+ * per frame are bounded by the window, not by the board.
+ *
  * This is based on a previous implementation by Julie Zelenski.
  */
 
-#include <iomanip> // for setw, setfill
-#include <ios>     // for hex stream manipulator
-#include <sstream> // for ostringstream
+#include <algorithm> // for min, max
+#include <cmath>     // for ceil, floor, ldexp
+#include <iostream>  // for cout
 using namespace std;
-#include "error.h" // for error
-#include "gthread.h"
+#include "error.h"  // for error
 #include "random.h" // for randomInteger
 #include "strlib.h" // for integerToString
 
 #include "life-constants.h"
 #include "life-graphics.h"
+#include "life-profile.h" // for LIFE_PROFILE_SCOPE
 const string LifeDisplay::kDefaultWindowTitle("Game of Life");
 const double kWindowPadding = 5; // Margin from border of window to content area
 
-LifeDisplay::LifeDisplay() : window(kDisplayWidth, kDisplayHeight) {
+static const int kWhite = 0xffffff;
+static const int kBlack = 0x000000;
+
+LifeDisplay::LifeDisplay()
+    : window(kDisplayWidth, kDisplayHeight), numRows(0), numColumns(0),
+      zoom(0), viewCenterRow(0), viewCenterColumn(0), shown{0, 0, 0, 0, 1},
+      pixelsDirty(false), consoleOutput(false), consoleInterval(1),
+      lastPrinted(-1), viewTop(0), viewLeft(0), viewRows(0), viewColumns(0) {
   initializeColors();
   window.setVisible(true);
   window.setWindowTitle(kDefaultWindowTitle);
@@ -33,27 +47,7 @@ LifeDisplay::LifeDisplay() : window(kDisplayWidth, kDisplayHeight) {
   window.setExitOnClose(true);
 }
 
-LifeDisplay::~LifeDisplay() {
-  cells.clear();
-  window.close();
-}
-
-void LifeDisplay::fillCellGrid() {
-  cells.clear();
-  cells.resize(numRows, numColumns);
-  GThread::runOnQtGuiThread([&, this] {
-    for (int r = 0; r < numRows; ++r) {
-      for (int c = 0; c < numColumns; ++c) {
-        cells[r][c] = new GOval(upperLeftX + c * cellDiameter + 1,
-                                upperLeftY + r * cellDiameter + 1,
-                                cellDiameter - 2, cellDiameter - 2);
-        cells[r][c]->setVisible(false);
-        window.add(cells[r][c]); // ownership of memory has been transferred
-                                 // over to window.
-      }
-    }
-  });
-}
+LifeDisplay::~LifeDisplay() { window.close(); }
 
 void LifeDisplay::setDimensions(int numRows, int numColumns) {
   if (numRows <= 0 || numColumns <= 0) {
@@ -63,16 +57,53 @@ void LifeDisplay::setDimensions(int numRows, int numColumns) {
 
   this->numRows = numRows;
   this->numColumns = numColumns;
-  ages.resize(numRows, numColumns);
+  zoom = 0;
+  viewCenterRow = numRows / 2;
+  viewCenterColumn = numColumns / 2;
   computeGeometry();
-  window.clear();
-  fillCellGrid();
+  clearCanvas();
+}
 
-  window.setColor("White");
-  window.fillRect(0, 0, kDisplayWidth, kDisplayHeight);
-  window.setColor("Black");
-  window.drawRect(upperLeftX, upperLeftY, numColumns * cellDiameter + 1,
-                  numRows * cellDiameter + 1);
+void LifeDisplay::setZoom(int level, int centerRow, int centerColumn) {
+  if (numRows == 0)
+    return;
+  zoom = max(0, min(level, maxZoom()));
+  viewCenterRow = max(0, min(centerRow, numRows - 1));
+  viewCenterColumn = max(0, min(centerColumn, numColumns - 1));
+  computeGeometry();
+  clearCanvas();
+}
+
+int LifeDisplay::maxZoom() const {
+  if (numRows == 0)
+    return 0;
+  int level = 0;
+  while (ldexp(fitDiameter(), level + 1) <= kMaxCellDiameter) {
+    ++level;
+  }
+  return level;
+}
+
+void LifeDisplay::clearCanvas() {
+  ages.resize(shown.rows, shown.cols);
+
+  // one allocation per resize: a white canvas with a black border around
+  // the simulation rectangle
+  int width = int(window.getCanvasWidth());
+  int height = int(window.getCanvasHeight());
+  pixels.resize(height, width);
+  fillPixels(0, 0, width, height, kWhite);
+  int left = int(floor(upperLeftX));
+  int top = int(floor(upperLeftY));
+  int right = min(int(floor(upperLeftX + shown.cols * cellDiameter)) + 1,
+                  width - 1);
+  int bottom =
+      min(int(floor(upperLeftY + shown.rows * cellDiameter)) + 1, height - 1);
+  fillPixels(left, top, right + 1, top + 1, kBlack);
+  fillPixels(left, bottom, right + 1, bottom + 1, kBlack);
+  fillPixels(left, top, left + 1, bottom + 1, kBlack);
+  fillPixels(right, top, right + 1, bottom + 1, kBlack);
+  pixelsDirty = true;
 }
 
 void LifeDisplay::setTitle(const string &title) {
@@ -93,17 +124,101 @@ void LifeDisplay::drawCellAt(int row, int column, int age) {
           integerToString(column) + ").");
   }
 
+  // the view's own coordinates
+  row -= shown.top;
+  column -= shown.left;
+  if (shown.blockSize != 1 || row < 0 || row >= shown.rows || column < 0 ||
+      column >= shown.cols)
+    return;
   age = min(age, kMaxAge);
-  if (age == 0) {
-    cells[row][column]->setVisible(false);
-  } else {
-    cells[row][column]->setColor(colors[age]);
-    cells[row][column]->setFillColor(colors[age]);
-    cells[row][column]->setVisible(true);
-  }
+  if (ages[row][column] == age)
+    return; // already drawn in this shade
+  paintCell(row, column, colors[age]);
   ages[row][column] = age;
 }
 
+void LifeDisplay::drawBlocks(const vector<int> &counts) {
+  LIFE_PROFILE_SCOPE(kPhaseDraw);
+  if (shown.blockSize == 1 || counts.size() != size_t(shown.rows) * shown.cols)
+    error(string(__FUNCTION__) + " needs one count for every block of a " +
+          "zoomed-out view.");
+  int size = shown.blockSize;
+  for (int i = 0; i < shown.rows; ++i) {
+    int top = shown.top + i * size;
+    int height = min(top + size, numRows) - top;
+    for (int j = 0; j < shown.cols; ++j) {
+      int left = shown.left + j * size;
+      int cells = height * (min(left + size, numColumns) - left);
+      int count = counts[size_t(i) * shown.cols + j];
+      // any live cell shows, however sparse the block
+      int shade = count <= 0 ? 0
+                             : max(1, min(int(ceil(double(count) *
+                                                   kDensityShades / cells)),
+                                          int(kDensityShades)));
+      if (ages[i][j] == shade)
+        continue;
+      paintCell(i, j, densityColors[shade]);
+      ages[i][j] = shade;
+    }
+  }
+}
+
+void LifeDisplay::drawCells(const vector<CellUpdate> &updates) {
+  LIFE_PROFILE_SCOPE(kPhaseDraw);
+  for (const CellUpdate &update : updates) {
+    drawCellAt(update.row, update.col, update.age);
+  }
+}
+
+void LifeDisplay::repaint() {
+  LIFE_PROFILE_SCOPE(kPhaseRepaint);
+  if (pixelsDirty) {
+    window.setPixels(pixels);
+    pixelsDirty = false;
+  }
+  window.repaint();
+}
+
+void LifeDisplay::fillPixels(int left, int top, int right, int bottom,
+                             int rgb) {
+  for (int y = max(top, 0); y < min(bottom, pixels.numRows()); ++y) {
+    for (int x = max(left, 0); x < min(right, pixels.numCols()); ++x) {
+      pixels[y][x] = rgb;
+    }
+  }
+}
+
+void LifeDisplay::paintCell(int row, int column, int rgb) {
+  // the cell's pixel square; cells smaller than a pixel still get one, and
+  // the last one drawn wins
+  int left = int(floor(upperLeftX + column * cellDiameter)) + 1;
+  int top = int(floor(upperLeftY + row * cellDiameter)) + 1;
+  int right = max(int(floor(upperLeftX + (column + 1) * cellDiameter)) + 1,
+                  left + 1);
+  int bottom =
+      max(int(floor(upperLeftY + (row + 1) * cellDiameter)) + 1, top + 1);
+  pixelsDirty = true;
+  if (right - left < 4 || rgb == colors[0]) {
+    fillPixels(left, top, right, bottom, rgb);
+    return;
+  }
+
+  // big enough to show as a dot, inset by a pixel like the cells always were
+  fillPixels(left, top, right, bottom, colors[0]);
+  double centerX = (left + right) / 2.0;
+  double centerY = (top + bottom) / 2.0;
+  double radiusX = (right - left) / 2.0 - 1;
+  double radiusY = (bottom - top) / 2.0 - 1;
+  for (int y = top; y < bottom; ++y) {
+    for (int x = left; x < right; ++x) {
+      double dx = (x + 0.5 - centerX) / radiusX;
+      double dy = (y + 0.5 - centerY) / radiusY;
+      if (dx * dx + dy * dy <= 1)
+        pixels[y][x] = rgb;
+    }
+  }
+}
+
 int LifeDisplay::scalePrimaryColor(int baseContribution, int age) const {
   const int maxContribution = 220;
   int remaining = maxContribution - baseContribution;
@@ -112,41 +227,126 @@ int LifeDisplay::scalePrimaryColor(int baseContribution, int age) const {
 }
 
 void LifeDisplay::initializeColors() {
-  colors.add("White"); // colors[0] is used for age 0, and is always white
+  colors.add(kWhite); // colors[0] is used for age 0, and is always white
   int baseColor[] = {randomInteger(0, 192), randomInteger(0, 192),
                      randomInteger(0, 192)};
 
   for (int age = 1; age <= kMaxAge; age++) {
-    ostringstream oss;
-    oss << "#";
+    int rgb = 0;
     for (int primary = 0; primary < 3; primary++) {
-      int contribution = scalePrimaryColor(baseColor[primary], age);
-      oss << setw(2) << setfill('0') << hex << contribution;
+      rgb = (rgb << 8) | scalePrimaryColor(baseColor[primary], age);
     }
-    colors.add(oss.str());
+    colors.add(rgb);
+  }
+
+  // blocks fade from white to the newborn shade as they fill up
+  for (int shade = 0; shade <= kDensityShades; ++shade) {
+    int rgb = 0;
+    for (int shift = 16; shift >= 0; shift -= 8) {
+      int full = (colors[1] >> shift) & 0xff;
+      rgb = (rgb << 8) | (0xff + (full - 0xff) * shade / kDensityShades);
+    }
+    densityColors.add(rgb);
   }
 }
 
-void LifeDisplay::computeGeometry() {
+double LifeDisplay::fitDiameter() const {
   double width = window.getCanvasWidth() - 2 * kWindowPadding;
   double height = window.getCanvasHeight() - 2 * kWindowPadding;
   double hPixelsPerCell = height / numRows;
   double wPixelsPerCell = width / numColumns;
-  cellDiameter = min(wPixelsPerCell, hPixelsPerCell);
-  upperLeftX = kWindowPadding + (width - numColumns * cellDiameter) / 2;
-  upperLeftY = kWindowPadding + (height - numRows * cellDiameter) / 2;
+  return min(wPixelsPerCell, hPixelsPerCell);
+}
+
+void LifeDisplay::computeGeometry() {
+  double width = window.getCanvasWidth() - 2 * kWindowPadding;
+  double height = window.getCanvasHeight() - 2 * kWindowPadding;
+  double diameter = ldexp(fitDiameter(), zoom);
+  // past a pixel per cell, a pixel shows a block of cells
+  shown.blockSize = diameter >= 1 ? 1 : int(ceil(1 / diameter));
+  cellDiameter = max(diameter, 1.0);
+  int blocksDown = (numRows + shown.blockSize - 1) / shown.blockSize;
+  int blocksAcross = (numColumns + shown.blockSize - 1) / shown.blockSize;
+  // the slack keeps rounding from dropping the last row of a board that
+  // fits exactly
+  shown.rows = min(blocksDown, int(height / cellDiameter + 1e-9));
+  shown.cols = min(blocksAcross, int(width / cellDiameter + 1e-9));
+
+  int spanRows = shown.rows * shown.blockSize;
+  int spanColumns = shown.cols * shown.blockSize;
+  shown.top = max(0, min(viewCenterRow - spanRows / 2, numRows - spanRows));
+  shown.left = max(0, min(viewCenterColumn - spanColumns / 2,
+                          numColumns - spanColumns));
+  // blocks stay on multiples of their size, so panning moves whole blocks
+  shown.top -= shown.top % shown.blockSize;
+  shown.left -= shown.left % shown.blockSize;
+  upperLeftX = kWindowPadding + (width - shown.cols * cellDiameter) / 2;
+  upperLeftY = kWindowPadding + (height - shown.rows * cellDiameter) / 2;
 }
 
 bool LifeDisplay::coordinateInRange(int row, int column) const {
   return row >= 0 && row < numRows && column >= 0 && column < numColumns;
 }
 
+void LifeDisplay::setConsoleOutput(bool enabled, int interval) {
+  consoleOutput = enabled;
+  consoleInterval = max(interval, 1);
+  lastPrinted = -1;
+}
+
+void LifeDisplay::setConsoleViewport(int top, int left, int numRows,
+                                     int numColumns) {
+  viewTop = max(top, 0);
+  viewLeft = max(left, 0);
+  viewRows = max(numRows, 0);
+  viewColumns = max(numColumns, 0);
+}
+
+void LifeDisplay::printGeneration(long long generation) {
+  if (!consoleOutput)
+    return;
+  // frames may be dropped, so the interval is a minimum gap rather than a
+  // multiple; going back in time means a new board was loaded
+  if (lastPrinted >= 0 && generation >= lastPrinted &&
+      generation - lastPrinted < consoleInterval)
+    return;
+  lastPrinted = generation;
+  printBoard();
+}
+
+static_assert(kMaxAge < 100 && LifeDisplay::kDensityShades < 100,
+              "printBoard prints ages and shades as two digits");
+
 void LifeDisplay::printBoard() {
-  cout << windowTitle << endl;
-  for (int i = 0; i < numRows; ++i) {
-    for (int j = 0; j < numColumns; ++j) {
-      cout << setw(3) << setfill(' ') << ages[i][j];
+  LIFE_PROFILE_SCOPE(kPhasePrint);
+  int top = 0, left = 0, bottom = shown.rows, right = shown.cols;
+  if (viewRows > 0 && viewColumns > 0) {
+    // the cells or blocks in view that overlap the console viewport
+    int size = shown.blockSize;
+    top = min(max(viewTop - shown.top, 0) / size, shown.rows);
+    left = min(max(viewLeft - shown.left, 0) / size, shown.cols);
+    bottom = max(min((viewTop + viewRows - shown.top + size - 1) / size,
+                     shown.rows),
+                 top);
+    right = max(min((viewLeft + viewColumns - shown.left + size - 1) / size,
+                    shown.cols),
+                left);
+  }
+  // every age is at most two digits, printed right-aligned in three columns
+  consoleBuffer.clear();
+  consoleBuffer.reserve(windowTitle.size() + 1 +
+                        size_t(bottom - top) * ((right - left) * 3 + 1));
+  consoleBuffer += windowTitle;
+  consoleBuffer += '\n';
+  for (int i = top; i < bottom; ++i) {
+    for (int j = left; j < right; ++j) {
+      int age = ages[i][j];
+      consoleBuffer += ' ';
+      consoleBuffer += age >= 10 ? char('0' + age / 10) : ' ';
+      consoleBuffer += char('0' + age % 10);
     }
-    cout << endl;
+    consoleBuffer += '\n';
   }
+  cout.write(consoleBuffer.data(), consoleBuffer.size());
+  cout.flush();
 }
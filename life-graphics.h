@@ -6,10 +6,12 @@
  */
 
 #pragma once
-#include "grid.h"    // for Grid
-#include "gwindow.h" // for GWindow
-#include "vector.h"  // for Vector
-#include <string>    // for std::string
+#include "grid.h"           // for Grid
+#include "gwindow.h"        // for GWindow
+#include "life-constants.h" // for CellUpdate, BoardView
+#include "vector.h"         // for Vector
+#include <string>           // for std::string
+#include <vector>           // for std::vector
 
 class LifeDisplay {
 public:
@@ -35,9 +37,31 @@ public:
    * the grid geometry. Grids with more rows and columns will use smaller
    * cells. This function can be used at the beginning of a simulation or
    * between generations to clear the window before drawing the next generation.
+   * The zoom is reset so that the whole board is shown.
    */
   void setDimensions(int rows, int cols);
 
+  /**
+   * Zooms to the given level, centered as near the given cell as the edges
+   * of the board allow. Level 0 fits the whole board in the window, and
+   * each level up doubles the size of a cell, up to maxZoom. When a cell is
+   * smaller than a pixel, each pixel shows a block of cells, shaded by how
+   * many of them are alive (see drawBlocks), so drawing costs at most one
+   * cell or block per pixel however large the board is.
+   *
+   * The canvas is cleared, so the caller draws the new view afterwards.
+   */
+  void setZoom(int level, int centerRow, int centerColumn);
+  int zoomLevel() const { return zoom; }
+  int maxZoom() const;
+  int centerRow() const { return viewCenterRow; }
+  int centerColumn() const { return viewCenterColumn; }
+
+  /**
+   * Returns the part of the board on screen.
+   */
+  const BoardView &view() const { return shown; }
+
   /**
    * Draws the cell at the specific row and column, replacing any previously
    * drawn cell at that location.  Rows and columns are specified using
@@ -54,17 +78,40 @@ public:
    * Note that this function does not directly repaint the graphical window.
    * display.repaint() must be called separately by the client to show updates
    * to the GUI.
+   *
+   * Cells outside the view, and every cell while the view shows blocks, are
+   * not on screen and are skipped.
    */
   void drawCellAt(int row, int column, int age);
 
   /**
-   * Repaints the graphics window.
+   * Draws every cell in the given list as drawCellAt would. Cells whose age
+   * is already on screen are skipped, so passing only the cells that changed
+   * since the last generation makes drawing cost proportional to the number
+   * of changes.
+   */
+  void drawCells(const std::vector<CellUpdate> &updates);
+
+  /**
+   * Shades every block of the view by the fraction of its cells that are
+   * alive, given the live cells of each block row by row as
+   * LifeEngine::countBlocks counts them. Blocks already on screen in the
+   * same shade are skipped.
+   */
+  void drawBlocks(const std::vector<int> &counts);
+
+  /**
+   * Repaints the graphics window, first copying the cells drawn since the
+   * last repaint onto the canvas in a single transfer.
    */
-  void repaint() { window.repaint(); }
+  void repaint();
 
   /**
-   * Prints the current board with ages. Used for debugging and for
-   * text-only versions of the program.
+   * Prints the cells on screen with ages, or only those in the console
+   * viewport if one is set; a zoomed-out view prints the shade of each
+   * block instead, from 0 for empty to kDensityShades for full. Used for
+   * debugging and for text-only versions of the program. The whole board is
+   * formatted into one buffer and written at once.
    *
    * Example output:
    *                    Game of Life
@@ -75,26 +122,65 @@ public:
    */
   void printBoard();
 
+  /**
+   * Prints the board as printBoard does if console output is on and at least
+   * the console interval has passed since the last generation printed, and
+   * does nothing otherwise. The animation calls this after every frame.
+   */
+  void printGeneration(long long generation);
+
+  /**
+   * Turns printing from printGeneration on or off; it starts off, since
+   * printing a large board costs far more than stepping it. When on, the
+   * board is printed at most once every interval generations.
+   */
+  void setConsoleOutput(bool enabled, int interval = 1);
+
+  /**
+   * Limits printing to the numRows x numColumns cells with the given upper
+   * left corner, clipped to the view. A viewport with no rows or columns
+   * prints the whole view, which is the default.
+   */
+  void setConsoleViewport(int top, int left, int numRows, int numColumns);
+
+  static const int kDensityShades = 16; // shades of a block, past empty
+
 private:
   GWindow window;
   int numRows;
   int numColumns;
+  int zoom;
+  int viewCenterRow;
+  int viewCenterColumn;
+  BoardView shown;
   double upperLeftX;
   double upperLeftY;
-  double cellDiameter;
-  Vector<std::string> colors;
+  double cellDiameter; // pixels per cell, or per block of a zoomed-out view
+  Vector<int> colors;  // RGB shade for each age, white for age 0
+  Vector<int> densityColors; // RGB shade for each block density, white for 0
   std::string windowTitle;
-  Grid<int> ages;
-  Grid<GOval *> cells; // to avoid redrawing duplicate cells
+  Grid<int> ages;   // what the view shows, ages or block shades, to avoid
+                    // redrawing duplicate cells
+  Grid<int> pixels; // the whole canvas as RGB values, row by row
+  bool pixelsDirty; // whether pixels changed since the last repaint
+  bool consoleOutput;
+  int consoleInterval;
+  long long lastPrinted; // the generation printBoard last printed, or -1
+  int viewTop, viewLeft, viewRows, viewColumns; // the console viewport
+  std::string consoleBuffer; // reused for every print
 
   static const std::string kDefaultWindowTitle;
   static const int kDisplayWidth = 10 * 72; // 10 inches
   static const int kDisplayHeight = 7 * 72; // 7 inches
+  static const int kMaxCellDiameter = 64;   // pixels, the most zoomed in
 
   void initializeColors();
-  void fillCellGrid();
+  void fillPixels(int left, int top, int right, int bottom, int rgb);
+  void paintCell(int row, int column, int rgb);
   int scalePrimaryColor(int baseContribution, int age) const;
   void computeGeometry();
+  double fitDiameter() const;
+  void clearCanvas();
   bool coordinateInRange(int row, int column) const;
 
   LifeDisplay(const LifeDisplay &original);
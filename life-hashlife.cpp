@@ -0,0 +1,623 @@
+/**
+ * File: life-hashlife.cpp
+ * -----------------------
+ * Implements the HashLife engine. A node of level L covers 2^L x 2^L cells
+ * centered on its own origin, and its memoized result is its center quarter
+ * (level L-1) advanced 2^(L-2) generations. Smaller steps of 2^k take the
+ * centers of the nine overlapping subnodes without advancing them, so only
+ * the top levels of the tree ever see anything other than full-speed steps.
+ *
+ * The root always covers the square from -2^(L-1) to 2^(L-1) on both axes,
+ * and board cell (row, col) sits at x = originX + col, y = originY + row.
+ * Boards loaded from grids have their origin at (0, 0).
+ */
+
+#include <algorithm>  // for max, min
+#include <fstream>    // for ofstream
+#include <functional> // for hash
+#include <sstream>    // for istringstream
+using namespace std;
+
+#include "error.h"  // for error
+#include "strlib.h" // for trim
+
+#include "life-constants.h"   // for kMaxAge
+#include "life-hashlife.h"
+#include "life-mapped-file.h" // for class MappedFile
+#include "life-profile.h"     // for LIFE_PROFILE_SCOPE
+#include "life-rules.h"       // for nextAlive, parseFileRule, ruleString
+
+static const int kMinLevel = 3;
+
+size_t HashLife::NodeKeyHash::operator()(const NodeKey &key) const {
+  size_t h = 0;
+  for (Node *quadrant : {key.nw, key.ne, key.sw, key.se}) {
+    h ^= hash<Node *>()(quadrant) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+  }
+  return h;
+}
+
+HashLife::HashLife()
+    : rows(0), cols(0), originX(0), originY(0),
+      deadCell{nullptr, nullptr, nullptr, nullptr, 0, 0, nullptr, nullptr, -1},
+      liveCell{nullptr, nullptr, nullptr, nullptr, 0, 1, nullptr, nullptr, -1},
+      root(nullptr) {
+  root = emptyNode(kMinLevel);
+}
+
+HashLife::Node *HashLife::join(Node *nw, Node *ne, Node *sw, Node *se) {
+  NodeKey key{nw, ne, sw, se};
+  auto found = table.find(key);
+  if (found != table.end())
+    return found->second;
+  long long population =
+      nw->population + ne->population + sw->population + se->population;
+  nodes.push_back(
+      Node{nw, ne, sw, se, nw->level + 1, population, nullptr, nullptr, -1});
+  Node *node = &nodes.back();
+  table.emplace(key, node);
+  return node;
+}
+
+HashLife::Node *HashLife::emptyNode(int level) {
+  if (emptyNodes.empty())
+    emptyNodes.push_back(&deadCell);
+  while (int(emptyNodes.size()) <= level) {
+    Node *smaller = emptyNodes.back();
+    emptyNodes.push_back(join(smaller, smaller, smaller, smaller));
+  }
+  return emptyNodes[level];
+}
+
+HashLife::Node *HashLife::centre(Node *node) {
+  return join(node->nw->se, node->ne->sw, node->sw->ne, node->se->nw);
+}
+
+HashLife::Node *HashLife::expand(Node *node) {
+  Node *empty = emptyNode(node->level - 1);
+  return join(join(empty, empty, empty, node->nw),
+              join(empty, empty, node->ne, empty),
+              join(empty, node->sw, empty, empty),
+              join(node->se, empty, empty, empty));
+}
+
+HashLife::Node *HashLife::baseCase(Node *node) {
+  // gather the 4x4 cells into bit y * 4 + x
+  int bits = 0;
+  const Node *quadrants[] = {node->nw, node->ne, node->sw, node->se};
+  for (int q = 0; q < 4; ++q) {
+    int x = (q % 2) * 2;
+    int y = (q / 2) * 2;
+    const Node *quad = quadrants[q];
+    bits |= int(quad->nw->population) << (y * 4 + x);
+    bits |= int(quad->ne->population) << (y * 4 + x + 1);
+    bits |= int(quad->sw->population) << ((y + 1) * 4 + x);
+    bits |= int(quad->se->population) << ((y + 1) * 4 + x + 1);
+  }
+
+  Node *centerCells[4];
+  for (int i = 0; i < 4; ++i) {
+    int x = 1 + i % 2;
+    int y = 1 + i / 2;
+    int numNeighborCell = 0;
+    for (int dy = -1; dy <= 1; ++dy) {
+      for (int dx = -1; dx <= 1; ++dx) {
+        if (dx != 0 || dy != 0)
+          numNeighborCell += (bits >> ((y + dy) * 4 + x + dx)) & 1;
+      }
+    }
+    int isAlive = (bits >> (y * 4 + x)) & 1;
+    bool survives = nextAlive(MaskRule(lifeRule), isAlive, numNeighborCell);
+    centerCells[i] = survives ? &liveCell : &deadCell;
+  }
+  return join(centerCells[0], centerCells[1], centerCells[2], centerCells[3]);
+}
+
+HashLife::Node *HashLife::successor(Node *node, int stepLog) {
+  if (node->population == 0)
+    return emptyNode(node->level - 1);
+  bool fullSpeed = stepLog == node->level - 2;
+  if (fullSpeed && node->result)
+    return node->result;
+  if (!fullSpeed && node->stepLog == stepLog)
+    return node->stepResult;
+
+  Node *result;
+  if (node->level == 2) {
+    result = baseCase(node);
+  } else {
+    // the nine overlapping subnodes of the next level down
+    Node *parts[9] = {
+        node->nw,
+        join(node->nw->ne, node->ne->nw, node->nw->se, node->ne->sw),
+        node->ne,
+        join(node->nw->sw, node->nw->se, node->sw->nw, node->sw->ne),
+        centre(node),
+        join(node->ne->sw, node->ne->se, node->se->nw, node->se->ne),
+        node->sw,
+        join(node->sw->ne, node->se->nw, node->sw->se, node->se->sw),
+        node->se,
+    };
+    // at full speed both halves of the step advance the clock; otherwise
+    // only the second half does
+    for (Node *&part : parts) {
+      part = fullSpeed ? successor(part, stepLog - 1) : centre(part);
+    }
+    int nextLog = fullSpeed ? stepLog - 1 : stepLog;
+    result = join(
+        successor(join(parts[0], parts[1], parts[3], parts[4]), nextLog),
+        successor(join(parts[1], parts[2], parts[4], parts[5]), nextLog),
+        successor(join(parts[3], parts[4], parts[6], parts[7]), nextLog),
+        successor(join(parts[4], parts[5], parts[7], parts[8]), nextLog));
+  }
+
+  if (fullSpeed) {
+    node->result = result;
+  } else {
+    node->stepResult = result;
+    node->stepLog = stepLog;
+  }
+  return result;
+}
+
+/**
+ * Builds the node of the given level whose top-left cell is (x, y) in the
+ * coordinates of a height x width source of cells, read through isAlive.
+ */
+template <typename IsAlive>
+HashLife::Node *HashLife::build(const IsAlive &isAlive, int height, int width,
+                                int level, long long x, long long y) {
+  long long size = 1LL << level;
+  if (x >= width || y >= height || x + size <= 0 || y + size <= 0)
+    return emptyNode(level);
+  if (level == 0)
+    return isAlive(int(y), int(x)) ? &liveCell : &deadCell;
+  long long half = size / 2;
+  --level;
+  return join(build(isAlive, height, width, level, x, y),
+              build(isAlive, height, width, level, x + half, y),
+              build(isAlive, height, width, level, x, y + half),
+              build(isAlive, height, width, level, x + half, y + half));
+}
+
+HashLife::Node *HashLife::copyNode(Node *node,
+                                   unordered_map<Node *, Node *> &copies) {
+  if (node->level == 0)
+    return node;
+  auto found = copies.find(node);
+  if (found != copies.end())
+    return found->second;
+  Node *copy = join(copyNode(node->nw, copies), copyNode(node->ne, copies),
+                    copyNode(node->sw, copies), copyNode(node->se, copies));
+  copies.emplace(node, copy);
+  return copy;
+}
+
+void HashLife::collectGarbage() {
+  // rebuild the tree under the root into fresh storage; everything else,
+  // memoized results included, is dropped with the old storage
+  deque<Node> oldNodes;
+  oldNodes.swap(nodes);
+  table.clear();
+  emptyNodes.clear();
+  unordered_map<Node *, Node *> copies;
+  root = copyNode(root, copies);
+}
+
+void HashLife::resizeBoard(int numRows, int numCols, long long x,
+                           long long y) {
+  rows = numRows;
+  cols = numCols;
+  originX = x;
+  originY = y;
+  ages.assign(size_t(rows) * cols, 0);
+  alive.assign(size_t(rows) * cols, 0);
+}
+
+void HashLife::resetTree() {
+  generationCount = 0;
+  nodes.clear();
+  table.clear();
+  emptyNodes.clear();
+}
+
+/**
+ * Returns the smallest level, at least kMinLevel, whose root centered on
+ * the origin covers a board of the given size placed at the origin.
+ */
+static int levelCovering(int rows, int cols) {
+  int level = kMinLevel;
+  while ((1LL << (level - 1)) < max(rows, cols)) {
+    ++level;
+  }
+  return level;
+}
+
+void HashLife::loadPattern(const PackedPattern &pattern) {
+  resetTree();
+  resizeBoard(pattern.rows, pattern.cols, 0, 0);
+  int level = levelCovering(rows, cols);
+  long long half = 1LL << (level - 1);
+  root = build([&](int row, int col) { return pattern.isAlive(row, col); },
+               rows, cols, level, -half, -half);
+  shrinkRoot();
+  resetAges();
+}
+
+void HashLife::load(const Grid<int> &grid) {
+  resetTree();
+  resizeBoard(grid.numRows(), grid.numCols(), 0, 0);
+  int level = levelCovering(rows, cols);
+  long long half = 1LL << (level - 1);
+  root = build([&](int row, int col) { return grid[row][col] > 0; }, rows,
+               cols, level, -half, -half);
+  shrinkRoot();
+
+  for (int row = 0; row < rows; ++row) {
+    for (int col = 0; col < cols; ++col) {
+      ages[row * cols + col] = uint8_t(max(min(grid[row][col], kMaxAge), 0));
+    }
+  }
+}
+
+void HashLife::setRule(const LifeRule &rule) {
+  LifeEngine::setRule(rule);
+  // every memoized future was computed under the old rule
+  for (Node &node : nodes) {
+    node.result = nullptr;
+    node.stepResult = nullptr;
+    node.stepLog = -1;
+  }
+}
+
+void HashLife::clear() {
+  root = emptyNode(kMinLevel);
+  fill(ages.begin(), ages.end(), 0);
+}
+
+long long HashLife::population() const { return root->population; }
+
+void HashLife::shrinkRoot() {
+  // keep the root as small as its cells allow, so equal universes always
+  // have the same root node
+  while (root->level > kMinLevel &&
+         centre(root)->population == root->population) {
+    root = centre(root);
+  }
+}
+
+void HashLife::jumpPowerOfTwo(int stepLog) {
+  // cells spread at most one cell per generation, so once every live cell
+  // is inside the center quarter of a root at least stepLog + 3 levels deep
+  // none of them can leave the root's center during the jump
+  while (root->level < stepLog + 3 ||
+         centre(centre(root))->population != root->population) {
+    root = expand(root);
+  }
+  root = successor(root, stepLog);
+  while (root->level < kMinLevel) {
+    root = expand(root);
+  }
+  shrinkRoot();
+  generationCount += 1LL << stepLog;
+}
+
+void HashLife::readNode(const Node *node, long long x, long long y) {
+  long long size = 1LL << node->level;
+  if (node->population == 0 || x >= originX + cols || y >= originY + rows ||
+      x + size <= originX || y + size <= originY)
+    return;
+  if (node->level == 0) {
+    alive[(y - originY) * cols + (x - originX)] = 1;
+    return;
+  }
+  long long half = size / 2;
+  readNode(node->nw, x, y);
+  readNode(node->ne, x + half, y);
+  readNode(node->sw, x, y + half);
+  readNode(node->se, x + half, y + half);
+}
+
+void HashLife::countNode(const Node *node, long long x, long long y,
+                         const BoardView &view, const Bounds &clip,
+                         vector<int> &counts) const {
+  long long size = 1LL << node->level;
+  if (node->population == 0 || x > clip.maxX || y > clip.maxY ||
+      x + size <= clip.minX || y + size <= clip.minY)
+    return;
+  // plane coordinates relative to the view's upper left cell
+  long long left = x - originX - view.left;
+  long long top = y - originY - view.top;
+  bool inside = x >= clip.minX && x + size - 1 <= clip.maxX &&
+                y >= clip.minY && y + size - 1 <= clip.maxY;
+  if (inside && left / view.blockSize == (left + size - 1) / view.blockSize &&
+      top / view.blockSize == (top + size - 1) / view.blockSize) {
+    counts[size_t(top / view.blockSize) * view.cols + left / view.blockSize] +=
+        int(node->population);
+    return;
+  }
+  long long half = size / 2;
+  countNode(node->nw, x, y, view, clip, counts);
+  countNode(node->ne, x + half, y, view, clip, counts);
+  countNode(node->sw, x, y + half, view, clip, counts);
+  countNode(node->se, x + half, y + half, view, clip, counts);
+}
+
+void HashLife::countBlocks(const BoardView &view,
+                           vector<int> &counts) const {
+  counts.assign(size_t(view.rows) * view.cols, 0);
+  // the cells both in the view and on the board, on the plane
+  Bounds clip = {
+      originX + max(view.left, 0), originY + max(view.top, 0),
+      originX + min(view.left + view.cols * view.blockSize, cols) - 1,
+      originY + min(view.top + view.rows * view.blockSize, rows) - 1};
+  if (clip.minX > clip.maxX || clip.minY > clip.maxY)
+    return;
+  long long half = 1LL << (root->level - 1);
+  countNode(root, -half, -half, view, clip, counts);
+}
+
+void HashLife::readBoard() {
+  fill(alive.begin(), alive.end(), 0);
+  long long half = 1LL << (root->level - 1);
+  readNode(root, -half, -half);
+}
+
+bool HashLife::updateAges() {
+  readBoard();
+  changes.clear();
+  bool changed = false;
+  for (size_t i = 0; i < ages.size(); ++i) {
+    int age = alive[i] ? ages[i] + (ages[i] < kMaxAge) : 0;
+    if (age != ages[i]) {
+      changed = true;
+      if (recordChanges)
+        changes.push_back({int(i) / cols, int(i) % cols, age});
+    }
+    ages[i] = uint8_t(age);
+  }
+  return changed;
+}
+
+void HashLife::resetAges() {
+  readBoard();
+  changes.clear();
+  for (size_t i = 0; i < ages.size(); ++i) {
+    if (recordChanges && ages[i] != alive[i])
+      changes.push_back({int(i) / cols, int(i) % cols, alive[i]});
+    ages[i] = alive[i];
+  }
+}
+
+bool HashLife::step() { return stepBy(1, true); }
+
+bool HashLife::stepBy(long long generations, bool rebuildAges) {
+  LIFE_PROFILE_SCOPE(kPhaseStep);
+  if (generations <= 0)
+    return true;
+  if (nodes.size() > kMaxNodes)
+    collectGarbage();
+
+  // ages saturate after kMaxAge generations, so stepping only that many one
+  // at a time is enough to rebuild them exactly
+  long long tracked = rebuildAges ? min(generations, (long long)kMaxAge) : 0;
+  long long jump = generations - tracked;
+  Node *before = root;
+  for (int stepLog = 0; (jump >> stepLog) != 0; ++stepLog) {
+    if ((jump >> stepLog) & 1)
+      jumpPowerOfTwo(stepLog);
+  }
+  if (jump > 0)
+    resetAges();
+
+  bool changed = root != before;
+  for (long long i = 0; i < tracked; ++i) {
+    before = root;
+    jumpPowerOfTwo(0);
+    changed = updateAges() || root != before;
+  }
+  return changed;
+}
+
+HashLife::Node *HashLife::readLeaf(const string &line, int lineNumber,
+                                   const string &filename) {
+  // rows of '.' and '*' each ended by '$', top to bottom, with trailing dead
+  // cells and rows left out
+  bool cells[8][8] = {};
+  int x = 0;
+  int y = 0;
+  for (char ch : line) {
+    if (ch == '$') {
+      ++y;
+      x = 0;
+    } else if ((ch == '.' || ch == '*') && x < 8 && y < 8) {
+      cells[y][x++] = ch == '*';
+    } else {
+      error(filename + ": line " + to_string(lineNumber) +
+            " is not a valid 8x8 leaf");
+    }
+  }
+  return build([&](int row, int col) { return cells[row][col]; }, 8, 8, 3, 0,
+               0);
+}
+
+void HashLife::loadMacrocell(const string &filename) {
+  MappedFile file(filename);
+  const char *pos = file.data();
+  const char *end = pos + file.size();
+  resetTree();
+
+  // node i of the file is nodesById[i]; 0 stands for an empty node
+  vector<Node *> nodesById(1, nullptr);
+  LifeRule rule = kConwayRule; // the format's default
+  int lineNumber = 0;
+  while (pos != end) {
+    const char *lineEnd = find(pos, end, '\n');
+    string line = trim(string(pos, lineEnd));
+    pos = lineEnd == end ? end : lineEnd + 1;
+    ++lineNumber;
+    if (lineNumber == 1) {
+      if (line.compare(0, 4, "[M2]") != 0)
+        error(filename + ": not a Macrocell file, it does not start with [M2]");
+      continue;
+    }
+    if (line.empty())
+      continue;
+    if (line[0] == '#') {
+      if (line.compare(0, 2, "#R") == 0) {
+        rule = parseFileRule(line.substr(2), filename);
+      } else if (line.compare(0, 2, "#G") == 0) {
+        istringstream(line.substr(2)) >> generationCount;
+      }
+      continue;
+    }
+    if (line[0] == '.' || line[0] == '*' || line[0] == '$') {
+      nodesById.push_back(readLeaf(line, lineNumber, filename));
+      continue;
+    }
+
+    istringstream fields(line);
+    int level;
+    long long children[4];
+    if (!(fields >> level >> children[0] >> children[1] >> children[2] >>
+          children[3]) ||
+        level < 1 || level > 62)
+      error(filename + ": line " + to_string(lineNumber) +
+            " is not a valid node");
+    Node *quadrants[4];
+    for (int q = 0; q < 4; ++q) {
+      if (level == 1) {
+        // the children of a level 1 node are cell states
+        quadrants[q] = children[q] != 0 ? &liveCell : &deadCell;
+      } else if (children[q] == 0) {
+        quadrants[q] = emptyNode(level - 1);
+      } else if (children[q] < 0 || children[q] >= (long long)nodesById.size() ||
+                 nodesById[children[q]]->level != level - 1) {
+        error(filename + ": line " + to_string(lineNumber) +
+              " refers to a node that is missing or of the wrong size");
+      } else {
+        quadrants[q] = nodesById[children[q]];
+      }
+    }
+    nodesById.push_back(
+        join(quadrants[0], quadrants[1], quadrants[2], quadrants[3]));
+  }
+  if (nodesById.size() == 1)
+    error(filename + ": the file has no nodes");
+  setRule(rule);
+
+  // the last node is the root, centered on the origin
+  root = nodesById.back();
+  while (root->level < kMinLevel) {
+    root = expand(root);
+  }
+  shrinkRoot();
+
+  long long half = 1LL << (root->level - 1);
+  unordered_map<const Node *, Bounds> known;
+  Bounds box = bounds(root, known);
+  if (box.minX > box.maxX) {
+    int side = 1 << kMinLevel;
+    resizeBoard(side, side, -side / 2, -side / 2);
+  } else {
+    long long width = min(box.maxX - box.minX + 1, (long long)kMaxBoardSide);
+    long long height = min(box.maxY - box.minY + 1, (long long)kMaxBoardSide);
+    long long centreX = -half + (box.minX + box.maxX) / 2;
+    long long centreY = -half + (box.minY + box.maxY) / 2;
+    resizeBoard(int(height), int(width), centreX - (width - 1) / 2,
+                centreY - (height - 1) / 2);
+  }
+  resetAges();
+}
+
+HashLife::Bounds
+HashLife::bounds(const Node *node,
+                 unordered_map<const Node *, Bounds> &known) const {
+  if (node->population == 0)
+    return Bounds{1, 1, 0, 0};
+  if (node->level == 0)
+    return Bounds{0, 0, 0, 0};
+  auto found = known.find(node);
+  if (found != known.end())
+    return found->second;
+  long long half = 1LL << (node->level - 1);
+  Bounds box{1, 1, 0, 0};
+  const Node *quadrants[] = {node->nw, node->ne, node->sw, node->se};
+  for (int q = 0; q < 4; ++q) {
+    Bounds part = bounds(quadrants[q], known);
+    if (part.minX > part.maxX)
+      continue;
+    long long dx = (q % 2) * half;
+    long long dy = (q / 2) * half;
+    part = Bounds{part.minX + dx, part.minY + dy, part.maxX + dx,
+                  part.maxY + dy};
+    if (box.minX > box.maxX) {
+      box = part;
+    } else {
+      box = Bounds{min(box.minX, part.minX), min(box.minY, part.minY),
+                   max(box.maxX, part.maxX), max(box.maxY, part.maxY)};
+    }
+  }
+  known.emplace(node, box);
+  return box;
+}
+
+bool HashLife::cellAt(const Node *node, int x, int y) {
+  while (node->level > 0) {
+    int half = 1 << (node->level - 1);
+    bool east = x >= half;
+    bool south = y >= half;
+    node = south ? (east ? node->se : node->sw) : (east ? node->ne : node->nw);
+    x -= east ? half : 0;
+    y -= south ? half : 0;
+  }
+  return node->population != 0;
+}
+
+long long
+HashLife::writeNode(ostream &out, const Node *node,
+                    unordered_map<const Node *, long long> &ids) const {
+  if (node->population == 0)
+    return 0;
+  auto found = ids.find(node);
+  if (found != ids.end())
+    return found->second;
+
+  if (node->level == 3) {
+    string line;
+    for (int y = 0; y < 8; ++y) {
+      string row;
+      for (int x = 0; x < 8; ++x) {
+        row += cellAt(node, x, y) ? '*' : '.';
+      }
+      line += row.substr(0, row.find_last_of('*') + 1) + '$';
+    }
+    out << line.substr(0, line.find_last_of('*') + 2) << '\n';
+  } else {
+    long long children[4];
+    const Node *quadrants[] = {node->nw, node->ne, node->sw, node->se};
+    for (int q = 0; q < 4; ++q) {
+      children[q] = writeNode(out, quadrants[q], ids);
+    }
+    out << node->level << ' ' << children[0] << ' ' << children[1] << ' '
+        << children[2] << ' ' << children[3] << '\n';
+  }
+  long long id = (long long)ids.size() + 1;
+  ids.emplace(node, id);
+  return id;
+}
+
+void HashLife::saveMacrocell(const string &filename) const {
+  ofstream out(filename);
+  if (!out)
+    error("Can not write file " + filename);
+  out << "[M2] (conway)\n";
+  out << "#R " << ruleString(lifeRule) << "\n";
+  if (generationCount != 0)
+    out << "#G " << generationCount << '\n';
+  unordered_map<const Node *, long long> ids;
+  if (writeNode(out, root, ids) == 0)
+    out << "$\n"; // an empty universe is a single empty leaf
+  if (!out)
+    error("Can not write file " + filename);
+}
@@ -0,0 +1,175 @@
+/**
+ * File: life-hashlife.h
+ * ---------------------
+ * Defines a HashLife engine: the universe is a quadtree whose nodes are
+ * hash-consed, so identical regions share one node, and the future of each
+ * node is memoized. Jumping 2^k generations then costs a single evaluation
+ * of the tree, which makes runs of millions of generations practical.
+ *
+ * Unlike the grid engines, HashLife runs on an unbounded plane: cells that
+ * leave the board loaded into it keep evolving instead of dying at the
+ * edge. The board is kept as a window onto the plane for import, export and
+ * display.
+ *
+ * The tree can also be loaded from and saved to Golly's Macrocell format
+ * directly, which stores each distinct node once, so huge sparse patterns
+ * never have to be expanded into cells.
+ */
+
+#pragma once
+#include "grid.h"        // for Grid
+#include "life-engine.h" // for LifeEngine
+#include <cstdint>       // for uint8_t
+#include <deque>         // for std::deque
+#include <ostream>       // for std::ostream
+#include <string>        // for std::string
+#include <unordered_map> // for std::unordered_map
+#include <vector>        // for std::vector
+
+class HashLife : public LifeEngine {
+public:
+  HashLife();
+
+  void load(const Grid<int> &grid) override;
+  void loadPattern(const PackedPattern &pattern) override;
+
+  /**
+   * Replaces the universe with the tree in the named Macrocell file, and
+   * the board with the bounding box of its live cells, all at age 1. Boards
+   * are limited to kMaxBoardSide cells a side; a larger pattern is shown
+   * through a window of that size centered on it. The engine switches to the
+   * rule the file names, B3/S23 if it names none, and problems with the
+   * file are reported through error.
+   */
+  void loadMacrocell(const std::string &filename);
+
+  /**
+   * Writes the whole universe, including cells that have left the board, to
+   * the named Macrocell file, along with the generation count.
+   */
+  void saveMacrocell(const std::string &filename) const;
+
+  /**
+   * Advances the universe by one generation. Returns false if neither the
+   * universe nor any age inside the board changed.
+   */
+  bool step() override;
+
+  /**
+   * Advances the universe by the given number of generations. A power of two
+   * is a single evaluation of the tree when rebuildAges is false; otherwise
+   * the last kMaxAge generations are stepped one at a time so the ages
+   * inside the board come out exactly as if every generation had been
+   * stepped. Ages are not tracked through the rest of the jump.
+   */
+  bool stepBy(long long generations, bool rebuildAges);
+  bool stepBy(long long generations) override {
+    return stepBy(generations, true);
+  }
+
+  void clear() override;
+
+  /**
+   * The rule only enters at the base of the tree, but every memoized
+   * result depends on it, so changing the rule forgets them all.
+   */
+  void setRule(const LifeRule &rule) override;
+
+  int numRows() const override { return rows; }
+  int numCols() const override { return cols; }
+  int ageAt(int row, int col) const override { return ages[row * cols + col]; }
+
+  /**
+   * Returns the number of live cells in the whole universe, including those
+   * that have left the board.
+   */
+  long long population() const override;
+
+  /**
+   * Adds up the populations of the largest nodes that each fall inside one
+   * block, so a zoomed-out view costs about one visit per block rather than
+   * one per cell.
+   */
+  void countBlocks(const BoardView &view,
+                   std::vector<int> &counts) const override;
+
+private:
+  struct Node {
+    Node *nw, *ne, *sw, *se; // quadrants, all null for single cells
+    int level;               // the node covers 2^level x 2^level cells
+    long long population;
+    Node *result;     // center after 2^(level-2) generations, once computed
+    Node *stepResult; // center after 2^stepLog generations
+    int stepLog;
+  };
+
+  struct NodeKey {
+    Node *nw, *ne, *sw, *se;
+    bool operator==(const NodeKey &other) const {
+      return nw == other.nw && ne == other.ne && sw == other.sw &&
+             se == other.se;
+    }
+  };
+
+  struct NodeKeyHash {
+    size_t operator()(const NodeKey &key) const;
+  };
+
+  // collect garbage once this many nodes have been created
+  static const size_t kMaxNodes = size_t(1) << 22;
+  // the largest board side loadMacrocell sets up
+  static const int kMaxBoardSide = 4096;
+
+  int rows;
+  int cols;
+  long long originX; // where board cell (0, 0) sits on the plane
+  long long originY;
+  std::deque<Node> nodes;
+  std::unordered_map<NodeKey, Node *, NodeKeyHash> table;
+  std::vector<Node *> emptyNodes; // the empty node of each level
+  Node deadCell;
+  Node liveCell;
+  Node *root;
+  std::vector<uint8_t> ages;  // ages of the cells inside the board
+  std::vector<uint8_t> alive; // scratch liveness of the board
+
+  Node *join(Node *nw, Node *ne, Node *sw, Node *se);
+  Node *emptyNode(int level);
+  Node *centre(Node *node);
+  Node *expand(Node *node);
+  Node *successor(Node *node, int stepLog);
+  Node *baseCase(Node *node);
+  template <typename IsAlive>
+  Node *build(const IsAlive &isAlive, int height, int width, int level,
+              long long x, long long y);
+  Node *copyNode(Node *node, std::unordered_map<Node *, Node *> &copies);
+
+  // bounding box of a node's live cells relative to its top-left corner,
+  // empty if minX > maxX
+  struct Bounds {
+    long long minX, minY, maxX, maxY;
+  };
+
+  void resetTree();
+  void resizeBoard(int numRows, int numCols, long long x, long long y);
+  void jumpPowerOfTwo(int stepLog);
+  void shrinkRoot();
+  void collectGarbage();
+  Node *readLeaf(const std::string &line, int lineNumber,
+                 const std::string &filename);
+  Bounds bounds(const Node *node,
+                std::unordered_map<const Node *, Bounds> &known) const;
+  static bool cellAt(const Node *node, int x, int y);
+  long long writeNode(std::ostream &out, const Node *node,
+                      std::unordered_map<const Node *, long long> &ids) const;
+  void readBoard();
+  void readNode(const Node *node, long long x, long long y);
+  void countNode(const Node *node, long long x, long long y,
+                 const BoardView &view, const Bounds &clip,
+                 std::vector<int> &counts) const;
+  bool updateAges();
+  void resetAges();
+
+  HashLife(const HashLife &original);
+  void operator=(const HashLife &rhs) const;
+};
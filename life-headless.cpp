@@ -0,0 +1,479 @@
+/**
+ * File: life-headless.cpp
+ * -----------------------
+ * Implements the headless benchmark mode.
+ */
+
+#include <algorithm> // for max
+#include <chrono>    // for steady_clock
+#include <iomanip>   // for setprecision
+#include <iostream>  // for cout, cerr
+#include <memory>    // for unique_ptr
+#include <thread>    // for thread::hardware_concurrency
+using namespace std;
+
+#include "error.h"  // for error, ErrorException
+#include "strlib.h" // for endsWith, stringIsInteger, stringIsReal
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h> // for getrusage
+#endif
+
+#include "life-auto.h"     // for class AutoLife
+#include "life-cycle.h"    // for class CycleDetector
+#include "life-engine.h"   // for class LifeEngine, createEngine
+#include "life-ensemble.h" // for runEnsemble, writeEnsembleCsv
+#include "life-formats.h"  // for loadPatternFile, savePatternFile
+#include "life-headless.h"
+#include "life-mpi.h"      // for class MpiLife
+#include "life-patterns.h" // for generateRandomPattern
+#include "life-profile.h"  // for profileTotals, writeProfileTrace
+#include "life-rules.h"    // for parseRule, ruleString
+#include "life-stepper.h"  // for class LifeStepper
+
+struct HeadlessOptions {
+  string pattern;
+  int randomRows = 0;
+  int randomCols = 0;
+  double density = 0.5;
+  long long seed = 1;
+  long long generations = 1000;
+  string engine;
+  int threads = 0; // 0 leaves the engine's own choice
+  bool detectCycles = false;
+  bool torus = false;
+  bool hasRule = false; // otherwise the engine's, or the pattern's, is run
+  LifeRule rule = kConwayRule;
+  string saveFile;
+  long long checkpointEvery = 0; // 0 only saves after the run
+  int ensembleRuns = 0; // 0 runs the one board
+  string csvFile;
+  string profileFile;
+  int haloDepth = 0; // 0 leaves the engine's own choice
+};
+
+/**
+ * Function: parseCount
+ * --------------------
+ * Parses a non-negative whole number given for the named flag.
+ */
+static long long parseCount(const string &flag, const string &value) {
+  size_t used = 0;
+  long long count = -1;
+  try {
+    count = stoll(value, &used);
+  } catch (...) {
+  }
+  if (value.empty() || used != value.size() || count < 0)
+    error(flag + " expects a non-negative whole number, got \"" + value +
+          "\"");
+  return count;
+}
+
+/**
+ * Function: parseOptions
+ * ----------------------
+ * Reads the flags described in life-headless.h, reporting bad ones through
+ * error.
+ */
+static HeadlessOptions parseOptions(const vector<string> &args) {
+  HeadlessOptions options;
+  for (size_t i = 0; i < args.size(); ++i) {
+    const string &flag = args[i];
+    if (flag == "--headless")
+      continue;
+    if (flag == "--cycles") {
+      options.detectCycles = true;
+      continue;
+    }
+    if (flag == "--torus") {
+      options.torus = true;
+      continue;
+    }
+    if (i + 1 >= args.size())
+      error("unknown flag or missing value for " + flag);
+    const string &value = args[++i];
+    if (flag == "--pattern") {
+      options.pattern = value;
+    } else if (flag == "--random") {
+      size_t x = value.find('x');
+      if (x == string::npos || !stringIsInteger(value.substr(0, x)) ||
+          !stringIsInteger(value.substr(x + 1)))
+        error("--random expects ROWSxCOLS, got \"" + value + "\"");
+      options.randomRows = stringToInteger(value.substr(0, x));
+      options.randomCols = stringToInteger(value.substr(x + 1));
+      if (options.randomRows <= 0 || options.randomCols <= 0)
+        error("--random needs positive dimensions");
+    } else if (flag == "--density") {
+      if (!stringIsReal(value) || stringToReal(value) < 0 ||
+          stringToReal(value) > 1)
+        error("--density expects a number between 0 and 1");
+      options.density = stringToReal(value);
+    } else if (flag == "--seed") {
+      options.seed = parseCount(flag, value);
+    } else if (flag == "--generations") {
+      options.generations = parseCount(flag, value);
+    } else if (flag == "--save") {
+      options.saveFile = value;
+    } else if (flag == "--checkpoint") {
+      options.checkpointEvery = parseCount(flag, value);
+      if (options.checkpointEvery == 0)
+        error("--checkpoint needs at least one generation");
+    } else if (flag == "--rule") {
+      options.rule = parseRule(value);
+      options.hasRule = true;
+    } else if (flag == "--engine") {
+      options.engine = value;
+    } else if (flag == "--ensemble") {
+      options.ensembleRuns = int(parseCount(flag, value));
+      if (options.ensembleRuns == 0)
+        error("--ensemble needs at least one board");
+    } else if (flag == "--profile") {
+#ifdef LIFE_PROFILING
+      options.profileFile = value;
+#else
+      error("--profile needs a build with LIFE_PROFILING "
+            "(qmake CONFIG+=profiling)");
+#endif
+    } else if (flag == "--csv") {
+      options.csvFile = value;
+    } else if (flag == "--halo") {
+      options.haloDepth = int(parseCount(flag, value));
+      if (options.haloDepth == 0)
+        error("--halo needs halos at least one cell deep");
+    } else if (flag == "--threads") {
+      options.threads = int(parseCount(flag, value));
+      if (options.threads == 0)
+        error("--threads needs at least one thread");
+    } else {
+      error("unknown flag " + flag);
+    }
+  }
+  if (options.pattern.empty() == (options.randomRows == 0))
+    error("give exactly one of --pattern FILE or --random ROWSxCOLS");
+  if (options.checkpointEvery > 0 && !endsWith(options.saveFile, ".snap"))
+    error("--checkpoint saves snapshots, give --save FILE.snap");
+  if (options.ensembleRuns > 0) {
+    if (options.randomRows == 0)
+      error("--ensemble runs random boards, give --random ROWSxCOLS");
+    if (options.csvFile.empty())
+      error("--ensemble needs --csv FILE for its results");
+    if (!options.saveFile.empty())
+      error("--save does not apply to --ensemble");
+    if (!options.profileFile.empty())
+      error("--profile does not apply to --ensemble");
+  } else if (!options.csvFile.empty()) {
+    error("--csv only applies to --ensemble");
+  }
+  return options;
+}
+
+/**
+ * Function: peakResidentBytes
+ * ---------------------------
+ * Returns the most memory the process has had resident at once, or 0 where
+ * the platform does not report it.
+ */
+static long long peakResidentBytes() {
+#if defined(__unix__) || defined(__APPLE__)
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+#if defined(__APPLE__)
+  return usage.ru_maxrss; // already in bytes
+#else
+  return usage.ru_maxrss * 1024LL; // in kilobytes
+#endif
+#else
+  return 0;
+#endif
+}
+
+/**
+ * Function: printProfile
+ * ----------------------
+ * Prints the time spent in each phase and the counters, summed over the
+ * run, and writes the trace to the named file.
+ */
+static void printProfile(const string &filename, long long generations) {
+  GenerationStats totals = profileTotals();
+  for (int phase = 0; phase < kNumPhases; ++phase) {
+    if (totals.seconds[phase] == 0)
+      continue;
+    string label = string(profilePhaseName(ProfilePhase(phase))) + " ms:";
+    cout << left << setw(18) << label << right << setprecision(3)
+         << totals.seconds[phase] * 1e3;
+    if (generations > 0)
+      cout << " (" << totals.seconds[phase] * 1e6 / generations << " us/gen)";
+    cout << endl;
+  }
+  for (int counter = 0; counter < kNumCounters; ++counter) {
+    string label = string(profileCounterName(ProfileCounter(counter))) + ":";
+    cout << left << setw(18) << label << right << totals.counts[counter]
+         << endl;
+  }
+  writeProfileTrace(filename);
+  cout << "trace:            " << filename << endl;
+}
+
+/**
+ * Function: loadRandomBoard
+ * -------------------------
+ * Loads the random board the options describe. The distributed engine
+ * generates each rank's block on that rank, so the board is never whole
+ * anywhere.
+ */
+static void loadRandomBoard(LifeEngine &engine,
+                            const HeadlessOptions &options) {
+#ifdef LIFE_HAVE_MPI
+  MpiLife *mpiLife = dynamic_cast<MpiLife *>(&engine);
+  if (mpiLife) {
+    mpiLife->loadRandom(options.randomRows, options.randomCols,
+                        options.density, uint64_t(options.seed));
+    return;
+  }
+#endif
+  engine.loadPattern(generateRandomPattern(
+      options.randomRows, options.randomCols, options.density,
+      uint64_t(options.seed), max(int(thread::hardware_concurrency()), 1)));
+}
+
+/**
+ * Function: runEnsembleMode
+ * -------------------------
+ * Runs the ensemble the options describe, prints a summary of how the
+ * boards ended and writes them all to the CSV file.
+ */
+static int runEnsembleMode(const HeadlessOptions &options) {
+  EnsembleSpec spec;
+  spec.rows = options.randomRows;
+  spec.cols = options.randomCols;
+  spec.density = options.density;
+  spec.seed = uint64_t(options.seed);
+  spec.generations = options.generations;
+  spec.engine = options.engine;
+  spec.rule = options.rule;
+  spec.torus = options.torus;
+  int threads = options.threads > 0
+                    ? options.threads
+                    : max(int(thread::hardware_concurrency()), 1);
+
+  vector<EnsembleRun> runs;
+  auto start = chrono::steady_clock::now();
+  try {
+    runs = runEnsemble(spec, options.ensembleRuns, threads);
+    writeEnsembleCsv(runs, options.csvFile);
+  } catch (const ErrorException &ex) {
+    cerr << "headless: " << ex.getMessage() << endl;
+    return 1;
+  }
+  double seconds =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  long long stable = 0, oscillating = 0, longest = 0;
+  double lifetimes = 0, populations = 0;
+  for (const EnsembleRun &run : runs) {
+    if (run.settled) {
+      ++(run.period == 1 ? stable : oscillating);
+      lifetimes += run.settledAt;
+      longest = max(longest, run.settledAt);
+    }
+    populations += run.finalPopulation;
+  }
+  long long settled = stable + oscillating;
+  cout << "boards:           " << runs.size() << " of " << spec.rows << " x "
+       << spec.cols << " at density " << spec.density << endl;
+  cout << "engine:           "
+       << (options.engine.empty() ? "dense" : options.engine) << " on "
+       << threads << " threads" << endl;
+  cout << "boundary:         " << (options.torus ? "torus" : "dead") << endl;
+  cout << "rule:             " << ruleString(spec.rule) << endl;
+  cout << "settled:          " << settled << " (" << stable << " stable, "
+       << oscillating << " oscillating, " << runs.size() - settled
+       << " still going after " << spec.generations << " generations)"
+       << endl;
+  cout << fixed << setprecision(1);
+  if (settled > 0) {
+    cout << "lifetime:         " << lifetimes / settled << " mean, "
+         << longest << " longest" << endl;
+  }
+  cout << "final population: " << populations / runs.size() << " mean"
+       << endl;
+  cout << setprecision(3);
+  cout << "seconds:          " << seconds << endl;
+  cout << "results:          " << options.csvFile << endl;
+  return 0;
+}
+
+bool isHeadlessRun(const vector<string> &args) {
+  for (const string &arg : args) {
+    if (arg == "--headless")
+      return true;
+  }
+  return false;
+}
+
+int runHeadless(const vector<string> &args) {
+  HeadlessOptions options;
+  unique_ptr<LifeEngine> engine;
+  try {
+    options = parseOptions(args);
+  } catch (const ErrorException &ex) {
+    cerr << "headless: " << ex.getMessage() << endl;
+    return 1;
+  }
+  if (options.ensembleRuns > 0)
+    return runEnsembleMode(options);
+  // generations stepped at a time; the distributed engine sums over its
+  // ranks once per swap of its halos rather than every generation
+  long long batch = 1;
+  string ranks;
+  try {
+    engine = createEngine(options.engine);
+    if (!engine)
+      error("the engine " + options.engine + " is not supported");
+    if (options.threads > 0) {
+      LifeStepper *stepper = dynamic_cast<LifeStepper *>(engine.get());
+      if (!stepper)
+        error("--threads only applies to the dense and parallel engines");
+      stepper->setThreadCount(options.threads);
+    }
+    if (options.torus && !engine->setTorus(true))
+      error("--torus only applies to the dense, parallel, packed, gpu, mpi "
+            "and auto engines");
+    bool distributed = false;
+#ifdef LIFE_HAVE_MPI
+    MpiLife *mpiLife = dynamic_cast<MpiLife *>(engine.get());
+    distributed = mpiLife != nullptr;
+    if (mpiLife && options.detectCycles)
+      error("--cycles does not apply to the mpi engine, whose ranks only "
+            "record their own changes");
+    if (mpiLife && options.haloDepth > 0)
+      mpiLife->setHaloDepth(options.haloDepth);
+#endif
+    if (options.haloDepth > 0 && !distributed)
+      error("--halo only applies to the mpi engine");
+    engine->setRecordChanges(options.detectCycles);
+    if (options.pattern.empty()) {
+      loadRandomBoard(*engine, options);
+    } else {
+      loadPatternFile(*engine, options.pattern);
+    }
+    if (options.hasRule)
+      engine->setRule(options.rule);
+#ifdef LIFE_HAVE_MPI
+    if (mpiLife) {
+      batch = mpiLife->haloDepth();
+      ranks = to_string(mpiLife->numRanks()) + " ranks, halos " +
+              to_string(batch) + " deep";
+      // the other ranks would only repeat the first one's report
+      if (mpiLife->rank() != 0)
+        cout.setstate(ios::failbit);
+    }
+#endif
+  } catch (const ErrorException &ex) {
+    cerr << "headless: " << ex.getMessage() << endl;
+    return 1;
+  }
+  if (!options.profileFile.empty())
+    profileStartTrace();
+  CycleDetector cycles;
+  cycles.reset(*engine);
+
+  // step one generation at a time, or one batch for the distributed engine,
+  // so every engine does comparable work and the generation the board
+  // settles on is known exactly, or to within a batch
+  long long generations = 0;
+  bool stable = false;
+  auto start = chrono::steady_clock::now();
+  while (generations < options.generations) {
+    long long count = min(batch, options.generations - generations);
+    long long before = generations;
+    generations += count;
+    bool changed = count == 1 ? engine->step() : engine->stepBy(count);
+    bool cycled = changed && options.detectCycles &&
+                  cycles.update(engine->changedCells()) > 1;
+    LIFE_PROFILE_END_GENERATION(engine->generation());
+    if (options.checkpointEvery > 0 &&
+        generations / options.checkpointEvery >
+            before / options.checkpointEvery) {
+      try {
+        savePatternFile(*engine, options.saveFile);
+      } catch (const ErrorException &ex) {
+        cerr << "headless: " << ex.getMessage() << endl;
+        return 1;
+      }
+    }
+    if (!changed) {
+      stable = true;
+      break;
+    }
+    if (cycled)
+      break;
+  }
+  double seconds =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  double cells = double(engine->numRows()) * engine->numCols();
+  cout << "board:            " << engine->numRows() << " x "
+       << engine->numCols() << endl;
+  cout << "engine:           "
+       << (options.engine.empty() ? "dense" : options.engine);
+  // the automatic choice names the engine it ended up on
+  const AutoLife *autoLife = dynamic_cast<const AutoLife *>(engine.get());
+  if (autoLife)
+    cout << " (" << autoLife->engineName() << ")";
+  if (!ranks.empty())
+    cout << " on " << ranks;
+  cout << endl;
+  cout << "boundary:         " << (options.torus ? "torus" : "dead") << endl;
+  cout << "rule:             " << ruleString(engine->rule()) << endl;
+  cout << "generations:      " << generations << " (now at generation "
+       << engine->generation() << ")";
+  if (stable && batch == 1)
+    cout << " (stable after generation " << generations - 1 << ")";
+  if (stable && batch > 1)
+    cout << " (stable within the last " << batch << " generations)";
+  if (cycles.period() > 1)
+    cout << " (repeats every " << cycles.period() << " generations)";
+  cout << endl;
+  cout << "population:       " << engine->population() << endl;
+  cout << fixed << setprecision(3);
+  cout << "seconds:          " << seconds << endl;
+  if (generations > 0 && seconds > 0) {
+    cout << "cells/sec:        " << setprecision(0)
+         << cells * generations / seconds << endl;
+    cout << "ns/generation:    " << setprecision(0)
+         << seconds * 1e9 / generations << endl;
+  }
+  long long peak = peakResidentBytes();
+  if (peak > 0) {
+    cout << "peak RSS:         " << setprecision(1) << peak / (1024.0 * 1024.0)
+         << " MiB" << endl;
+  } else {
+    cout << "peak RSS:         unavailable on this platform" << endl;
+  }
+
+  // per-band timing of the last generation shows how evenly the parallel
+  // engine splits the board
+  const LifeStepper *stepper = dynamic_cast<const LifeStepper *>(engine.get());
+  if (stepper && stepper->threadCount() > 1) {
+    const vector<double> &bands = stepper->bandSeconds();
+    cout << "band ms (last):  ";
+    for (double band : bands) {
+      cout << " " << setprecision(3) << band * 1e3;
+    }
+    cout << endl;
+  }
+
+  try {
+    if (!options.profileFile.empty())
+      printProfile(options.profileFile, generations);
+    if (!options.saveFile.empty())
+      savePatternFile(*engine, options.saveFile);
+  } catch (const ErrorException &ex) {
+    cerr << "headless: " << ex.getMessage() << endl;
+    return 1;
+  }
+  return 0;
+}
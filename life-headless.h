@@ -0,0 +1,70 @@
+/**
+ * File: life-headless.h
+ * ---------------------
+ * Defines the headless mode, which runs an engine for a fixed number of
+ * generations without a display and reports how fast it went, or runs an
+ * ensemble of random boards and reports how they ended. It is driven
+ * entirely from the command line, so runs can be scripted and compared.
+ */
+
+#pragma once
+#include <string> // for std::string
+#include <vector> // for std::vector
+
+/**
+ * Function: isHeadlessRun
+ * -----------------------
+ * Returns true if the given command-line arguments ask for headless mode,
+ * that is if they contain --headless.
+ */
+bool isHeadlessRun(const std::vector<std::string> &args);
+
+/**
+ * Function: runHeadless
+ * ---------------------
+ * Runs headless mode with the given command-line arguments, not including
+ * the program name, and returns the exit status for main. The flags are:
+ *
+ *   --headless            run without the display
+ *   --pattern FILE        start from a pattern file, text, .rle or .mc
+ *   --random RxC          start from a random board of R rows and C columns
+ *   --density P           chance a random cell starts alive (default 0.5)
+ *   --seed N              seed for the random board (default 1), see
+ *                         generateRandomPattern
+ *   --generations N       generations to run (default 1000)
+ *   --engine NAME         engine to run, as accepted by createEngine
+ *   --threads N           threads for the dense engine
+ *   --cycles              stop once the live cells repeat, see CycleDetector
+ *   --torus               wrap the board around its edges
+ *   --rule RULE           rule to run in B/S notation (default B3/S23, or
+ *                         the rule an .rle or .mc pattern records)
+ *   --save FILE           save the last generation, as savePatternFile does
+ *   --checkpoint N        also save every N generations, to the --save
+ *                         file, which must be a snapshot (.snap)
+ *   --halo K              halo depth for the mpi engine, see
+ *                         MpiLife::setHaloDepth
+ *   --ensemble N          run N random boards instead, see life-ensemble.h
+ *   --csv FILE            where an ensemble writes one line per board
+ *   --profile FILE        time the phases of each generation and write a
+ *                         trace to FILE, see life-profile.h; needs a build
+ *                         with LIFE_PROFILING
+ *
+ * The run stops early if the board becomes stable, or with --cycles if it
+ * enters a cycle. Afterwards it prints the generations run, cells per
+ * second, nanoseconds per generation, the peak resident set size and, for
+ * the dense engine, the time spent in each band. With --profile it also
+ * prints the time spent in each phase and the work counters.
+ *
+ * Run under mpirun, every rank runs the same flags on its block of the
+ * mpi engine's board, which is stepped a halo's depth of generations at a
+ * time, and the first rank reports for them all. A random board is
+ * generated block by block, and --cycles does not apply.
+ *
+ * An ensemble needs --random and --csv. Each board gets its own seed,
+ * derived from --seed, and runs until its live cells repeat or for at most
+ * --generations; --threads sets how many boards run at once (default one
+ * per core), each on one thread, so the parallel engine is refused.
+ * Afterwards it prints how many boards settled and how, their mean
+ * lifetime and final population, and writes every board to the CSV.
+ */
+int runHeadless(const std::vector<std::string> &args);
@@ -0,0 +1,229 @@
+/**
+ * File: life-kernel.h
+ * -------------------
+ * Defines the word-at-a-time kernel shared by the engines that store
+ * liveness one bit per cell, with column c of a row in bit c % 64 of word
+ * c / 64. The eight neighbors of 64 cells are summed in parallel with half
+ * and full adders built from bitwise operations, and the rule is applied to
+ * the resulting bit-sliced counts. The kernel is instantiated per rule type
+ * of life-rules.h; B3/S23 keeps a shorter path that only tells apart the
+ * counts it needs. With GCC or Clang the kernel can also be
+ * instantiated over WordVector, a vector of words the compiler lowers to
+ * SSE2 or NEON registers, or to AVX2 registers when the target supports it.
+ *
+ * Ages are kept in four bit planes, updated with the same word-at-a-time
+ * logic as a saturating counter.
+ */
+
+#pragma once
+#include "life-constants.h" // for kMaxAge, BoardView
+#include "life-rules.h"     // for isConway
+#include <algorithm>        // for std::min, std::max
+#include <bitset>           // for std::bitset
+#include <cstdint>          // for uint64_t
+#include <cstring>          // for memcpy
+
+static_assert(kMaxAge < 16, "ages must fit in the packed engine's age planes");
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LIFE_PACKED_HAS_VECTOR 1
+#ifdef __AVX2__
+typedef uint64_t WordVector __attribute__((vector_size(32)));
+#else
+typedef uint64_t WordVector __attribute__((vector_size(16)));
+#endif
+static const int kVectorWords = sizeof(WordVector) / sizeof(uint64_t);
+
+static inline bool anyBits(WordVector word) {
+  uint64_t any = 0;
+  for (int i = 0; i < kVectorWords; ++i) {
+    any |= word[i];
+  }
+  return any != 0;
+}
+#endif
+
+static inline bool anyBits(uint64_t word) { return word != 0; }
+
+static inline int countTrailingZeros(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(word);
+#else
+  int count = 0;
+  while (!(word & 1)) {
+    word >>= 1;
+    ++count;
+  }
+  return count;
+#endif
+}
+
+static inline int countBits(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcountll(word);
+#else
+  return int(std::bitset<64>(word).count());
+#endif
+}
+
+#ifdef LIFE_PACKED_HAS_VECTOR
+static inline int countBits(WordVector word) {
+  int count = 0;
+  for (int i = 0; i < kVectorWords; ++i) {
+    count += countBits(uint64_t(word[i]));
+  }
+  return count;
+}
+#endif
+
+/**
+ * Function: countWordBlocks
+ * -------------------------
+ * Adds the live cells of a word holding columns firstCol to firstCol + 63
+ * of a row to the blocks of the view they fall in. blockCounts points to
+ * the view's row of blocks that the row belongs to.
+ */
+static inline void countWordBlocks(uint64_t word, int firstCol,
+                                   const BoardView &view, int *blockCounts) {
+  int from = std::max(firstCol, view.left);
+  int to = std::min(firstCol + 64, view.left + view.cols * view.blockSize);
+  while (word != 0 && from < to) {
+    int block = (from - view.left) / view.blockSize;
+    int blockEnd = std::min(view.left + (block + 1) * view.blockSize, to);
+    int low = from - firstCol;
+    int high = blockEnd - firstCol;
+    uint64_t mask = (high == 64 ? ~uint64_t(0) : (uint64_t(1) << high) - 1) &
+                    ~((uint64_t(1) << low) - 1);
+    blockCounts[block] += countBits(word & mask);
+    word &= ~mask;
+    from = blockEnd;
+  }
+}
+
+template <typename Word> static inline Word loadWord(const uint64_t *src) {
+  Word word;
+  memcpy(&word, src, sizeof(word));
+  return word;
+}
+
+template <typename Word> static inline void storeWord(uint64_t *dst, Word word) {
+  memcpy(dst, &word, sizeof(word));
+}
+
+/**
+ * Function: nextGeneration
+ * ------------------------
+ * Applies the rule to the cells in the words at up, mid and down, which
+ * point into three consecutive padded rows. The words on either side are
+ * read to carry neighbors across word boundaries.
+ */
+template <typename Word, typename Rule>
+static inline Word nextGeneration(const Rule &rule, const uint64_t *up,
+                                  const uint64_t *mid, const uint64_t *down) {
+  Word u = loadWord<Word>(up);
+  Word uw = (u << 1) | (loadWord<Word>(up - 1) >> 63);
+  Word ue = (u >> 1) | (loadWord<Word>(up + 1) << 63);
+  Word m = loadWord<Word>(mid);
+  Word mw = (m << 1) | (loadWord<Word>(mid - 1) >> 63);
+  Word me = (m >> 1) | (loadWord<Word>(mid + 1) << 63);
+  Word d = loadWord<Word>(down);
+  Word dw = (d << 1) | (loadWord<Word>(down - 1) >> 63);
+  Word de = (d >> 1) | (loadWord<Word>(down + 1) << 63);
+
+  // two-bit counts (0-3) of the row above, the row below and the two
+  // horizontal neighbors
+  Word u0 = uw ^ u ^ ue;
+  Word u1 = (uw & u) | (ue & (uw ^ u));
+  Word d0 = dw ^ d ^ de;
+  Word d1 = (dw & d) | (de & (dw ^ d));
+  Word m0 = mw ^ me;
+  Word m1 = mw & me;
+
+  // add the ones column, then the twos column
+  Word ones = u0 ^ d0 ^ m0;
+  Word carry = (u0 & d0) | (m0 & (u0 ^ d0));
+  Word twosLow = u1 ^ d1;
+  Word twosHigh = m1 ^ carry;
+  Word twos = twosLow ^ twosHigh;
+
+  if (isConway(rule)) {
+    // any pair of twos means four or more neighbors; the cell lives with
+    // exactly three neighbors, or exactly two and already alive
+    Word fourOrMore = (u1 & d1) | (m1 & carry) | (twosLow & twosHigh);
+    return twos & ~fourOrMore & (ones | m);
+  }
+
+  // the fours and eights columns give the full count, 0 to 8; of the three
+  // pairs of twos only the first two can be set together, for eight
+  Word upDownPair = u1 & d1;
+  Word middlePair = m1 & carry;
+  Word fours = upDownPair ^ middlePair ^ (twosLow & twosHigh);
+  Word eights = upDownPair & middlePair;
+  Word born{};
+  Word survives{};
+  for (int count = 0; count <= 8; ++count) {
+    Word isCount = ((count & 1) ? ones : ~ones) & ((count & 2) ? twos : ~twos) &
+                   ((count & 4) ? fours : ~fours) &
+                   ((count & 8) ? eights : ~eights);
+    if ((rule.birth >> count) & 1)
+      born |= isCount;
+    if ((rule.survival >> count) & 1)
+      survives |= isCount;
+  }
+  return (born & ~m) | (survives & m);
+}
+
+/**
+ * Function: stepWords
+ * -------------------
+ * Computes the next generation of the word (or words) at mid into out and,
+ * if requested, advances the matching words of the age planes, all in one
+ * pass. The cells whose liveness or age changed are stored to changedOut
+ * and added to changed, and the live cells of the new generation are added
+ * to population. Only the cells in mask are stepped; the bits outside it
+ * may hold halo cells, which are read as neighbors but never change.
+ */
+template <typename Rule, typename Word>
+static inline void stepWords(const Rule &rule, const uint64_t *up,
+                             const uint64_t *mid, const uint64_t *down,
+                             uint64_t *out, uint64_t *const *ages,
+                             uint64_t *changedOut, uint64_t mask,
+                             bool trackAges, Word &changed,
+                             long long &population) {
+  Word was = loadWord<Word>(mid) & mask;
+  Word now = nextGeneration<Word>(rule, up, mid, down) & mask;
+  storeWord(out, now);
+  population += countBits(now);
+  Word born = now & ~was;
+  Word died = was & ~now;
+  // dead cells always have age 0, so words that are empty in both
+  // generations leave the age planes untouched
+  if (!trackAges || !anyBits(was | now)) {
+    storeWord(changedOut, born | died);
+    changed |= born | died;
+    return;
+  }
+
+  Word age[4];
+  Word atMax = ~Word{};
+  for (int b = 0; b < 4; ++b) {
+    age[b] = loadWord<Word>(ages[b]);
+    atMax &= ((kMaxAge >> b) & 1) ? age[b] : ~age[b];
+  }
+  Word survived = now & was;
+  Word grow = survived & ~atMax;
+  Word keep = survived & atMax;
+
+  // ripple-carry increment for cells that grow older, age 1 for births
+  Word carry = ~Word{};
+  for (int b = 0; b < 4; ++b) {
+    Word incremented = age[b] ^ carry;
+    carry &= age[b];
+    Word updated = (grow & incremented) | (keep & age[b]);
+    if (b == 0)
+      updated |= born;
+    storeWord(ages[b], updated);
+  }
+  storeWord(changedOut, born | died | grow);
+  changed |= born | died | grow;
+}
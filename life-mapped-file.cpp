@@ -0,0 +1,60 @@
+/**
+ * File: life-mapped-file.cpp
+ * --------------------------
+ * Implements the file view with POSIX mmap, falling back to reading the
+ * file where mmap is not available or fails.
+ */
+
+#include <fstream> // for ifstream
+using namespace std;
+
+#include "error.h" // for error
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LIFE_HAVE_MMAP
+#include <fcntl.h>    // for open
+#include <sys/mman.h> // for mmap, madvise, munmap
+#include <sys/stat.h> // for fstat
+#include <unistd.h>   // for close
+#endif
+
+#include "life-mapped-file.h"
+
+MappedFile::MappedFile(const string &filename)
+    : bytes(nullptr), length(0), mapped(false) {
+#ifdef LIFE_HAVE_MMAP
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    error("Can not open file " + filename);
+  struct stat info;
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+    void *view =
+        mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view != MAP_FAILED) {
+      // the parsers read front to back once
+      madvise(view, size_t(info.st_size), MADV_SEQUENTIAL);
+      bytes = static_cast<const char *>(view);
+      length = size_t(info.st_size);
+      mapped = true;
+    }
+  }
+  close(fd);
+  if (mapped)
+    return;
+#endif
+  ifstream file(filename, ios::binary);
+  if (!file)
+    error("Can not open file " + filename);
+  copy.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+  if (file.bad())
+    error("Can not read file " + filename);
+  bytes = copy.data();
+  length = copy.size();
+}
+
+MappedFile::~MappedFile() {
+#ifdef LIFE_HAVE_MMAP
+  if (mapped)
+    munmap(const_cast<char *>(bytes), length);
+#endif
+}
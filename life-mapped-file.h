@@ -0,0 +1,34 @@
+/**
+ * File: life-mapped-file.h
+ * ------------------------
+ * Defines a read-only view of a whole file. Where the platform supports it
+ * the file is memory-mapped, so reading it costs no copy and the kernel
+ * streams it in as it is scanned; elsewhere it is read into memory.
+ */
+
+#pragma once
+#include <cstddef> // for size_t
+#include <string>  // for std::string
+#include <vector>  // for std::vector
+
+class MappedFile {
+public:
+  /**
+   * Opens the named file, reporting a file that cannot be opened or read
+   * through error.
+   */
+  MappedFile(const std::string &filename);
+  ~MappedFile();
+
+  const char *data() const { return bytes; }
+  size_t size() const { return length; }
+
+private:
+  const char *bytes;
+  size_t length;
+  bool mapped;             // true if bytes must be unmapped
+  std::vector<char> copy;  // the contents when the file is not mapped
+
+  MappedFile(const MappedFile &original);
+  void operator=(const MappedFile &rhs) const;
+};
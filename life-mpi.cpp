@@ -0,0 +1,652 @@
+/**
+ * File: life-mpi.cpp
+ * ------------------
+ * Implements the distributed stepping engine. The halo is swapped with
+ * nonblocking sends and receives of MPI datatypes that pick the edges and
+ * the halo straight out of each rank's padded rows, so nothing is copied
+ * into message buffers; MPI-IO writes snapshots the same way, from every
+ * rank at once.
+ */
+
+#ifdef LIFE_HAVE_MPI
+#include <algorithm> // for copy, fill, max, min
+#include <cstdlib>   // for atexit
+#include <string>    // for string, to_string
+#include <utility>   // for swap
+using namespace std;
+
+#include "error.h" // for error
+
+#include "life-constants.h" // for kMaxAge
+#include "life-kernel.h"    // for stepWords, nextGeneration, countBits
+#include "life-mpi.h"
+#include "life-patterns.h"  // for generateRandomWords
+#include "life-profile.h"   // for LIFE_PROFILE_SCOPE, LIFE_PROFILE_COUNT
+#include "life-snapshot.h"  // for snapshotHeader
+
+static_assert(MpiLife::kAgePlanes == kSnapshotAgePlanes,
+              "snapshots copy the age planes as they are");
+
+// the eight neighbors as row and column offsets; the opposite of direction
+// d is 7 - d
+static const int kDirections[8][2] = {{-1, -1}, {-1, 0}, {-1, 1}, {0, -1},
+                                      {0, 1},   {1, -1}, {1, 0},  {1, 1}};
+static const int kNorth = 1;
+static const int kWest = 3;
+static const int kEast = 4;
+static const int kSouth = 6;
+static const int kGatherTag = 8; // the swap tags messages with 0 to 7
+
+/**
+ * Function: finishMpi
+ * -------------------
+ * Shuts MPI down at exit, if the engine started it.
+ */
+static void finishMpi() {
+  int finished = 0;
+  MPI_Finalized(&finished);
+  if (!finished)
+    MPI_Finalize();
+}
+
+MpiLife::MpiLife()
+    : rows(0), cols(0), wordsPerRow(0), torus(false),
+      lastWordMask(~uint64_t(0)), livePopulation(0), blockPopulation(0),
+      requestedDepth(1), depth(1), stepsLeft(0), grid(MPI_COMM_NULL),
+      gridDims{1, 1}, gridCoords{0, 0}, block{0, 0, 0, 0}, stride(4),
+      stepRegionFor(&MpiLife::stepRegion<ConwayRule>) {
+  int started = 0;
+  MPI_Initialized(&started);
+  if (!started) {
+    // only the thread running the program calls MPI, though the library
+    // runs its window on another
+    int provided = 0;
+    MPI_Init_thread(nullptr, nullptr, MPI_THREAD_FUNNELED, &provided);
+    atexit(finishMpi);
+  }
+  MPI_Comm_rank(MPI_COMM_WORLD, &rankIndex);
+  MPI_Comm_size(MPI_COMM_WORLD, &rankCount);
+  for (int d = 0; d < 8; ++d) {
+    neighbors[d] = MPI_PROC_NULL;
+    sendTypes[d] = MPI_DATATYPE_NULL;
+    recvTypes[d] = MPI_DATATYPE_NULL;
+  }
+}
+
+MpiLife::~MpiLife() { releaseGrid(); }
+
+void MpiLife::releaseGrid() {
+  int finished = 0;
+  MPI_Finalized(&finished);
+  if (finished)
+    return;
+  for (int d = 0; d < 8; ++d) {
+    if (sendTypes[d] != MPI_DATATYPE_NULL)
+      MPI_Type_free(&sendTypes[d]);
+    if (recvTypes[d] != MPI_DATATYPE_NULL)
+      MPI_Type_free(&recvTypes[d]);
+  }
+  if (grid != MPI_COMM_NULL)
+    MPI_Comm_free(&grid);
+}
+
+void MpiLife::pickGrid() {
+  // of the ways to factor the ranks into rows and columns of blocks, take
+  // the one whose blocks have the shortest edges, and so the least halo
+  gridDims[0] = 0;
+  double bestEdges = 0;
+  for (int across = 1; across <= rankCount; ++across) {
+    int down = rankCount / across;
+    if (down * across != rankCount || down > rows || across > wordsPerRow)
+      continue;
+    double edges = double(rows) / down + double(cols) / across;
+    if (gridDims[0] == 0 || edges < bestEdges) {
+      gridDims[0] = down;
+      gridDims[1] = across;
+      bestEdges = edges;
+    }
+  }
+  if (gridDims[0] == 0)
+    error("a board of " + to_string(rows) + " x " + to_string(cols) +
+          " is too small to split over " + to_string(rankCount) + " ranks");
+
+  // the grid is periodic so every rank has eight neighbors to look up,
+  // which findNeighbors drops past the board's edges unless it wraps
+  int periods[2] = {1, 1};
+  MPI_Cart_create(MPI_COMM_WORLD, 2, gridDims, periods, 0, &grid);
+  MPI_Comm_rank(grid, &rankIndex);
+  MPI_Cart_coords(grid, rankIndex, 2, gridCoords);
+  block = blockOf(gridCoords);
+}
+
+MpiLife::Block MpiLife::blockOf(const int coords[2]) const {
+  Block part;
+  part.firstRow = int((long long)coords[0] * rows / gridDims[0]);
+  part.numRows =
+      int((long long)(coords[0] + 1) * rows / gridDims[0]) - part.firstRow;
+  part.firstWord = int((long long)coords[1] * wordsPerRow / gridDims[1]);
+  part.numWords = int((long long)(coords[1] + 1) * wordsPerRow / gridDims[1]) -
+                  part.firstWord;
+  return part;
+}
+
+void MpiLife::findNeighbors() {
+  for (int d = 0; d < 8; ++d) {
+    int coords[2] = {gridCoords[0] + kDirections[d][0],
+                     gridCoords[1] + kDirections[d][1]};
+    bool outside = coords[0] < 0 || coords[0] >= gridDims[0] ||
+                   coords[1] < 0 || coords[1] >= gridDims[1];
+    if (outside && !torus) {
+      neighbors[d] = MPI_PROC_NULL;
+    } else {
+      MPI_Cart_rank(grid, coords, &neighbors[d]);
+    }
+  }
+}
+
+void MpiLife::buildHaloTypes() {
+  // rows and words of the padded storage: the block starts at row depth
+  // and word 2, and the halo is the word and the depth rows around it
+  int sizes[2] = {block.numRows + 2 * depth, stride};
+  for (int d = 0; d < 8; ++d) {
+    int dr = kDirections[d][0];
+    int dc = kDirections[d][1];
+    int subsizes[2] = {dr == 0 ? block.numRows : depth,
+                       dc == 0 ? block.numWords : 1};
+    int sendStarts[2] = {dr <= 0 ? depth : block.numRows,
+                         dc <= 0 ? 2 : block.numWords + 1};
+    int recvStarts[2] = {dr < 0 ? 0 : dr == 0 ? depth : depth + block.numRows,
+                         dc < 0 ? 1 : dc == 0 ? 2 : block.numWords + 2};
+    MPI_Type_create_subarray(2, sizes, subsizes, sendStarts, MPI_ORDER_C,
+                             MPI_UINT64_T, &sendTypes[d]);
+    MPI_Type_commit(&sendTypes[d]);
+    MPI_Type_create_subarray(2, sizes, subsizes, recvStarts, MPI_ORDER_C,
+                             MPI_UINT64_T, &recvTypes[d]);
+    MPI_Type_commit(&recvTypes[d]);
+  }
+}
+
+void MpiLife::resize(int numRows, int numCols) {
+  if (torus && numCols % 64 != 0)
+    error("the mpi engine only wraps boards whose width is a multiple of 64");
+  releaseGrid();
+  rows = numRows;
+  cols = numCols;
+  generationCount = 0;
+  wordsPerRow = (cols + 63) / 64;
+  lastWordMask =
+      cols % 64 == 0 ? ~uint64_t(0) : (uint64_t(1) << (cols % 64)) - 1;
+  pickGrid();
+
+  // a halo is only ever taken from the adjacent block, so it can be no
+  // deeper than the shortest block
+  depth = max(1, min({requestedDepth, int(kMaxHaloDepth),
+                      rows / gridDims[0]}));
+  stride = block.numWords + 4;
+  live.assign(size_t(block.numRows + 2 * depth) * stride, 0);
+  nextLive.assign(live.size(), 0);
+  for (auto &plane : agePlanes) {
+    plane.assign(size_t(block.numRows) * block.numWords, 0);
+  }
+  changedWords.assign(size_t(block.numRows) * block.numWords, 0);
+  LIFE_PROFILE_COUNT(kAllocations, 3 + kAgePlanes);
+  findNeighbors();
+  buildHaloTypes();
+  stepsLeft = 0;
+  changes.clear();
+}
+
+void MpiLife::sumPopulation() {
+  blockPopulation = 0;
+  for (int row = 0; row < block.numRows; ++row) {
+    const uint64_t *words = liveRow(live, row);
+    for (int w = 0; w < block.numWords; ++w) {
+      blockPopulation += countBits(words[w]);
+    }
+  }
+  livePopulation = blockPopulation;
+  MPI_Allreduce(MPI_IN_PLACE, &livePopulation, 1, MPI_LONG_LONG, MPI_SUM,
+                grid);
+}
+
+void MpiLife::resetAges() {
+  for (auto &plane : agePlanes) {
+    fill(plane.begin(), plane.end(), 0);
+  }
+  for (int row = 0; row < block.numRows; ++row) {
+    const uint64_t *words = liveRow(live, row);
+    copy(words, words + block.numWords,
+         agePlanes[0].begin() + size_t(row) * block.numWords);
+  }
+}
+
+void MpiLife::load(const Grid<int> &grid) {
+  resize(grid.numRows(), grid.numCols());
+  int firstCol = block.firstWord * 64;
+  int lastCol = min(cols, (block.firstWord + block.numWords) * 64);
+  for (int row = 0; row < block.numRows; ++row) {
+    uint64_t *words = liveRow(live, row);
+    for (int col = firstCol; col < lastCol; ++col) {
+      int age = min(grid[block.firstRow + row][col], kMaxAge);
+      if (age <= 0)
+        continue;
+      int w = col / 64 - block.firstWord;
+      uint64_t bit = uint64_t(1) << (col % 64);
+      words[w] |= bit;
+      for (int b = 0; b < kAgePlanes; ++b) {
+        if ((age >> b) & 1)
+          agePlanes[b][size_t(row) * block.numWords + w] |= bit;
+      }
+    }
+  }
+  sumPopulation();
+}
+
+void MpiLife::loadPattern(const PackedPattern &pattern) {
+  resize(pattern.rows, pattern.cols);
+  for (int row = 0; row < block.numRows; ++row) {
+    const uint64_t *words = pattern.bits.data() +
+                            size_t(block.firstRow + row) * pattern.wordsPerRow +
+                            block.firstWord;
+    copy(words, words + block.numWords, liveRow(live, row));
+  }
+  resetAges();
+  sumPopulation();
+}
+
+void MpiLife::loadSnapshot(const SnapshotView &snapshot) {
+  resize(snapshot.rows, snapshot.cols);
+  for (int row = 0; row < block.numRows; ++row) {
+    size_t start =
+        size_t(block.firstRow + row) * snapshot.wordsPerRow + block.firstWord;
+    copy(snapshot.live + start, snapshot.live + start + block.numWords,
+         liveRow(live, row));
+    for (int b = 0; b < kAgePlanes; ++b) {
+      copy(snapshot.ages[b] + start, snapshot.ages[b] + start + block.numWords,
+           agePlanes[b].begin() + size_t(row) * block.numWords);
+    }
+  }
+  generationCount = snapshot.generation;
+  sumPopulation();
+}
+
+void MpiLife::loadRandom(int numRows, int numCols, double density,
+                         uint64_t seed) {
+  resize(numRows, numCols);
+  generateRandomWords(cols, density, seed, block.firstRow, block.numRows,
+                      block.firstWord, block.numWords, liveRow(live, 0),
+                      size_t(stride));
+  resetAges();
+  sumPopulation();
+}
+
+void MpiLife::clear() {
+  fill(live.begin(), live.end(), 0);
+  fill(nextLive.begin(), nextLive.end(), 0);
+  for (auto &plane : agePlanes) {
+    fill(plane.begin(), plane.end(), 0);
+  }
+  livePopulation = 0;
+  blockPopulation = 0;
+  stepsLeft = 0;
+}
+
+int MpiLife::ageAt(int row, int col) const {
+  if (!inBlock(row, col))
+    return 0;
+  int r = row - block.firstRow;
+  int w = col / 64 - block.firstWord;
+  if (!((liveRow(live, r)[w] >> (col % 64)) & 1))
+    return 0;
+  int age = 0;
+  for (int b = 0; b < kAgePlanes; ++b) {
+    age |= int((agePlanes[b][size_t(r) * block.numWords + w] >> (col % 64)) &
+               1)
+           << b;
+  }
+  return age;
+}
+
+bool MpiLife::setTorus(bool torus) {
+  if (torus && grid != MPI_COMM_NULL && cols % 64 != 0)
+    return false;
+  this->torus = torus;
+  if (grid == MPI_COMM_NULL)
+    return true;
+  findNeighbors();
+  if (!torus) {
+    // the halo past the board's edges held the opposite edges, and from
+    // now on nothing is received there
+    for (vector<uint64_t> *words : {&live, &nextLive}) {
+      for (int row = -depth; row < block.numRows + depth; ++row) {
+        uint64_t *rowWords = liveRow(*words, row);
+        bool outside = (row < 0 && neighbors[kNorth] == MPI_PROC_NULL) ||
+                       (row >= block.numRows &&
+                        neighbors[kSouth] == MPI_PROC_NULL);
+        if (outside) {
+          fill(rowWords - 1, rowWords + block.numWords + 1, 0);
+          continue;
+        }
+        if (neighbors[kWest] == MPI_PROC_NULL)
+          rowWords[-1] = 0;
+        if (neighbors[kEast] == MPI_PROC_NULL)
+          rowWords[block.numWords] = 0;
+      }
+    }
+  }
+  stepsLeft = 0;
+  return true;
+}
+
+void MpiLife::setRule(const LifeRule &rule) {
+  LifeEngine::setRule(rule);
+  stepRegionFor = dispatchRule(rule, [](auto kind) -> RegionStepper {
+    return &MpiLife::stepRegion<decltype(kind)>;
+  });
+}
+
+void MpiLife::setHaloDepth(int depth) {
+  requestedDepth = max(1, min(depth, int(kMaxHaloDepth)));
+}
+
+void MpiLife::startSwap() {
+  // a neighbor's message travelling in direction d fills the halo on the
+  // side it comes from; past an edge that does not wrap the neighbor is
+  // MPI_PROC_NULL, which leaves the halo empty
+  for (int d = 0; d < 8; ++d) {
+    MPI_Irecv(live.data(), 1, recvTypes[d], neighbors[d], 7 - d, grid,
+              &requests[d]);
+  }
+  for (int d = 0; d < 8; ++d) {
+    MPI_Isend(live.data(), 1, sendTypes[d], neighbors[d], d, grid,
+              &requests[8 + d]);
+  }
+}
+
+void MpiLife::finishSwap() { MPI_Waitall(16, requests, MPI_STATUSES_IGNORE); }
+
+template <typename Rule>
+bool MpiLife::stepRegion(int fromRow, int toRow, int fromWord, int toWord) {
+  const Rule rule(lifeRule);
+  bool changed = false;
+  for (int row = fromRow; row < toRow; ++row) {
+    const uint64_t *up = liveRow(live, row - 1);
+    const uint64_t *mid = liveRow(live, row);
+    const uint64_t *down = liveRow(live, row + 1);
+    uint64_t *out = liveRow(nextLive, row);
+
+    // halo cells only need their liveness, past the board's last column
+    // kept empty
+    auto stepHalo = [&](int w) {
+      uint64_t now = nextGeneration<uint64_t>(rule, up + w, mid + w, down + w);
+      out[w] = block.firstWord + w == wordsPerRow - 1 ? now & lastWordMask
+                                                      : now;
+    };
+    if (row < 0 || row >= block.numRows) {
+      for (int w = fromWord; w < toWord; ++w) {
+        stepHalo(w);
+      }
+      continue;
+    }
+    for (int w = fromWord; w < 0; ++w) {
+      stepHalo(w);
+    }
+    for (int w = max(block.numWords, fromWord); w < toWord; ++w) {
+      stepHalo(w);
+    }
+
+    uint64_t *ages[kAgePlanes];
+    for (int b = 0; b < kAgePlanes; ++b) {
+      ages[b] = agePlanes[b].data() + size_t(row) * block.numWords;
+    }
+    uint64_t *changedOut = changedWords.data() + size_t(row) * block.numWords;
+    int w = max(fromWord, 0);
+    int end = min(toWord, block.numWords);
+#ifdef LIFE_PACKED_HAS_VECTOR
+    // the board's last word needs masking, so it is left to the scalar loop
+    // below
+    int vectorEnd = min(end, wordsPerRow - 1 - block.firstWord);
+    WordVector anyChange{};
+    for (; w + kVectorWords <= vectorEnd; w += kVectorWords) {
+      uint64_t *agesAt[kAgePlanes];
+      for (int b = 0; b < kAgePlanes; ++b) {
+        agesAt[b] = ages[b] + w;
+      }
+      stepWords(rule, up + w, mid + w, down + w, out + w, agesAt,
+                changedOut + w, ~uint64_t(0), true, anyChange,
+                blockPopulation);
+    }
+    changed |= anyBits(anyChange);
+#endif
+    uint64_t tailChange = 0;
+    for (; w < end; ++w) {
+      uint64_t *agesAt[kAgePlanes];
+      for (int b = 0; b < kAgePlanes; ++b) {
+        agesAt[b] = ages[b] + w;
+      }
+      uint64_t mask = block.firstWord + w == wordsPerRow - 1 ? lastWordMask
+                                                             : ~uint64_t(0);
+      stepWords(rule, up + w, mid + w, down + w, out + w, agesAt,
+                changedOut + w, mask, true, tailChange, blockPopulation);
+    }
+    changed |= anyBits(tailChange);
+  }
+  return changed;
+}
+
+bool MpiLife::stepBlock() {
+  LIFE_PROFILE_SCOPE(kPhaseStep);
+  bool swapping = stepsLeft == 0;
+  if (swapping) {
+    startSwap();
+    stepsLeft = depth;
+  }
+  // the halo is stepped as far in as the generations left before the next
+  // swap still need it, and the part past the board's edges never is
+  int reach = stepsLeft - 1;
+  int fromRow = neighbors[kNorth] == MPI_PROC_NULL ? 0 : -reach;
+  int toRow =
+      block.numRows + (neighbors[kSouth] == MPI_PROC_NULL ? 0 : reach);
+  int fromWord = reach > 0 && neighbors[kWest] != MPI_PROC_NULL ? -1 : 0;
+  int toWord = block.numWords +
+               (reach > 0 && neighbors[kEast] != MPI_PROC_NULL ? 1 : 0);
+
+  blockPopulation = 0;
+  bool changed = false;
+  int lastRow = block.numRows - 1;
+  int lastWord = block.numWords - 1;
+  if (swapping && lastRow > 1 && lastWord > 1) {
+    // the inside of the block needs nothing from the halo, so it is
+    // stepped while the halo is on its way, and the edges after
+    changed |= (this->*stepRegionFor)(1, lastRow, 1, lastWord);
+    finishSwap();
+    changed |= (this->*stepRegionFor)(fromRow, 1, fromWord, toWord);
+    changed |= (this->*stepRegionFor)(lastRow, toRow, fromWord, toWord);
+    changed |= (this->*stepRegionFor)(1, lastRow, fromWord, 1);
+    changed |= (this->*stepRegionFor)(1, lastRow, lastWord, toWord);
+  } else {
+    if (swapping)
+      finishSwap();
+    changed = (this->*stepRegionFor)(fromRow, toRow, fromWord, toWord);
+  }
+  swap(live, nextLive);
+  --stepsLeft;
+  ++generationCount;
+  int blockCols = min(cols, (block.firstWord + block.numWords) * 64) -
+                  block.firstWord * 64;
+  LIFE_PROFILE_COUNT(kCellsEvaluated, (long long)block.numRows * blockCols);
+  if (recordChanges) {
+    recordChangedCells();
+    LIFE_PROFILE_COUNT(kCellsChanged, (long long)changes.size());
+  }
+  return changed;
+}
+
+bool MpiLife::step() {
+  bool changed = stepBlock();
+  long long sums[2] = {changed, blockPopulation};
+  MPI_Allreduce(MPI_IN_PLACE, sums, 2, MPI_LONG_LONG, MPI_SUM, grid);
+  livePopulation = sums[1];
+  return sums[0] > 0;
+}
+
+bool MpiLife::stepBy(long long generations) {
+  // whether the block changed in each generation since the last sum, then
+  // its population, all summed at once before the next swap
+  vector<long long> sums;
+  for (long long i = 0; i < generations; ++i) {
+    sums.push_back(stepBlock());
+    if (stepsLeft > 0 && i + 1 < generations)
+      continue;
+    sums.push_back(blockPopulation);
+    MPI_Allreduce(MPI_IN_PLACE, sums.data(), int(sums.size()), MPI_LONG_LONG,
+                  MPI_SUM, grid);
+    livePopulation = sums.back();
+    sums.pop_back();
+    for (long long changed : sums) {
+      if (changed == 0) {
+        // the board has been stable since that generation, so the rest
+        // pass without needing to be stepped, as in LifeEngine::stepBy
+        generationCount += generations - i - 1;
+        return false;
+      }
+    }
+    sums.clear();
+  }
+  return true;
+}
+
+void MpiLife::recordChangedCells() {
+  changes.clear();
+  for (int row = 0; row < block.numRows; ++row) {
+    for (int w = 0; w < block.numWords; ++w) {
+      for (uint64_t bits = changedWords[size_t(row) * block.numWords + w];
+           bits != 0; bits &= bits - 1) {
+        int r = block.firstRow + row;
+        int col = (block.firstWord + w) * 64 + countTrailingZeros(bits);
+        changes.push_back({r, col, ageAt(r, col)});
+      }
+    }
+  }
+}
+
+void MpiLife::packBlock(vector<uint64_t> &words) const {
+  size_t planeWords = size_t(block.numRows) * block.numWords;
+  words.resize((1 + kAgePlanes) * planeWords);
+  for (int row = 0; row < block.numRows; ++row) {
+    const uint64_t *rowWords = liveRow(live, row);
+    copy(rowWords, rowWords + block.numWords,
+         words.begin() + size_t(row) * block.numWords);
+  }
+  for (int b = 0; b < kAgePlanes; ++b) {
+    copy(agePlanes[b].begin(), agePlanes[b].end(),
+         words.begin() + (b + 1) * planeWords);
+  }
+}
+
+/**
+ * Function: makeBlockType
+ * -----------------------
+ * Returns a committed datatype picking a block of the liveness and age
+ * planes of a whole board, laid out as snapshots lay them out.
+ */
+static MPI_Datatype makeBlockType(int rows, int wordsPerRow, int firstRow,
+                                  int numRows, int firstWord, int numWords) {
+  int sizes[3] = {1 + MpiLife::kAgePlanes, rows, wordsPerRow};
+  int subsizes[3] = {1 + MpiLife::kAgePlanes, numRows, numWords};
+  int starts[3] = {0, firstRow, firstWord};
+  MPI_Datatype type;
+  MPI_Type_create_subarray(3, sizes, subsizes, starts, MPI_ORDER_C,
+                           MPI_UINT64_T, &type);
+  MPI_Type_commit(&type);
+  return type;
+}
+
+void MpiLife::saveSnapshot(const string &filename) const {
+  vector<uint64_t> words;
+  packBlock(words);
+  // the block is sent a row of words at a time, which keeps the count in
+  // an int however large the block
+  MPI_Datatype rowType;
+  MPI_Type_contiguous(block.numWords, MPI_UINT64_T, &rowType);
+  MPI_Type_commit(&rowType);
+  MPI_Datatype fileType =
+      makeBlockType(rows, wordsPerRow, block.firstRow, block.numRows,
+                    block.firstWord, block.numWords);
+
+  MPI_File file;
+  bool ok = MPI_File_open(grid, filename.c_str(),
+                          MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL,
+                          &file) == MPI_SUCCESS;
+  if (ok) {
+    string header = snapshotHeader(rows, cols, generationCount);
+    ok = MPI_File_set_size(file, 0) == MPI_SUCCESS;
+    if (ok && rankIndex == 0)
+      ok = MPI_File_write_at(file, 0, header.data(), int(header.size()),
+                             MPI_BYTE, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+    // every rank takes part in the collective calls, whatever went wrong
+    // before them
+    ok &= MPI_File_set_view(file, MPI_Offset(header.size()), MPI_UINT64_T,
+                            fileType, "native",
+                            MPI_INFO_NULL) == MPI_SUCCESS;
+    ok &= MPI_File_write_all(file, words.data(),
+                             (1 + kAgePlanes) * block.numRows, rowType,
+                             MPI_STATUS_IGNORE) == MPI_SUCCESS;
+    ok &= MPI_File_close(&file) == MPI_SUCCESS;
+  }
+  MPI_Type_free(&fileType);
+  MPI_Type_free(&rowType);
+
+  // a failure on any rank is reported on all of them, so they all stop
+  int failed = !ok;
+  MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX, grid);
+  if (failed)
+    error("Can not write file " + filename);
+}
+
+bool MpiLife::gatherOnRoot(LifeEngine &engine) const {
+  vector<uint64_t> words;
+  packBlock(words);
+  MPI_Datatype rowType;
+  MPI_Type_contiguous(block.numWords, MPI_UINT64_T, &rowType);
+  MPI_Type_commit(&rowType);
+  int count = (1 + kAgePlanes) * block.numRows;
+  if (rankIndex != 0) {
+    MPI_Send(words.data(), count, rowType, 0, kGatherTag, grid);
+    MPI_Type_free(&rowType);
+    return false;
+  }
+
+  size_t planeWords = size_t(rows) * wordsPerRow;
+  vector<uint64_t> board((1 + kAgePlanes) * planeWords, 0);
+  for (int source = 0; source < rankCount; ++source) {
+    int coords[2];
+    MPI_Cart_coords(grid, source, 2, coords);
+    Block part = blockOf(coords);
+    MPI_Datatype partType =
+        makeBlockType(rows, wordsPerRow, part.firstRow, part.numRows,
+                      part.firstWord, part.numWords);
+    if (source == 0) {
+      MPI_Sendrecv(words.data(), count, rowType, 0, kGatherTag, board.data(),
+                   1, partType, 0, kGatherTag, grid, MPI_STATUS_IGNORE);
+    } else {
+      MPI_Recv(board.data(), 1, partType, source, kGatherTag, grid,
+               MPI_STATUS_IGNORE);
+    }
+    MPI_Type_free(&partType);
+  }
+  MPI_Type_free(&rowType);
+
+  SnapshotView view;
+  view.rows = rows;
+  view.cols = cols;
+  view.wordsPerRow = wordsPerRow;
+  view.generation = generationCount;
+  view.live = board.data();
+  for (int b = 0; b < kAgePlanes; ++b) {
+    view.ages[b] = board.data() + (b + 1) * planeWords;
+  }
+  engine.loadSnapshot(view);
+  return true;
+}
+#endif
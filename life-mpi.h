@@ -0,0 +1,221 @@
+/**
+ * File: life-mpi.h
+ * ----------------
+ * Defines a stepping engine that spreads one board over the ranks of an MPI
+ * job, for boards too large for one machine's memory. The board is cut into
+ * a grid of blocks, one per rank, and each block is stored and stepped a
+ * word at a time as the packed engine does, with the kernel of
+ * life-kernel.h. Around its block every rank keeps a halo of the cells its
+ * eight neighbors own, depth cells deep, which it swaps with them once
+ * every depth generations: in between, it steps the halo along with the
+ * block, one cell less of it each generation. The swap is started before
+ * the generation that needs it and runs while the block's inside, which
+ * needs no halo, is stepped.
+ *
+ * Every rank runs the same program and makes the same calls on its engine
+ * in the same order, since loading, stepping and saving are collective.
+ * The engine is only built with LIFE_HAVE_MPI defined (qmake CONFIG+=mpi),
+ * which also builds with the MPI compiler wrappers; run the program under
+ * mpirun.
+ */
+
+#pragma once
+#ifdef LIFE_HAVE_MPI
+#include "grid.h"        // for Grid
+#include "life-engine.h" // for LifeEngine
+#include <cstdint>       // for uint64_t
+#include <string>        // for std::string
+#include <vector>        // for std::vector
+
+// the engine only uses the C interface, so skip the old C++ bindings
+#define OMPI_SKIP_MPICXX 1
+#define MPICH_SKIP_MPICXX 1
+#include <mpi.h>
+
+class MpiLife : public LifeEngine {
+public:
+  /**
+   * Constructs an empty engine over every rank of MPI_COMM_WORLD, starting
+   * MPI first if the program has not. Call load before stepping.
+   */
+  MpiLife();
+  ~MpiLife() override;
+
+  /**
+   * These take the whole board on every rank, and each rank keeps its own
+   * block. Ages above kMaxAge are stored as kMaxAge, and a pattern's live
+   * cells start at age 1.
+   */
+  void load(const Grid<int> &grid) override;
+  void loadPattern(const PackedPattern &pattern) override;
+
+  /**
+   * Copies only the rank's block out of the snapshot, so from a mapped
+   * snapshot file no rank reads more than its own part.
+   */
+  void loadSnapshot(const SnapshotView &snapshot) override;
+
+  /**
+   * Loads the board generateRandomPattern returns for the same arguments,
+   * each rank generating only its own block, so the board is never whole
+   * anywhere.
+   */
+  void loadRandom(int numRows, int numCols, double density, uint64_t seed);
+
+  /**
+   * Steps the block, swapping halos first when the last swap is used up,
+   * and sums whether anything changed and the population over every rank.
+   */
+  bool step() override;
+
+  /**
+   * Sums over the ranks only once per swap of the halos, rather than every
+   * generation as step does.
+   */
+  bool stepBy(long long generations) override;
+  void clear() override;
+
+  int numRows() const override { return rows; }
+  int numCols() const override { return cols; }
+
+  /**
+   * Returns the age of a cell in the rank's own block, and 0 for any other
+   * cell. The exports and the change list likewise only hold the block;
+   * gatherOnRoot copies the whole board onto one rank.
+   */
+  int ageAt(int row, int col) const override;
+
+  /**
+   * The population of the whole board, summed over the ranks by step.
+   */
+  long long population() const override { return livePopulation; }
+
+  /**
+   * A board only wraps around if its width is a multiple of 64, so every
+   * rank's halo is whole words; loading a narrower torus is reported
+   * through error.
+   */
+  bool setTorus(bool torus) override;
+  void setRule(const LifeRule &rule) override;
+
+  /**
+   * Sets how many cells deep the halos are, and so how many generations
+   * pass between swaps, from 1 (the default) to kMaxHaloDepth. Deeper halos
+   * send fewer, larger messages and step a little more of each neighbor's
+   * cells. Takes effect at the next load, which also limits the depth to
+   * the rows of the shortest block.
+   */
+  void setHaloDepth(int depth);
+  int haloDepth() const { return depth; }
+
+  /**
+   * Saves the board as a snapshot, every rank writing its own block of the
+   * file at once with MPI-IO. Problems are reported through error.
+   */
+  void saveSnapshot(const std::string &filename) const;
+
+  /**
+   * Copies the whole board onto the first rank and loads it into the given
+   * engine there, for the formats that need the board in one place.
+   * Returns true on the first rank and false, leaving the engine alone, on
+   * the others.
+   */
+  bool gatherOnRoot(LifeEngine &engine) const;
+
+  int rank() const { return rankIndex; }
+  int numRanks() const { return rankCount; }
+
+  static const int kAgePlanes = 4;     // enough bits to count up to kMaxAge
+  static const int kMaxHaloDepth = 64; // the halo's columns are one word
+
+private:
+  /**
+   * Type: Block
+   * -----------
+   * The part of the board one rank owns: rows firstRow on and words
+   * firstWord on of every row.
+   */
+  struct Block {
+    int firstRow;
+    int numRows;
+    int firstWord;
+    int numWords;
+  };
+
+  int rows;
+  int cols;
+  int wordsPerRow; // words holding real cells in each row of the board
+  bool torus;
+  uint64_t lastWordMask; // the bits of the board's last word that are cells
+  long long livePopulation;
+  long long blockPopulation; // the live cells of this rank's block
+  int requestedDepth;
+  int depth;      // rows of halo above and below the block
+  int stepsLeft;  // generations the halo can be stepped before a swap
+
+  int rankIndex;
+  int rankCount;
+  MPI_Comm grid;    // the ranks as a periodic grid of blocks
+  int gridDims[2];  // rows and columns of blocks
+  int gridCoords[2];
+  Block block;
+  int neighbors[8];          // ranks in the directions of kDirections
+  MPI_Datatype sendTypes[8]; // the cells sent to each neighbor
+  MPI_Datatype recvTypes[8]; // the halo received from each
+  MPI_Request requests[16];
+
+  // Liveness is stored with the halo around the block, depth rows above
+  // and below and one word to the left and right, and one more word of
+  // padding outside the halo on either side, which stays empty so the
+  // kernel never needs a bounds check. Past the board's edges, unless it
+  // wraps around, the halo stays empty as well.
+  int stride; // words per row, the block's and four more
+  std::vector<uint64_t> live;
+  std::vector<uint64_t> nextLive;
+
+  // Bit plane b holds bit b of the age of every cell of the block, and
+  // changedWords the cells that changed in the last step, block.numWords
+  // words per row with no halo.
+  std::vector<uint64_t> agePlanes[kAgePlanes];
+  std::vector<uint64_t> changedWords;
+
+  uint64_t *liveRow(std::vector<uint64_t> &words, int row) {
+    return words.data() + size_t(row + depth) * stride + 2;
+  }
+  const uint64_t *liveRow(const std::vector<uint64_t> &words,
+                          int row) const {
+    return words.data() + size_t(row + depth) * stride + 2;
+  }
+  bool inBlock(int row, int col) const {
+    return row >= block.firstRow && row < block.firstRow + block.numRows &&
+           col / 64 >= block.firstWord &&
+           col / 64 < block.firstWord + block.numWords;
+  }
+
+  // steps the rows and words of the given range, halo included, with the
+  // kernel for the current rule; returns whether any cell of the block
+  // changed
+  typedef bool (MpiLife::*RegionStepper)(int fromRow, int toRow,
+                                         int fromWord, int toWord);
+  RegionStepper stepRegionFor;
+
+  void resize(int numRows, int numCols);
+  void releaseGrid();
+  void pickGrid();
+  Block blockOf(const int coords[2]) const;
+  void findNeighbors();
+  void buildHaloTypes();
+  void startSwap();
+  void finishSwap();
+  template <typename Rule>
+  bool stepRegion(int fromRow, int toRow, int fromWord, int toWord);
+  bool stepBlock();
+  void resetAges();
+  void sumPopulation();
+  void packBlock(std::vector<uint64_t> &words) const;
+  void recordChangedCells();
+
+  MpiLife(const MpiLife &original);
+  void operator=(const MpiLife &rhs) const;
+};
+#endif
@@ -0,0 +1,333 @@
+/**
+ * File: life-packed.cpp
+ * ---------------------
+ * Implements the bit-packed stepping engine. Each generation is computed a
+ * word at a time by the kernel in life-kernel.h, over vectors of words
+ * where the compiler supports them (see CONFIG+=native in conway.pro).
+ * Age tracking costs a handful of bitwise operations per 64 cells and is
+ * skipped entirely for empty words.
+ */
+
+#include <algorithm> // for fill, max, min
+#include <utility>   // for swap
+using namespace std;
+
+#include "life-constants.h" // for kMaxAge
+#include "life-kernel.h"    // for stepWords, countWordBlocks
+#include "life-packed.h"
+#include "life-profile.h"   // for LIFE_PROFILE_SCOPE, LIFE_PROFILE_COUNT
+
+static_assert(PackedLife::kAgePlanes == kSnapshotAgePlanes,
+              "snapshots copy the age planes as they are");
+
+PackedLife::PackedLife()
+    : rows(0), cols(0), wordsPerRow(0), stride(2), trackAges(true),
+      torus(false), lastWordMask(~uint64_t(0)), livePopulation(0),
+      stepBoardFor(&PackedLife::stepBoard<ConwayRule>) {}
+
+void PackedLife::resize(int numRows, int numCols) {
+  rows = numRows;
+  cols = numCols;
+  generationCount = 0;
+  wordsPerRow = (cols + 63) / 64;
+  stride = wordsPerRow + 2;
+  lastWordMask =
+      cols % 64 == 0 ? ~uint64_t(0) : (uint64_t(1) << (cols % 64)) - 1;
+  live.assign((rows + 2) * stride, 0);
+  nextLive.assign((rows + 2) * stride, 0);
+  for (auto &plane : agePlanes) {
+    plane.assign(rows * wordsPerRow, 0);
+  }
+  changedWords.assign(rows * wordsPerRow, 0);
+  LIFE_PROFILE_COUNT(kAllocations, 3 + kAgePlanes);
+}
+
+void PackedLife::countPopulation() {
+  livePopulation = 0;
+  for (int row = 0; row < rows; ++row) {
+    const uint64_t *words = liveRow(live, row);
+    for (int w = 0; w < wordsPerRow; ++w) {
+      livePopulation += countBits(words[w]);
+    }
+  }
+}
+
+void PackedLife::load(const Grid<int> &grid) {
+  resize(grid.numRows(), grid.numCols());
+  for (int row = 0; row < rows; ++row) {
+    uint64_t *words = liveRow(live, row);
+    for (int col = 0; col < cols; ++col) {
+      int age = min(grid[row][col], kMaxAge);
+      if (age <= 0)
+        continue;
+      uint64_t bit = uint64_t(1) << (col % 64);
+      words[col / 64] |= bit;
+      for (int b = 0; b < kAgePlanes; ++b) {
+        if ((age >> b) & 1)
+          agePlanes[b][row * wordsPerRow + col / 64] |= bit;
+      }
+    }
+  }
+  countPopulation();
+}
+
+void PackedLife::loadPattern(const PackedPattern &pattern) {
+  resize(pattern.rows, pattern.cols);
+  for (int row = 0; row < rows; ++row) {
+    const uint64_t *words =
+        pattern.bits.data() + size_t(row) * pattern.wordsPerRow;
+    copy(words, words + wordsPerRow, liveRow(live, row));
+  }
+  resetAges();
+  countPopulation();
+}
+
+void PackedLife::exportPattern(PackedPattern &pattern) const {
+  pattern.rows = rows;
+  pattern.cols = cols;
+  pattern.wordsPerRow = wordsPerRow;
+  pattern.bits.resize(size_t(rows) * wordsPerRow);
+  for (int row = 0; row < rows; ++row) {
+    const uint64_t *words = liveRow(live, row);
+    copy(words, words + wordsPerRow,
+         pattern.bits.begin() + size_t(row) * wordsPerRow);
+  }
+}
+
+void PackedLife::loadSnapshot(const SnapshotView &snapshot) {
+  resize(snapshot.rows, snapshot.cols);
+  for (int row = 0; row < rows; ++row) {
+    const uint64_t *words = snapshot.live + size_t(row) * wordsPerRow;
+    copy(words, words + wordsPerRow, liveRow(live, row));
+  }
+  if (trackAges) {
+    for (int b = 0; b < kAgePlanes; ++b) {
+      copy(snapshot.ages[b], snapshot.ages[b] + agePlanes[b].size(),
+           agePlanes[b].begin());
+    }
+  }
+  generationCount = snapshot.generation;
+  countPopulation();
+}
+
+void PackedLife::exportSnapshot(SnapshotBuffer &snapshot) const {
+  for (int row = 0; row < rows; ++row) {
+    const uint64_t *words = liveRow(live, row);
+    copy(words, words + wordsPerRow,
+         snapshot.live + size_t(row) * wordsPerRow);
+  }
+  if (trackAges) {
+    for (int b = 0; b < kAgePlanes; ++b) {
+      copy(agePlanes[b].begin(), agePlanes[b].end(), snapshot.ages[b]);
+    }
+  } else {
+    // untracked live cells are all at age 1
+    copy(snapshot.live, snapshot.live + size_t(rows) * wordsPerRow,
+         snapshot.ages[0]);
+  }
+}
+
+void PackedLife::clear() {
+  fill(live.begin(), live.end(), 0);
+  livePopulation = 0;
+  for (auto &plane : agePlanes) {
+    fill(plane.begin(), plane.end(), 0);
+  }
+}
+
+int PackedLife::ageAt(int row, int col) const {
+  if (!isAlive(row, col))
+    return 0;
+  if (!trackAges)
+    return 1;
+  int age = 0;
+  for (int b = 0; b < kAgePlanes; ++b) {
+    age |= int((agePlanes[b][row * wordsPerRow + col / 64] >> (col % 64)) & 1)
+           << b;
+  }
+  return age;
+}
+
+void PackedLife::countBlocks(const BoardView &view,
+                             vector<int> &counts) const {
+  counts.assign(size_t(view.rows) * view.cols, 0);
+  int bottom = min(view.top + view.rows * view.blockSize, rows);
+  int right = min(view.left + view.cols * view.blockSize, cols);
+  if (right <= view.left)
+    return;
+  for (int row = max(view.top, 0); row < bottom; ++row) {
+    const uint64_t *words = liveRow(live, row);
+    int *blockRow = counts.data() +
+                    size_t((row - view.top) / view.blockSize) * view.cols;
+    for (int w = view.left / 64; w <= (right - 1) / 64; ++w) {
+      uint64_t word = w == wordsPerRow - 1 ? words[w] & lastWordMask : words[w];
+      countWordBlocks(word, w * 64, view, blockRow);
+    }
+  }
+}
+
+void PackedLife::exportView(const BoardView &view,
+                            vector<uint8_t> &ages) const {
+  ages.assign(size_t(view.rows) * view.cols, 0);
+  int bottom = min(view.top + view.rows, rows);
+  int left = max(view.left, 0);
+  int right = min(view.left + view.cols, cols);
+  if (right <= left)
+    return;
+  for (int row = max(view.top, 0); row < bottom; ++row) {
+    const uint64_t *words = liveRow(live, row);
+    uint8_t *rowAges = ages.data() + size_t(row - view.top) * view.cols;
+    for (int w = left / 64; w <= (right - 1) / 64; ++w) {
+      int low = max(left - w * 64, 0);
+      int high = min(right - w * 64, 64);
+      uint64_t mask = (high == 64 ? ~uint64_t(0) : (uint64_t(1) << high) - 1) &
+                      ~((uint64_t(1) << low) - 1);
+      for (uint64_t bits = words[w] & mask; bits != 0; bits &= bits - 1) {
+        int col = w * 64 + countTrailingZeros(bits);
+        rowAges[col - view.left] = uint8_t(ageAt(row, col));
+      }
+    }
+  }
+}
+
+void PackedLife::setTrackAges(bool track) {
+  if (track && !trackAges) {
+    trackAges = true;
+    resetAges();
+  }
+  trackAges = track;
+}
+
+void PackedLife::setRule(const LifeRule &rule) {
+  LifeEngine::setRule(rule);
+  stepBoardFor = dispatchRule(rule, [](auto kind) -> BoardStepper {
+    return &PackedLife::stepBoard<decltype(kind)>;
+  });
+}
+
+bool PackedLife::setTorus(bool torus) {
+  if (this->torus && !torus)
+    clearHalo();
+  this->torus = torus;
+  return true;
+}
+
+void PackedLife::fillHalo() {
+  for (int row = 0; row < rows; ++row) {
+    uint64_t *words = liveRow(live, row);
+    uint64_t first = words[0] & 1;
+    uint64_t last = (words[(cols - 1) / 64] >> ((cols - 1) % 64)) & 1;
+    words[-1] = last << 63;
+    if (cols % 64 == 0) {
+      words[wordsPerRow] = first;
+    } else {
+      words[wordsPerRow - 1] |= first << (cols % 64);
+    }
+  }
+  // the padding rows are copied with their padding words, which fills the
+  // corners
+  const uint64_t *lastRow = liveRow(live, rows - 1) - 1;
+  copy(lastRow, lastRow + stride, liveRow(live, -1) - 1);
+  const uint64_t *firstRow = liveRow(live, 0) - 1;
+  copy(firstRow, firstRow + stride, liveRow(live, rows) - 1);
+}
+
+void PackedLife::clearHalo() {
+  for (vector<uint64_t> *words : {&live, &nextLive}) {
+    fill(words->begin(), words->begin() + stride, 0);
+    fill(words->end() - stride, words->end(), 0);
+    for (int row = 0; row < rows; ++row) {
+      uint64_t *rowWords = liveRow(*words, row);
+      rowWords[-1] = 0;
+      rowWords[wordsPerRow - 1] &= lastWordMask;
+      rowWords[wordsPerRow] = 0;
+    }
+  }
+}
+
+void PackedLife::resetAges() {
+  for (auto &plane : agePlanes) {
+    fill(plane.begin(), plane.end(), 0);
+  }
+  for (int row = 0; row < rows; ++row) {
+    const uint64_t *words = liveRow(live, row);
+    for (int w = 0; w < wordsPerRow; ++w) {
+      agePlanes[0][row * wordsPerRow + w] = words[w];
+    }
+  }
+}
+
+template <typename Rule> bool PackedLife::stepBoard() {
+  const Rule rule(lifeRule);
+  bool changed = false;
+  long long population = 0;
+  for (int row = 0; row < rows; ++row) {
+    const uint64_t *up = liveRow(live, row - 1);
+    const uint64_t *mid = liveRow(live, row);
+    const uint64_t *down = liveRow(live, row + 1);
+    uint64_t *out = liveRow(nextLive, row);
+    uint64_t *ages[kAgePlanes];
+    for (int b = 0; b < kAgePlanes; ++b) {
+      ages[b] = agePlanes[b].data() + row * wordsPerRow;
+    }
+    uint64_t *changedOut = changedWords.data() + row * wordsPerRow;
+
+    int w = 0;
+#ifdef LIFE_PACKED_HAS_VECTOR
+    // the last word of each row needs masking, so it is left to the scalar
+    // loop below
+    WordVector anyChange{};
+    for (; w + kVectorWords < wordsPerRow; w += kVectorWords) {
+      uint64_t *agesAt[kAgePlanes];
+      for (int b = 0; b < kAgePlanes; ++b) {
+        agesAt[b] = ages[b] + w;
+      }
+      stepWords(rule, up + w, mid + w, down + w, out + w, agesAt,
+                changedOut + w, ~uint64_t(0), trackAges, anyChange,
+                population);
+    }
+    changed |= anyBits(anyChange);
+#endif
+    uint64_t tailChange = 0;
+    for (; w < wordsPerRow; ++w) {
+      uint64_t *agesAt[kAgePlanes];
+      for (int b = 0; b < kAgePlanes; ++b) {
+        agesAt[b] = ages[b] + w;
+      }
+      uint64_t mask = w == wordsPerRow - 1 ? lastWordMask : ~uint64_t(0);
+      stepWords(rule, up + w, mid + w, down + w, out + w, agesAt,
+                changedOut + w, mask, trackAges, tailChange, population);
+    }
+    changed |= anyBits(tailChange);
+  }
+  livePopulation = population;
+  return changed;
+}
+
+bool PackedLife::step() {
+  LIFE_PROFILE_SCOPE(kPhaseStep);
+  if (torus)
+    fillHalo();
+  bool changed = (this->*stepBoardFor)();
+  swap(live, nextLive);
+  ++generationCount;
+  LIFE_PROFILE_COUNT(kCellsEvaluated, (long long)rows * cols);
+  if (recordChanges) {
+    recordChangedCells();
+    LIFE_PROFILE_COUNT(kCellsChanged, (long long)changes.size());
+  }
+  return changed;
+}
+
+void PackedLife::recordChangedCells() {
+  changes.clear();
+  for (int row = 0; row < rows; ++row) {
+    for (int w = 0; w < wordsPerRow; ++w) {
+      for (uint64_t bits = changedWords[row * wordsPerRow + w]; bits != 0;
+           bits &= bits - 1) {
+        int col = w * 64 + countTrailingZeros(bits);
+        changes.push_back({row, col, ageAt(row, col)});
+      }
+    }
+  }
+}
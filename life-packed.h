@@ -0,0 +1,124 @@
+/**
+ * File: life-packed.h
+ * -------------------
+ * Defines a stepping engine that stores liveness as packed bitboards, one
+ * bit per cell and 64 cells per word, and applies the rule to whole words
+ * at a time with bitwise adder logic.
+ */
+
+#pragma once
+#include "grid.h"        // for Grid
+#include "life-engine.h" // for LifeEngine
+#include <cstdint>       // for uint64_t
+#include <vector>        // for std::vector
+
+class PackedLife : public LifeEngine {
+public:
+  /**
+   * Constructs an empty engine. Call load before stepping.
+   */
+  PackedLife();
+
+  /**
+   * Packs the given grid of ages into the engine. Ages above kMaxAge are
+   * stored as kMaxAge, which the display treats the same way.
+   */
+  void load(const Grid<int> &grid) override;
+
+  /**
+   * Copies the pattern's bits in as they are, with every live cell at age 1.
+   */
+  void loadPattern(const PackedPattern &pattern) override;
+  void exportPattern(PackedPattern &pattern) const override;
+
+  /**
+   * Snapshots are stored in the engine's own layout, so these copy whole
+   * rows of words.
+   */
+  void loadSnapshot(const SnapshotView &snapshot) override;
+  void exportSnapshot(SnapshotBuffer &snapshot) const override;
+
+  bool step() override;
+  void clear() override;
+
+  int numRows() const override { return rows; }
+  int numCols() const override { return cols; }
+
+  int ageAt(int row, int col) const override;
+
+  /**
+   * The population is counted by step itself, so this is free.
+   */
+  long long population() const override { return livePopulation; }
+
+  void countBlocks(const BoardView &view,
+                   std::vector<int> &counts) const override;
+  void exportView(const BoardView &view,
+                  std::vector<uint8_t> &ages) const override;
+
+  /**
+   * Turns age tracking on or off. Ages live in a separate set of bit planes
+   * that step only touches while tracking is on; with tracking off every
+   * live cell reports age 1 and a board counts as stable as soon as its
+   * liveness stops changing. Turning tracking back on restarts every live
+   * cell at age 1.
+   */
+  void setTrackAges(bool track);
+
+  bool setTorus(bool torus) override;
+  void setRule(const LifeRule &rule) override;
+
+  static const int kAgePlanes = 4; // enough bits to count up to kMaxAge
+
+private:
+
+  int rows;
+  int cols;
+  int wordsPerRow; // words holding real cells in each row
+  int stride;      // words per row including one padding word on each side
+  bool trackAges;
+  bool torus;
+  uint64_t lastWordMask; // the bits of the last word in a row that are cells
+  long long livePopulation;
+
+  // Liveness is stored with a ring of padding, one row above and below the
+  // board and one word to the left and right of each row, so the rule kernel
+  // never needs a bounds check. With a dead border the padding stays empty;
+  // on a torus it is refilled with the opposite edges before every step,
+  // and the bit just past the last cell of each row holds the row's first
+  // cell.
+  std::vector<uint64_t> live;
+  std::vector<uint64_t> nextLive;
+
+  // Bit plane b holds bit b of every cell's age, wordsPerRow words per row
+  // with no padding.
+  std::vector<uint64_t> agePlanes[kAgePlanes];
+
+  // the cells that changed in the last step, one bit per cell like the age
+  // planes
+  std::vector<uint64_t> changedWords;
+
+  uint64_t *liveRow(std::vector<uint64_t> &words, int row) {
+    return words.data() + (row + 1) * stride + 1;
+  }
+  const uint64_t *liveRow(const std::vector<uint64_t> &words, int row) const {
+    return words.data() + (row + 1) * stride + 1;
+  }
+  bool isAlive(int row, int col) const {
+    return (liveRow(live, row)[col / 64] >> (col % 64)) & 1;
+  }
+  // the kernel stepping every row, instantiated for the current rule
+  typedef bool (PackedLife::*BoardStepper)();
+  BoardStepper stepBoardFor;
+
+  void resize(int numRows, int numCols);
+  template <typename Rule> bool stepBoard();
+  void fillHalo();
+  void clearHalo();
+  void resetAges();
+  void countPopulation();
+  void recordChangedCells();
+
+  PackedLife(const PackedLife &original);
+  void operator=(const PackedLife &rhs) const;
+};
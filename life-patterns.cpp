@@ -0,0 +1,230 @@
+/**
+ * File: life-patterns.cpp
+ * -----------------------
+ * Implements the pattern file reader and the random board generators.
+ */
+
+#include <algorithm> // for min
+#include <cmath>     // for lround
+#include <cstring>   // for memchr
+#include <random>    // for random utilities
+using namespace std;
+
+#if defined(__SSE2__)
+#include <emmintrin.h> // for _mm_cmpeq_epi8, _mm_movemask_epi8
+#elif defined(__aarch64__)
+#include <arm_neon.h> // for vceqq_u8, vaddv_u8
+#endif
+
+#include "error.h"  // for error
+#include "strlib.h" // for stringIsInteger, stringToInteger, trim
+
+#include "life-constants.h"   // for kMaxAge
+#include "life-mapped-file.h" // for class MappedFile
+#include "life-patterns.h"
+#include "life-thread-pool.h" // for class LifeThreadPool
+
+enum CellState : int { Empty = 0, Occupied = 1 };
+
+/**
+ * Function: packCells
+ * -------------------
+ * Sets the bit in out of every 'X' among the given cells, 16 at a time
+ * where the CPU has 16-byte vector compares. Returns false if any cell is
+ * neither 'X' nor '-'. The words in out must start out zero.
+ */
+static bool packCells(const char *cells, int count, uint64_t *out) {
+  bool valid = true;
+  int col = 0;
+#if defined(__SSE2__)
+  const __m128i live = _mm_set1_epi8('X');
+  const __m128i dead = _mm_set1_epi8('-');
+  for (; col + 16 <= count; col += 16) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(cells + col));
+    unsigned isLive = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, live)));
+    unsigned isDead = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, dead)));
+    valid &= (isLive | isDead) == 0xffff;
+    out[col / 64] |= uint64_t(isLive) << (col % 64);
+  }
+#elif defined(__aarch64__)
+  // NEON has no movemask, so weight each matching byte by its bit and add
+  const uint8x16_t weights = {1, 2, 4, 8, 16, 32, 64, 128,
+                              1, 2, 4, 8, 16, 32, 64, 128};
+  const uint8x16_t live = vdupq_n_u8('X');
+  const uint8x16_t dead = vdupq_n_u8('-');
+  for (; col + 16 <= count; col += 16) {
+    uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t *>(cells + col));
+    uint8x16_t isLive = vandq_u8(vceqq_u8(chunk, live), weights);
+    uint8x16_t isDead = vandq_u8(vceqq_u8(chunk, dead), weights);
+    unsigned liveBits = vaddv_u8(vget_low_u8(isLive)) |
+                        unsigned(vaddv_u8(vget_high_u8(isLive))) << 8;
+    unsigned deadBits = vaddv_u8(vget_low_u8(isDead)) |
+                        unsigned(vaddv_u8(vget_high_u8(isDead))) << 8;
+    valid &= (liveBits | deadBits) == 0xffff;
+    out[col / 64] |= uint64_t(liveBits) << (col % 64);
+  }
+#endif
+  for (; col < count; ++col) {
+    char cell = cells[col];
+    valid &= cell == 'X' || cell == '-';
+    out[col / 64] |= uint64_t(cell == 'X') << (col % 64);
+  }
+  return valid;
+}
+
+/**
+ * Function: nextLine
+ * ------------------
+ * Returns the length of the line starting at pos, without the line break or
+ * a carriage return before it, and moves pos past the line break.
+ */
+static size_t nextLine(const char *&pos, const char *end) {
+  const char *lineEnd =
+      static_cast<const char *>(memchr(pos, '\n', size_t(end - pos)));
+  if (!lineEnd)
+    lineEnd = end;
+  size_t length = size_t(lineEnd - pos);
+  if (length > 0 && pos[length - 1] == '\r')
+    --length;
+  pos = lineEnd == end ? end : lineEnd + 1;
+  return length;
+}
+
+static int readDimension(const char *&pos, const char *end,
+                         const string &filename, const string &what) {
+  if (pos == end)
+    error(filename + ": the file ends before the board's " + what);
+  const char *start = pos;
+  string line = trim(string(start, nextLine(pos, end)));
+  if (!stringIsInteger(line) || stringToInteger(line) <= 0)
+    error(filename + ": expected the board's " + what + ", got \"" + line +
+          "\"");
+  return stringToInteger(line);
+}
+
+PackedPattern readPackedPattern(const string &filename) {
+  MappedFile file(filename);
+  const char *pos = file.data();
+  const char *end = pos + file.size();
+
+  while (pos != end && *pos == '#') {
+    nextLine(pos, end);
+  }
+  PackedPattern pattern;
+  pattern.rows = readDimension(pos, end, filename, "height");
+  pattern.cols = readDimension(pos, end, filename, "width");
+  pattern.wordsPerRow = (pattern.cols + 63) / 64;
+  pattern.bits.assign(size_t(pattern.rows) * pattern.wordsPerRow, 0);
+
+  for (int row = 0; row < pattern.rows; ++row) {
+    if (pos == end)
+      error(filename + ": the file ends after " + to_string(row) + " of " +
+            to_string(pattern.rows) + " rows");
+    const char *cells = pos;
+    size_t length = nextLine(pos, end);
+    if (length != size_t(pattern.cols))
+      error(filename + ": row " + to_string(row + 1) + " has " +
+            to_string(length) + " cells, expected " +
+            to_string(pattern.cols));
+    uint64_t *words =
+        pattern.bits.data() + size_t(row) * pattern.wordsPerRow;
+    if (!packCells(cells, pattern.cols, words))
+      error(filename + ": row " + to_string(row + 1) +
+            " has a cell that is neither 'X' nor '-'");
+  }
+  return pattern;
+}
+
+Grid<int> unpackPattern(const PackedPattern &pattern) {
+  Grid<int> grid(pattern.rows, pattern.cols);
+  for (int row = 0; row < pattern.rows; ++row) {
+    for (int col = 0; col < pattern.cols; ++col) {
+      grid[row][col] =
+          pattern.isAlive(row, col) ? CellState::Occupied : CellState::Empty;
+    }
+  }
+  return grid;
+}
+
+Grid<int> readGridFromFile(const string &filename) {
+  return unpackPattern(readPackedPattern(filename));
+}
+
+Grid<int> generateRandomGrid(int rows, int cols, double density,
+                             uint64_t seed) {
+  std::mt19937_64 gen(seed);
+  Grid<int> grid(rows, cols);
+  // random generator to flip either empty or occupied
+  std::bernoulli_distribution occupiedGen(density);
+  // age generator between 1 and kMaxAge
+  std::uniform_int_distribution<> ageGen(1, kMaxAge);
+  for (auto &cell : grid) {
+    cell = occupiedGen(gen) ? ageGen(gen) : CellState::Empty;
+  }
+  return grid;
+}
+
+uint64_t counterRandom(uint64_t seed, uint64_t counter) {
+  // the output function of splitmix64, applied to the counter-th state of
+  // the stream, so no state has to be carried from one word to the next
+  uint64_t z = seed + (counter + 1) * 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static const int kDensityBits = 16; // the precision of a random density
+static const int kRowsPerBlock = 64;
+
+void generateRandomWords(int cols, double density, uint64_t seed,
+                         int firstRow, int numRows, int firstWord,
+                         int numWords, uint64_t *out, size_t outStride) {
+  int wordsPerRow = (cols + 63) / 64;
+  uint64_t lastWordMask =
+      cols % 64 == 0 ? ~uint64_t(0) : (uint64_t(1) << (cols % 64)) - 1;
+
+  // a bit is alive with probability 0.b1b2...b16 in binary if, from the
+  // least significant digit up, each 1 ors in a fresh random word and each
+  // 0 ands one in: every step halves the chance so far and adds b / 2
+  long threshold = lround(min(max(density, 0.0), 1.0) * (1 << kDensityBits));
+  bool alwaysAlive = threshold == 1 << kDensityBits;
+  int lowestDigit = 0; // digits below the lowest 1 leave the word at 0
+  while (lowestDigit < kDensityBits && ((threshold >> lowestDigit) & 1) == 0) {
+    ++lowestDigit;
+  }
+
+  for (int row = firstRow; row < firstRow + numRows; ++row) {
+    uint64_t *words = out + size_t(row - firstRow) * outStride;
+    for (int w = firstWord; w < firstWord + numWords; ++w) {
+      uint64_t counter = (uint64_t(row) * wordsPerRow + w) * kDensityBits;
+      uint64_t word = alwaysAlive ? ~uint64_t(0) : 0;
+      for (int digit = lowestDigit; digit < kDensityBits; ++digit) {
+        uint64_t random = counterRandom(seed, counter + digit);
+        word = (threshold >> digit) & 1 ? word | random : word & random;
+      }
+      words[w - firstWord] =
+          w == wordsPerRow - 1 ? word & lastWordMask : word;
+    }
+  }
+}
+
+PackedPattern generateRandomPattern(int rows, int cols, double density,
+                                    uint64_t seed, int numThreads) {
+  PackedPattern pattern;
+  pattern.rows = rows;
+  pattern.cols = cols;
+  pattern.wordsPerRow = (cols + 63) / 64;
+  pattern.bits.assign(size_t(rows) * pattern.wordsPerRow, 0);
+  auto fillBlock = [&](int block) {
+    int firstRow = block * kRowsPerBlock;
+    int numRows = min(kRowsPerBlock, rows - firstRow);
+    generateRandomWords(
+        cols, density, seed, firstRow, numRows, 0, pattern.wordsPerRow,
+        pattern.bits.data() + size_t(firstRow) * pattern.wordsPerRow,
+        size_t(pattern.wordsPerRow));
+  };
+  LifeThreadPool pool(numThreads);
+  pool.run((rows + kRowsPerBlock - 1) / kRowsPerBlock, fillBlock);
+  return pattern;
+}
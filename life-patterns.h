@@ -0,0 +1,107 @@
+/**
+ * File: life-patterns.h
+ * ---------------------
+ * Defines the ways of producing a starting board: reading a pattern file
+ * or generating a random board.
+ */
+
+#pragma once
+#include "grid.h"   // for Grid
+#include <cstdint>  // for uint64_t
+#include <string>   // for std::string
+#include <vector>   // for std::vector
+
+/**
+ * Type: PackedPattern
+ * -------------------
+ * A board's liveness packed one bit per cell, as the packed engine stores
+ * it: row after row of wordsPerRow words, with column c in bit c % 64 of
+ * word c / 64 of its row. Bits past the last column are zero.
+ *
+ * Formats that record a rule fill in rule, in B/S notation; it is empty
+ * for the others.
+ */
+struct PackedPattern {
+  int rows = 0;
+  int cols = 0;
+  int wordsPerRow = 0;
+  std::vector<uint64_t> bits;
+  std::string rule;
+
+  bool isAlive(int row, int col) const {
+    return (bits[size_t(row) * wordsPerRow + col / 64] >> (col % 64)) & 1;
+  }
+};
+
+/**
+ * Function: readPackedPattern
+ * ---------------------------
+ * Reads a board in the text layout used by the files in res/files: any
+ * number of lines starting with '#', then the height and width on lines of
+ * their own, then one line per row with 'X' for a live cell and '-' for an
+ * empty one. Lines after the last row are ignored. The file is mapped rather
+ * than read, and scanned many cells at a time straight into packed bits, so
+ * large files load at the speed of the disk. A file that cannot be read, a
+ * bad header, a row of the wrong length or a cell that is neither 'X' nor
+ * '-' is reported through error.
+ */
+PackedPattern readPackedPattern(const std::string &filename);
+
+/**
+ * Function: unpackPattern
+ * -----------------------
+ * Returns the pattern as a grid of ages, with live cells at age 1.
+ */
+Grid<int> unpackPattern(const PackedPattern &pattern);
+
+/**
+ * Function: readGridFromFile
+ * --------------------------
+ * Reads a pattern file, as readPackedPattern does, into a grid of ages with
+ * live cells at age 1.
+ */
+Grid<int> readGridFromFile(const std::string &filename);
+
+/**
+ * Function: generateRandomGrid
+ * ----------------------------
+ * Returns a board of the given size in which each cell is alive with the
+ * given probability, at a random age between 1 and kMaxAge. The same seed
+ * always produces the same board.
+ */
+Grid<int> generateRandomGrid(int rows, int cols, double density,
+                             uint64_t seed);
+
+/**
+ * Function: counterRandom
+ * -----------------------
+ * Returns the random word numbered counter of the stream the seed picks.
+ * The words are independent of one another and cost the same to compute
+ * in any order, so a stream can be split over threads however is handy.
+ */
+uint64_t counterRandom(uint64_t seed, uint64_t counter);
+
+/**
+ * Function: generateRandomPattern
+ * -------------------------------
+ * Returns a packed board of the given size in which each cell is alive with
+ * the given probability, rounded to a multiple of 2^-16. Words are filled
+ * straight from counterRandom, 64 cells per random word for every bit of
+ * the probability, and row blocks are spread over numThreads threads. The
+ * board depends only on the seed, never on the number of threads.
+ */
+PackedPattern generateRandomPattern(int rows, int cols, double density,
+                                    uint64_t seed, int numThreads = 1);
+
+/**
+ * Function: generateRandomWords
+ * -----------------------------
+ * Fills out with numWords words from word firstWord of each of numRows rows
+ * from row firstRow of the board generateRandomPattern returns for the same
+ * columns, density and seed, outStride words apart from one row to the
+ * next. Since every word comes from the counter, a part of a board too
+ * large for one machine can be generated without the rest.
+ */
+void generateRandomWords(int cols, double density, uint64_t seed,
+                         int firstRow, int numRows, int firstWord,
+                         int numWords, uint64_t *out, size_t outStride);
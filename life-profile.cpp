@@ -0,0 +1,148 @@
+/**
+ * File: life-profile.cpp
+ * ----------------------
+ * Implements the profiler. The current generation's times and counts are
+ * atomics, so the stepping threads, the simulation thread and the GUI
+ * thread can all add to them without a lock; the trace, which is only kept
+ * on request, is guarded by a mutex.
+ */
+
+#include <algorithm> // for copy
+#include <atomic>    // for atomic
+#include <fstream>   // for ofstream
+#include <iomanip>   // for setprecision
+#include <mutex>     // for mutex, lock_guard
+#include <vector>    // for vector
+using namespace std;
+
+#include "error.h" // for error
+
+#include "life-profile.h"
+
+static const char *const kPhaseNames[kNumPhases] = {
+    "step", "cycle detect", "publish", "draw", "print", "repaint"};
+static const char *const kCounterNames[kNumCounters] = {
+    "cells evaluated", "cells changed", "allocations", "bytes copied"};
+
+/**
+ * Type: TraceEvent
+ * ----------------
+ * A timed phase, or with a negative phase a generation's counters, in
+ * microseconds since the profiler started.
+ */
+struct TraceEvent {
+  int phase;
+  int thread;
+  double start;
+  double duration;
+  long long counts[kNumCounters];
+};
+
+static const chrono::steady_clock::time_point kEpoch =
+    chrono::steady_clock::now();
+static atomic<long long> phaseNanos[kNumPhases];
+static atomic<long long> counterValues[kNumCounters];
+static atomic<int> nextThreadId(0);
+static atomic<bool> tracing(false);
+static mutex traceLock; // guards totals and trace
+static GenerationStats totals;
+static vector<TraceEvent> trace;
+
+static double microsSinceEpoch(chrono::steady_clock::time_point time) {
+  return chrono::duration<double, micro>(time - kEpoch).count();
+}
+
+static int currentThreadId() {
+  thread_local int id = nextThreadId++;
+  return id;
+}
+
+const char *profilePhaseName(ProfilePhase phase) { return kPhaseNames[phase]; }
+
+const char *profileCounterName(ProfileCounter counter) {
+  return kCounterNames[counter];
+}
+
+void profileTime(ProfilePhase phase, chrono::steady_clock::time_point start) {
+  auto end = chrono::steady_clock::now();
+  phaseNanos[phase] += chrono::duration_cast<chrono::nanoseconds>(end - start)
+                           .count();
+  if (tracing) {
+    lock_guard<mutex> guard(traceLock);
+    if (trace.size() < size_t(kMaxTraceEvents))
+      trace.push_back({phase, currentThreadId(), microsSinceEpoch(start),
+                       microsSinceEpoch(end) - microsSinceEpoch(start), {}});
+  }
+}
+
+void profileCount(ProfileCounter counter, long long amount) {
+  counterValues[counter] += amount;
+}
+
+GenerationStats profileEndGeneration(long long generation) {
+  GenerationStats stats;
+  stats.generation = generation;
+  for (int phase = 0; phase < kNumPhases; ++phase) {
+    stats.seconds[phase] = phaseNanos[phase].exchange(0) * 1e-9;
+  }
+  for (int counter = 0; counter < kNumCounters; ++counter) {
+    stats.counts[counter] = counterValues[counter].exchange(0);
+  }
+
+  lock_guard<mutex> guard(traceLock);
+  totals.generation = generation;
+  for (int phase = 0; phase < kNumPhases; ++phase) {
+    totals.seconds[phase] += stats.seconds[phase];
+  }
+  for (int counter = 0; counter < kNumCounters; ++counter) {
+    totals.counts[counter] += stats.counts[counter];
+  }
+  if (tracing && trace.size() < size_t(kMaxTraceEvents)) {
+    TraceEvent event = {-1, currentThreadId(),
+                        microsSinceEpoch(chrono::steady_clock::now()), 0, {}};
+    copy(begin(stats.counts), end(stats.counts), begin(event.counts));
+    trace.push_back(event);
+  }
+  return stats;
+}
+
+GenerationStats profileTotals() {
+  lock_guard<mutex> guard(traceLock);
+  return totals;
+}
+
+void profileStartTrace() {
+  lock_guard<mutex> guard(traceLock);
+  trace.clear();
+  tracing = true;
+}
+
+void writeProfileTrace(const string &filename) {
+  ofstream out(filename);
+  if (!out)
+    error("Can not write file " + filename);
+  lock_guard<mutex> guard(traceLock);
+  out << fixed << setprecision(3);
+  out << "{\"traceEvents\":[\n";
+  for (size_t i = 0; i < trace.size(); ++i) {
+    const TraceEvent &event = trace[i];
+    out << (i == 0 ? "" : ",\n");
+    if (event.phase >= 0) {
+      out << "{\"name\":\"" << kPhaseNames[event.phase]
+          << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+          << ",\"ts\":" << event.start << ",\"dur\":" << event.duration
+          << "}";
+    } else {
+      out << "{\"name\":\"work\",\"ph\":\"C\",\"pid\":1,\"tid\":"
+          << event.thread << ",\"ts\":" << event.start << ",\"args\":{";
+      for (int counter = 0; counter < kNumCounters; ++counter) {
+        out << (counter == 0 ? "" : ",") << "\"" << kCounterNames[counter]
+            << "\":" << event.counts[counter];
+      }
+      out << "}}";
+    }
+  }
+  out << "\n]}\n";
+  if (!out)
+    error("Can not write file " + filename);
+}
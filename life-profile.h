@@ -0,0 +1,150 @@
+/**
+ * File: life-profile.h
+ * --------------------
+ * Defines the built-in profiler: scoped timers for the phases of a
+ * generation and counters for the work done in them, gathered per
+ * generation and optionally recorded as a trace that chrome://tracing or
+ * Perfetto can open.
+ *
+ * The hooks compile to nothing unless LIFE_PROFILING is defined (qmake
+ * CONFIG+=profiling), so the normal build pays nothing for them. With it
+ * defined, a timer or a count costs a clock read or an atomic add, and the
+ * hooks sit outside the per-cell loops.
+ */
+
+#pragma once
+#include <chrono> // for std::chrono::steady_clock
+#include <string> // for std::string
+
+/**
+ * Type: ProfilePhase
+ * ------------------
+ * The parts of a generation that are timed.
+ */
+enum ProfilePhase {
+  kPhaseStep,        // the engine computing the next generation
+  kPhaseCycleDetect, // the cycle detector hashing the change list
+  kPhasePublish,     // the simulation thread copying out a frame
+  kPhaseDraw,        // painting changed cells into the display's pixels
+  kPhasePrint,       // printing the board to the console
+  kPhaseRepaint,     // handing the pixels to the window
+  kNumPhases
+};
+
+/**
+ * Type: ProfileCounter
+ * --------------------
+ * The amounts of work that are counted.
+ */
+enum ProfileCounter {
+  kCellsEvaluated, // cells the engine applied the rule to
+  kCellsChanged,   // cells in the change lists the engine recorded
+  kAllocations,    // buffers allocated or grown
+  kBytesCopied,    // bytes copied between buffers
+  kNumCounters
+};
+
+/**
+ * Type: GenerationStats
+ * ---------------------
+ * The time spent in each phase and the counts, for one generation or in
+ * total. Phases run on other threads, such as drawing while the simulation
+ * thread steps, count towards whichever generation ends next.
+ */
+struct GenerationStats {
+  long long generation = 0;
+  double seconds[kNumPhases] = {};
+  long long counts[kNumCounters] = {};
+};
+
+/**
+ * Function: profilePhaseName, profileCounterName
+ * ----------------------------------------------
+ * Return the names the trace and the reports use.
+ */
+const char *profilePhaseName(ProfilePhase phase);
+const char *profileCounterName(ProfileCounter counter);
+
+/**
+ * Function: profileTime
+ * ---------------------
+ * Adds the time from start until now to the phase, and records it in the
+ * trace if one is being kept. ProfileScope calls this.
+ */
+void profileTime(ProfilePhase phase,
+                 std::chrono::steady_clock::time_point start);
+
+/**
+ * Function: profileCount
+ * ----------------------
+ * Adds amount to the counter for the current generation.
+ */
+void profileCount(ProfileCounter counter, long long amount);
+
+/**
+ * Function: profileEndGeneration
+ * ------------------------------
+ * Closes the current generation, which is numbered generation, and returns
+ * its stats. They are added to the totals and, if a trace is being kept,
+ * the counters are written to it.
+ */
+GenerationStats profileEndGeneration(long long generation);
+
+/**
+ * Function: profileTotals
+ * -----------------------
+ * Returns the stats summed over every generation closed so far.
+ */
+GenerationStats profileTotals();
+
+/**
+ * Function: profileStartTrace
+ * ---------------------------
+ * Starts recording every timed phase and every generation's counters, for
+ * writeProfileTrace. At most kMaxTraceEvents are kept.
+ */
+void profileStartTrace();
+
+/**
+ * Function: writeProfileTrace
+ * ---------------------------
+ * Writes the recorded trace to the named file in the Chrome trace event
+ * format. Problems are reported through error.
+ */
+void writeProfileTrace(const std::string &filename);
+
+const int kMaxTraceEvents = 1 << 20;
+
+/**
+ * Type: ProfileScope
+ * ------------------
+ * Times the rest of the enclosing scope as the given phase.
+ */
+class ProfileScope {
+public:
+  explicit ProfileScope(ProfilePhase phase)
+      : phase(phase), start(std::chrono::steady_clock::now()) {}
+  ~ProfileScope() { profileTime(phase, start); }
+
+private:
+  ProfilePhase phase;
+  std::chrono::steady_clock::time_point start;
+
+  ProfileScope(const ProfileScope &original);
+  void operator=(const ProfileScope &rhs) const;
+};
+
+#define LIFE_PROFILE_CONCAT2(a, b) a##b
+#define LIFE_PROFILE_CONCAT(a, b) LIFE_PROFILE_CONCAT2(a, b)
+
+#ifdef LIFE_PROFILING
+#define LIFE_PROFILE_SCOPE(phase)                                              \
+  ProfileScope LIFE_PROFILE_CONCAT(profileScope, __LINE__)(phase)
+#define LIFE_PROFILE_COUNT(counter, amount) profileCount(counter, amount)
+#define LIFE_PROFILE_END_GENERATION(generation) profileEndGeneration(generation)
+#else
+// the amount is named but never evaluated, so it counts as used
+#define LIFE_PROFILE_SCOPE(phase) ((void)0)
+#define LIFE_PROFILE_COUNT(counter, amount) ((void)sizeof(amount))
+#define LIFE_PROFILE_END_GENERATION(generation) ((void)0)
+#endif
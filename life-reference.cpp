@@ -0,0 +1,122 @@
+/**
+ * File: life-reference.cpp
+ * ------------------------
+ * Implements the reference rules exactly as life.cpp first did, and the
+ * engine around them.
+ */
+
+#include <algorithm> // for min
+using namespace std;
+
+#include "life-constants.h" // for kMaxAge
+#include "life-profile.h"   // for LIFE_PROFILE_SCOPE, LIFE_PROFILE_COUNT
+#include "life-reference.h"
+
+int countNeighborCell(const Grid<int> &grid, int row, int col) {
+  int count = 0;
+  for (int drow = -1; drow <= 1; ++drow) {
+    for (int dcol = -1; dcol <= 1; ++dcol) {
+      if (drow == 0 && dcol == 0)
+        continue;
+      int y = row + drow;
+      int x = col + dcol;
+      if (grid.inBounds(y, x) && grid[y][x] > 0)
+        count++;
+    }
+  }
+  return count;
+}
+
+static Grid<int> cloneGrid(const Grid<int> &grid) {
+  Grid<int> newGrid(grid.numRows(), grid.numCols());
+  for (int row = 0; row < grid.numRows(); ++row) {
+    for (int col = 0; col < grid.numCols(); ++col) {
+      newGrid[row][col] = grid[row][col];
+    }
+  }
+  return newGrid;
+}
+
+Grid<int> generateNextGenerationGrid(const Grid<int> &grid) {
+  auto newGrid = cloneGrid(grid);
+  for (int row = 0; row < grid.numRows(); ++row) {
+    for (int col = 0; col < grid.numCols(); ++col) {
+      int numNeighborCell = countNeighborCell(grid, row, col);
+      if (numNeighborCell <= 1 || numNeighborCell > 3) {
+        // kill a cell if it is lonely or overcrowded
+        newGrid[row][col] = 0;
+      } else if (numNeighborCell == 2) {
+        // the cell remains
+        if (grid[row][col] > 0 && grid[row][col] < kMaxAge) {
+          newGrid[row][col] += 1;
+        }
+      } else {
+        // bear a new cell
+        if (grid[row][col] < kMaxAge)
+          newGrid[row][col] += 1;
+      }
+    }
+  }
+  return newGrid;
+}
+
+Grid<int> generateNextGenerationGrid(const Grid<int> &grid,
+                                     const LifeRule &rule) {
+  auto newGrid = cloneGrid(grid);
+  for (int row = 0; row < grid.numRows(); ++row) {
+    for (int col = 0; col < grid.numCols(); ++col) {
+      int numNeighborCell = countNeighborCell(grid, row, col);
+      bool isAlive = grid[row][col] > 0;
+      uint16_t lives = isAlive ? rule.survival : rule.birth;
+      if (!((lives >> numNeighborCell) & 1)) {
+        newGrid[row][col] = 0;
+      } else if (grid[row][col] < kMaxAge) {
+        newGrid[row][col] += 1;
+      }
+    }
+  }
+  return newGrid;
+}
+
+bool isStableGrid(const Grid<int> &currGrid, const Grid<int> &newGrid) {
+  for (const auto &cell : newGrid) {
+    if (cell > 0 && cell < kMaxAge) {
+      return false;
+    }
+  }
+  return currGrid == newGrid;
+}
+
+void ReferenceLife::load(const Grid<int> &grid) {
+  board.resize(grid.numRows(), grid.numCols());
+  for (int row = 0; row < grid.numRows(); ++row) {
+    for (int col = 0; col < grid.numCols(); ++col) {
+      board[row][col] = min(grid[row][col], kMaxAge);
+    }
+  }
+  generationCount = 0;
+  changes.clear();
+}
+
+bool ReferenceLife::step() {
+  LIFE_PROFILE_SCOPE(kPhaseStep);
+  Grid<int> next = generateNextGenerationGrid(board, lifeRule);
+  if (recordChanges) {
+    changes.clear();
+    for (int row = 0; row < next.numRows(); ++row) {
+      for (int col = 0; col < next.numCols(); ++col) {
+        if (next[row][col] != board[row][col])
+          changes.push_back({row, col, next[row][col]});
+      }
+    }
+    LIFE_PROFILE_COUNT(kCellsChanged, (long long)changes.size());
+  }
+  bool changed = !(next == board);
+  board = next;
+  ++generationCount;
+  LIFE_PROFILE_COUNT(kCellsEvaluated,
+                     (long long)board.numRows() * board.numCols());
+  return changed;
+}
+
+void ReferenceLife::clear() { board.fill(0); }
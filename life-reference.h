@@ -0,0 +1,77 @@
+/**
+ * File: life-reference.h
+ * ----------------------
+ * Defines the original grid-at-a-time implementation of the rules, kept
+ * unchanged as the baseline the engines are measured and checked against,
+ * and an engine that steps with it, so the baseline can be run wherever
+ * the other engines can.
+ */
+
+#pragma once
+#include "grid.h"        // for Grid
+#include "life-engine.h" // for LifeEngine
+#include "life-rules.h"  // for LifeRule
+
+/**
+ * Function: countNeighborCell
+ * ---------------------------
+ * Returns the number of live cells among the eight neighbors of the given
+ * cell. Neighbors off the board count as dead.
+ */
+int countNeighborCell(const Grid<int> &grid, int row, int col);
+
+/**
+ * Function: generateNextGenerationGrid
+ * ------------------------------------
+ * Returns a new grid holding the generation after the given one.
+ */
+Grid<int> generateNextGenerationGrid(const Grid<int> &grid);
+
+/**
+ * Function: generateNextGenerationGrid
+ * ------------------------------------
+ * Returns a new grid holding the generation after the given one under the
+ * given rule, with the same aging as B3/S23: a cell that survives ages by
+ * one up to kMaxAge and a newborn cell has age 1.
+ */
+Grid<int> generateNextGenerationGrid(const Grid<int> &grid,
+                                     const LifeRule &rule);
+
+/**
+ * Function: isStableGrid
+ * ----------------------
+ * Returns true if newGrid, the generation after currGrid, will never change
+ * again.
+ */
+bool isStableGrid(const Grid<int> &currGrid, const Grid<int> &newGrid);
+
+class ReferenceLife : public LifeEngine {
+public:
+  /**
+   * Constructs an empty engine. Call load before stepping.
+   */
+  ReferenceLife() {}
+
+  /**
+   * Copies the grid in, with ages above kMaxAge stored as kMaxAge.
+   */
+  void load(const Grid<int> &grid) override;
+
+  /**
+   * Replaces the board with the generation generateNextGenerationGrid
+   * returns under the engine's rule, and compares the two grids whole to
+   * tell whether anything changed.
+   */
+  bool step() override;
+  void clear() override;
+
+  int numRows() const override { return board.numRows(); }
+  int numCols() const override { return board.numCols(); }
+  int ageAt(int row, int col) const override { return board[row][col]; }
+
+private:
+  Grid<int> board;
+
+  ReferenceLife(const ReferenceLife &original);
+  void operator=(const ReferenceLife &rhs) const;
+};
@@ -0,0 +1,87 @@
+/**
+ * File: life-rules.cpp
+ * --------------------
+ * Implements reading and writing rules in B/S notation.
+ */
+
+#include <cctype> // for isdigit
+using namespace std;
+
+#include "error.h"  // for error
+#include "strlib.h" // for toLowerCase, trim
+
+#include "life-rules.h"
+
+/**
+ * Function: parseCounts
+ * ---------------------
+ * Returns the mask of the neighbor counts listed in digits, which is one
+ * side of a rule.
+ */
+static uint16_t parseCounts(const string &digits, const string &text) {
+  uint16_t mask = 0;
+  for (char ch : digits) {
+    if (!isdigit((unsigned char)ch) || ch == '9')
+      error("bad rule \"" + text + "\", neighbor counts run from 0 to 8");
+    mask |= uint16_t(1 << (ch - '0'));
+  }
+  return mask;
+}
+
+LifeRule parseRule(const string &text) {
+  string rule = toLowerCase(trim(text));
+  if (rule == "life" || rule == "conway")
+    rule = "b3/s23";
+  else if (rule == "highlife")
+    rule = "b36/s23";
+  else if (rule == "seeds")
+    rule = "b2/s";
+  else if (rule == "daynight")
+    rule = "b3678/s34678";
+
+  size_t slash = rule.find('/');
+  if (slash == string::npos)
+    error("bad rule \"" + text + "\", expected B/S notation such as B3/S23");
+  string first = rule.substr(0, slash);
+  string second = rule.substr(slash + 1);
+  LifeRule parsed;
+  if (!first.empty() && first[0] == 's' && !second.empty() &&
+      second[0] == 'b') {
+    parsed.birth = parseCounts(second.substr(1), text);
+    parsed.survival = parseCounts(first.substr(1), text);
+  } else if (!first.empty() && first[0] == 'b' && !second.empty() &&
+             second[0] == 's') {
+    parsed.birth = parseCounts(first.substr(1), text);
+    parsed.survival = parseCounts(second.substr(1), text);
+  } else {
+    // the older notation lists survival first, without the letters
+    parsed.birth = parseCounts(second, text);
+    parsed.survival = parseCounts(first, text);
+  }
+  if (parsed.birth & 1)
+    error("the rule " + text + " has B0, which is not supported");
+  return parsed;
+}
+
+LifeRule parseFileRule(const string &text, const string &filename) {
+  try {
+    return parseRule(text);
+  } catch (const ErrorException &ex) {
+    error(filename + ": " + ex.getMessage());
+  }
+  return kConwayRule;
+}
+
+string ruleString(const LifeRule &rule) {
+  string text = "B";
+  for (int count = 0; count <= 8; ++count) {
+    if ((rule.birth >> count) & 1)
+      text += char('0' + count);
+  }
+  text += "/S";
+  for (int count = 0; count <= 8; ++count) {
+    if ((rule.survival >> count) & 1)
+      text += char('0' + count);
+  }
+  return text;
+}
@@ -0,0 +1,142 @@
+/**
+ * File: life-rules.h
+ * ------------------
+ * Defines the Life-like rules the engines can run, written in B/S notation:
+ * B3/S23 is Conway's Life, where a dead cell with 3 live neighbors is born
+ * and a live cell with 2 or 3 survives. A rule is a pair of bitmasks over
+ * the neighbor counts 0 to 8.
+ *
+ * The engines compile their kernels once per rule type. FixedRule carries
+ * its masks in the type, so the compiler folds every lookup into the kernel,
+ * and the common rules are instantiated that way; MaskRule reads the masks
+ * at run time and covers every other rule. dispatchRule picks between them.
+ */
+
+#pragma once
+#include <cstdint> // for uint16_t
+#include <string>  // for std::string
+
+/**
+ * Type: LifeRule
+ * --------------
+ * A rule as the user gives it. Bit n of birth is set if a dead cell with n
+ * live neighbors is born, bit n of survival if a live cell with n survives.
+ */
+struct LifeRule {
+  uint16_t birth;
+  uint16_t survival;
+
+  bool operator==(const LifeRule &other) const {
+    return birth == other.birth && survival == other.survival;
+  }
+  bool operator!=(const LifeRule &other) const { return !(*this == other); }
+};
+
+const LifeRule kConwayRule = {1 << 3, 1 << 2 | 1 << 3};
+
+/**
+ * Type: FixedRule
+ * ---------------
+ * A rule whose masks are compile-time constants. It can be built from any
+ * LifeRule so kernels can construct whichever rule type they were
+ * instantiated for; the argument is ignored.
+ */
+template <uint16_t Birth, uint16_t Survival> struct FixedRule {
+  static constexpr uint16_t birth = Birth;
+  static constexpr uint16_t survival = Survival;
+
+  constexpr FixedRule() {}
+  constexpr explicit FixedRule(const LifeRule &) {}
+};
+
+typedef FixedRule<1 << 3, 1 << 2 | 1 << 3> ConwayRule;            // B3/S23
+typedef FixedRule<1 << 3 | 1 << 6, 1 << 2 | 1 << 3> HighLifeRule; // B36/S23
+typedef FixedRule<1 << 2, 0> SeedsRule;                            // B2/S
+typedef FixedRule<1 << 3 | 1 << 6 | 1 << 7 | 1 << 8,
+                  1 << 3 | 1 << 4 | 1 << 6 | 1 << 7 | 1 << 8>
+    DayAndNightRule; // B3678/S34678
+
+/**
+ * Type: MaskRule
+ * --------------
+ * Any other rule, with its masks read at run time.
+ */
+struct MaskRule {
+  uint16_t birth;
+  uint16_t survival;
+
+  explicit MaskRule(const LifeRule &rule)
+      : birth(rule.birth), survival(rule.survival) {}
+};
+
+/**
+ * Function: isConway
+ * ------------------
+ * Returns true if the rule is B3/S23. For a FixedRule this is a constant,
+ * so kernels can keep a hand-tuned path for Conway's Life at no cost to
+ * the other rules.
+ */
+template <typename Rule> constexpr bool isConway(const Rule &rule) {
+  return rule.birth == kConwayRule.birth &&
+         rule.survival == kConwayRule.survival;
+}
+
+/**
+ * Function: nextAlive
+ * -------------------
+ * Returns 1 if a cell that is alive (1) or dead (0) with the given number
+ * of live neighbors is alive in the next generation, 0 otherwise.
+ */
+template <typename Rule>
+static inline int nextAlive(const Rule &rule, int alive, int numNeighborCell) {
+  int mask = (rule.birth & (alive - 1)) | (rule.survival & -alive);
+  return (mask >> numNeighborCell) & 1;
+}
+
+/**
+ * Function: dispatchRule
+ * ----------------------
+ * Calls visit with the precompiled FixedRule equal to the given rule, or
+ * with a MaskRule holding it if there is none, and returns what visit
+ * returns. visit is called with a different type either way, so it is
+ * usually a generic lambda that instantiates a kernel for the type.
+ */
+template <typename Visit>
+auto dispatchRule(const LifeRule &rule, Visit visit)
+    -> decltype(visit(MaskRule(rule))) {
+  if (rule == LifeRule{ConwayRule::birth, ConwayRule::survival})
+    return visit(ConwayRule());
+  if (rule == LifeRule{HighLifeRule::birth, HighLifeRule::survival})
+    return visit(HighLifeRule());
+  if (rule == LifeRule{SeedsRule::birth, SeedsRule::survival})
+    return visit(SeedsRule());
+  if (rule == LifeRule{DayAndNightRule::birth, DayAndNightRule::survival})
+    return visit(DayAndNightRule());
+  return visit(MaskRule(rule));
+}
+
+/**
+ * Function: parseRule
+ * -------------------
+ * Reads a rule in B/S notation such as "B36/S23", in either order and any
+ * case, or in the older S/B notation of bare digits such as "23/36", or by
+ * name: "life" (or "conway"), "highlife", "seeds" or "daynight". Rules with
+ * B0, where an empty board fills up in one generation, are not supported.
+ * Problems are reported through error.
+ */
+LifeRule parseRule(const std::string &text);
+
+/**
+ * Function: parseFileRule
+ * -----------------------
+ * Reads a rule given in the named pattern file, as parseRule does, with
+ * problems reported through error as problems with the file.
+ */
+LifeRule parseFileRule(const std::string &text, const std::string &filename);
+
+/**
+ * Function: ruleString
+ * --------------------
+ * Returns the rule in B/S notation, for example "B36/S23".
+ */
+std::string ruleString(const LifeRule &rule);
@@ -0,0 +1,137 @@
+/**
+ * File: life-simulation.cpp
+ * -------------------------
+ * Implements the simulation thread. Unless it runs a fixed number of
+ * generations a frame, the thread only blocks to keep its pace or to wait
+ * for the frame that ends the run to get through; every other frame simply
+ * replaces the one before if the GUI has not taken it.
+ */
+
+#include <chrono> // for steady_clock, milliseconds
+using namespace std;
+
+#include "life-gpu.h"     // for class GpuLife
+#include "life-profile.h" // for LIFE_PROFILE_SCOPE, LIFE_PROFILE_COUNT
+#include "life-simulation.h"
+
+bool followView(LifeEngine &engine, CycleDetector &cycles,
+                const BoardView &view) {
+#ifdef LIFE_HAVE_OPENCL
+  GpuLife *gpu = dynamic_cast<GpuLife *>(&engine);
+  if (gpu) {
+    bool wasWholeBoard = gpu->viewportCoversBoard();
+    gpu->setViewport(view.top, view.left, view.rows * view.blockSize,
+                     view.cols * view.blockSize);
+    if (gpu->viewportCoversBoard() && !wasWholeBoard)
+      cycles.reset(engine);
+    return gpu->viewportCoversBoard();
+  }
+#else
+  (void)engine;
+  (void)cycles;
+  (void)view;
+#endif
+  return true;
+}
+
+LifeSimulation::LifeSimulation(LifeEngine &engine, CycleDetector &cycles)
+    : engine(engine), cycles(cycles), stopping(false),
+      view{0, 0, 0, 0, 1} {}
+
+LifeSimulation::~LifeSimulation() { stop(); }
+
+void LifeSimulation::start(int msPerGeneration, int generationsPerFrame) {
+  stop();
+  frames.reset();
+  stopping = false;
+  worker = thread([this, msPerGeneration, generationsPerFrame] {
+    run(msPerGeneration, generationsPerFrame);
+  });
+}
+
+void LifeSimulation::stop() {
+  {
+    lock_guard<mutex> guard(lock);
+    stopping = true;
+  }
+  wake.notify_all();
+  if (worker.joinable())
+    worker.join();
+}
+
+void LifeSimulation::setView(const BoardView &view) {
+  lock_guard<mutex> guard(lock);
+  this->view = view;
+}
+
+const LifeFrame *LifeSimulation::latestFrame() { return frames.takeLatest(); }
+
+bool LifeSimulation::publish(bool finished, bool waitForDisplay) {
+  // waiting until the GUI has taken the last frame means this one does not
+  // replace it
+  while (waitForDisplay && frames.pending()) {
+    unique_lock<mutex> guard(lock);
+    if (wake.wait_for(guard, chrono::milliseconds(1),
+                      [this] { return bool(stopping); }))
+      return false;
+  }
+  LifeFrame *frame = frames.slotToFill();
+  LIFE_PROFILE_SCOPE(kPhasePublish);
+  frame->generation = engine.generation();
+  {
+    lock_guard<mutex> guard(lock);
+    frame->view = view;
+  }
+  const BoardView &shown = frame->view;
+  if (shown.blockSize > 1) {
+    size_t capacity = frame->counts.capacity();
+    engine.countBlocks(shown, frame->counts);
+    LIFE_PROFILE_COUNT(kAllocations, frame->counts.capacity() != capacity);
+    LIFE_PROFILE_COUNT(kBytesCopied,
+                       (long long)(frame->counts.size() * sizeof(int)));
+  } else {
+    size_t capacity = frame->ages.capacity();
+    engine.exportView(shown, frame->ages);
+    LIFE_PROFILE_COUNT(kAllocations, frame->ages.capacity() != capacity);
+    LIFE_PROFILE_COUNT(kBytesCopied, (long long)frame->ages.size());
+  }
+  frame->finished = finished;
+  frame->period = cycles.period();
+  frames.publish();
+  return true;
+}
+
+void LifeSimulation::run(int msPerGeneration, int generationsPerFrame) {
+  auto deadline = chrono::steady_clock::now();
+  int sinceFrame = 0;
+  while (!stopping) {
+    BoardView shown;
+    {
+      lock_guard<mutex> guard(lock);
+      shown = view;
+    }
+    bool wholeBoard = followView(engine, cycles, shown);
+    bool canAdvance = engine.step();
+    if (wholeBoard)
+      cycles.update(engine.changedCells());
+    LIFE_PROFILE_END_GENERATION(engine.generation());
+    // a period of 1 is left to the engine, which also waits for ages to
+    // settle
+    bool finished = !canAdvance || cycles.period() > 1;
+    if (finished) {
+      publish(true, true);
+      return;
+    }
+    if (generationsPerFrame <= 0) {
+      publish(false, false);
+    } else if (++sinceFrame == generationsPerFrame) {
+      publish(false, true);
+      sinceFrame = 0;
+    }
+    if (msPerGeneration > 0) {
+      deadline += chrono::milliseconds(msPerGeneration);
+      unique_lock<mutex> guard(lock);
+      wake.wait_until(guard, deadline, [this] { return bool(stopping); });
+    }
+  }
+}
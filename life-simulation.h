@@ -0,0 +1,112 @@
+/**
+ * File: life-simulation.h
+ * -----------------------
+ * Defines the animation's simulation thread. The thread steps the engine at
+ * the requested pace and publishes each generation it completes into a
+ * triple buffer, replacing the one before if the GUI has not taken it; the
+ * GUI thread takes the newest frame at its own display rate, so it always
+ * shows the latest generation completed and drops the ones it had no time
+ * to show. A slow repaint therefore never holds the simulation back.
+ * Alternatively the thread can publish every K-th generation and wait for
+ * each one to be taken, so the display advances exactly K generations a
+ * frame.
+ *
+ * While the thread runs it owns the engine and the cycle detector; the GUI
+ * reads only frames until stop returns. A frame holds only the part of the
+ * board in view, so publishing one costs no more than the window can show.
+ */
+
+#pragma once
+#include "life-cycle.h"        // for class CycleDetector
+#include "life-engine.h"       // for class LifeEngine
+#include "life-frame-buffer.h" // for class FrameBuffer
+#include <atomic>              // for std::atomic
+#include <condition_variable>  // for std::condition_variable
+#include <cstdint>             // for uint8_t
+#include <mutex>               // for std::mutex
+#include <thread>              // for std::thread
+#include <vector>              // for std::vector
+
+/**
+ * Type: LifeFrame
+ * ---------------
+ * The part of a generation in view, as the simulation thread saw it.
+ */
+struct LifeFrame {
+  long long generation;
+  BoardView view;
+  std::vector<uint8_t> ages; // the view's cells row by row, 0 for dead ones,
+                             // for a view of single cells
+  std::vector<int> counts;   // the live cells of each block otherwise
+  bool finished;             // the run stopped by itself after this frame
+  int period;                // the cycle detector's period at this frame
+};
+
+/**
+ * Function: followView
+ * --------------------
+ * Call before each step the display shows. A GPU engine then records and
+ * reads back only the changes in view; the cycle detector hashes the
+ * changes of the whole board, so while the view leaves part of the board
+ * out it must not be updated, and it is reset from the whole board here
+ * once the view takes all of it in again. Returns whether the next step's
+ * change list covers the whole board, which it always does on the other
+ * engines.
+ */
+bool followView(LifeEngine &engine, CycleDetector &cycles,
+                const BoardView &view);
+
+class LifeSimulation {
+public:
+  LifeSimulation(LifeEngine &engine, CycleDetector &cycles);
+
+  /**
+   * Stops the thread if it is still running.
+   */
+  ~LifeSimulation();
+
+  /**
+   * Starts stepping the engine on its own thread, one generation every
+   * msPerGeneration milliseconds, or as fast as it can if that is 0. If
+   * generationsPerFrame is positive, only every generationsPerFrame-th
+   * generation is published, and the thread waits for it to be taken
+   * before going on.
+   */
+  void start(int msPerGeneration, int generationsPerFrame = 0);
+
+  /**
+   * Asks the thread to stop and waits for it. The engine and the cycle
+   * detector are left at the last generation the thread completed, which
+   * may be later than the last frame shown.
+   */
+  void stop();
+
+  /**
+   * Returns the newest frame published since the last call, or nullptr if
+   * there is none. The frame stays valid until the next call that returns
+   * one. The frame that ends a run is never dropped.
+   */
+  const LifeFrame *latestFrame();
+
+  /**
+   * Sets the part of the board the frames hold, from the next frame on.
+   * Call it before start and whenever the display's view changes.
+   */
+  void setView(const BoardView &view);
+
+private:
+  LifeEngine &engine;
+  CycleDetector &cycles;
+  FrameBuffer<LifeFrame> frames;
+  std::thread worker;
+  std::mutex lock; // guards stopping for the waits below
+  std::condition_variable wake;
+  std::atomic<bool> stopping;
+  BoardView view; // guarded by lock
+
+  void run(int msPerGeneration, int generationsPerFrame);
+  bool publish(bool finished, bool waitForDisplay);
+
+  LifeSimulation(const LifeSimulation &original);
+  void operator=(const LifeSimulation &rhs) const;
+};
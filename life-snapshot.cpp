@@ -0,0 +1,142 @@
+/**
+ * File: life-snapshot.cpp
+ * -----------------------
+ * Implements saving and restoring snapshots.
+ */
+
+#include <cstring> // for memcmp, memcpy
+#include <fstream> // for ofstream
+#include <string>  // for string
+#include <vector>  // for vector
+using namespace std;
+
+#include "error.h" // for error
+
+#include "life-constants.h" // for kMaxAge
+#include "life-engine.h"    // for class LifeEngine
+#include "life-snapshot.h"
+
+static_assert(kMaxAge < (1 << kSnapshotAgePlanes),
+              "snapshot age planes must hold kMaxAge");
+static_assert(kMaxAge == 12, "SnapshotFile checks ages against 12");
+
+static const char kMagic[8] = {'L', 'I', 'F', 'E', 'S', 'N', 'A', 'P'};
+static const uint32_t kVersion = 1;
+static const uint32_t kByteOrder = 0x01020304; // reads back swapped on a
+                                               // machine of the other order
+
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  int64_t rows;
+  int64_t cols;
+  int64_t wordsPerRow;
+  int64_t generation;
+};
+static_assert(sizeof(SnapshotHeader) % sizeof(uint64_t) == 0,
+              "the words after the header must stay aligned");
+
+/**
+ * Function: pointPlanes
+ * ---------------------
+ * Points the planes at their sections of words, which follow one another:
+ * the liveness, then each age plane in turn.
+ */
+template <typename Word>
+static void pointPlanes(SnapshotPlanes<Word> &planes, Word *words) {
+  size_t planeWords = size_t(planes.rows) * planes.wordsPerRow;
+  planes.live = words;
+  for (int b = 0; b < kSnapshotAgePlanes; ++b) {
+    planes.ages[b] = words + (b + 1) * planeWords;
+  }
+}
+
+SnapshotFile::SnapshotFile(const string &filename) : file(filename) {
+  SnapshotHeader header;
+  if (file.size() < sizeof(header))
+    error(filename + ": not a snapshot, the file is too short");
+  memcpy(&header, file.data(), sizeof(header));
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+    error(filename + ": not a snapshot");
+  if (header.byteOrder != kByteOrder)
+    error(filename + ": the snapshot was saved on a machine of the other "
+                     "byte order");
+  if (header.version != kVersion)
+    error(filename + ": snapshot version " + to_string(header.version) +
+          " is not supported");
+  if (header.rows <= 0 || header.cols <= 0 || header.rows > (1 << 30) ||
+      header.cols > (1 << 30) || header.wordsPerRow != (header.cols + 63) / 64 ||
+      header.generation < 0)
+    error(filename + ": the snapshot header is damaged");
+  size_t planeWords = size_t(header.rows) * size_t(header.wordsPerRow);
+  if (file.size() !=
+      sizeof(header) + (1 + kSnapshotAgePlanes) * planeWords * sizeof(uint64_t))
+    error(filename + ": the snapshot is truncated");
+
+  planes.rows = int(header.rows);
+  planes.cols = int(header.cols);
+  planes.wordsPerRow = int(header.wordsPerRow);
+  planes.generation = header.generation;
+  pointPlanes(planes,
+              reinterpret_cast<const uint64_t *>(file.data() + sizeof(header)));
+
+  // live cells are exactly those with an age, ages stop at kMaxAge, and no
+  // bits are set past the last column
+  uint64_t lastWordMask = header.cols % 64 == 0
+                              ? ~uint64_t(0)
+                              : (uint64_t(1) << (header.cols % 64)) - 1;
+  for (size_t w = 0; w < planeWords; ++w) {
+    uint64_t anyAge = 0;
+    for (int b = 0; b < kSnapshotAgePlanes; ++b) {
+      anyAge |= planes.ages[b][w];
+    }
+    // kMaxAge is 12, binary 1100; 13 to 15 set bit 3, bit 2 and a low bit
+    uint64_t tooOld = planes.ages[3][w] & planes.ages[2][w] &
+                      (planes.ages[1][w] | planes.ages[0][w]);
+    bool lastWord = (w + 1) % header.wordsPerRow == 0;
+    if (anyAge != planes.live[w] || tooOld != 0 ||
+        (lastWord && (planes.live[w] & ~lastWordMask) != 0))
+      error(filename + ": the snapshot holds impossible ages");
+  }
+}
+
+string snapshotHeader(int rows, int cols, long long generation) {
+  SnapshotHeader header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.byteOrder = kByteOrder;
+  header.rows = rows;
+  header.cols = cols;
+  header.wordsPerRow = (header.cols + 63) / 64;
+  header.generation = generation;
+  return string(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+void saveSnapshot(const LifeEngine &engine, const string &filename) {
+  string header =
+      snapshotHeader(engine.numRows(), engine.numCols(), engine.generation());
+  SnapshotBuffer buffer;
+  buffer.rows = engine.numRows();
+  buffer.cols = engine.numCols();
+  buffer.wordsPerRow = (buffer.cols + 63) / 64;
+  buffer.generation = engine.generation();
+  size_t planeWords = size_t(buffer.rows) * size_t(buffer.wordsPerRow);
+  vector<uint64_t> words((1 + kSnapshotAgePlanes) * planeWords, 0);
+  pointPlanes(buffer, words.data());
+  engine.exportSnapshot(buffer);
+
+  ofstream out(filename, ios::binary);
+  if (!out)
+    error("Can not write file " + filename);
+  out.write(header.data(), streamsize(header.size()));
+  out.write(reinterpret_cast<const char *>(words.data()),
+            streamsize(words.size() * sizeof(uint64_t)));
+  if (!out)
+    error("Can not write file " + filename);
+}
+
+void restoreSnapshot(LifeEngine &engine, const string &filename) {
+  SnapshotFile file(filename);
+  engine.loadSnapshot(file.view());
+}
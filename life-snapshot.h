@@ -0,0 +1,101 @@
+/**
+ * File: life-snapshot.h
+ * ---------------------
+ * Defines the binary snapshot format, which saves a board mid-run, ages and
+ * generation count included, so a long run can be resumed where it left
+ * off. The file holds a fixed header, the liveness packed one bit per cell
+ * and the ages as kSnapshotAgePlanes bit planes, all in the packed engine's
+ * row layout, so restoring maps the file and hands the engine its words
+ * without parsing anything.
+ *
+ * Snapshots are written in the byte order of the machine that saves them
+ * and refused by machines of the other order.
+ */
+
+#pragma once
+#include "life-mapped-file.h" // for class MappedFile
+#include <cstdint>            // for uint64_t
+#include <string>             // for std::string
+
+class LifeEngine;
+
+const int kSnapshotAgePlanes = 4; // bits per age, enough for kMaxAge
+
+/**
+ * Type: SnapshotPlanes
+ * --------------------
+ * The board of a snapshot as pointers to its words: wordsPerRow words per
+ * row, with column c in bit c % 64 of word c / 64. Bit b of a cell's age
+ * is in ages[b]. Restoring reads a SnapshotView straight out of the mapped
+ * file, and saving has the engine fill a SnapshotBuffer.
+ */
+template <typename Word> struct SnapshotPlanes {
+  int rows;
+  int cols;
+  int wordsPerRow;
+  long long generation;
+  Word *live;
+  Word *ages[kSnapshotAgePlanes];
+
+  int ageAt(int row, int col) const {
+    size_t word = size_t(row) * wordsPerRow + col / 64;
+    int age = 0;
+    for (int b = 0; b < kSnapshotAgePlanes; ++b) {
+      age |= int((ages[b][word] >> (col % 64)) & 1) << b;
+    }
+    return age;
+  }
+};
+typedef SnapshotPlanes<const uint64_t> SnapshotView;
+typedef SnapshotPlanes<uint64_t> SnapshotBuffer;
+
+/**
+ * Class: SnapshotFile
+ * -------------------
+ * A snapshot file mapped for reading. The view points into the mapping, so
+ * it is only valid while the SnapshotFile is alive.
+ */
+class SnapshotFile {
+public:
+  /**
+   * Maps and checks the named snapshot, reporting a file that is not a
+   * snapshot, is truncated or holds impossible ages through error.
+   */
+  SnapshotFile(const std::string &filename);
+
+  const SnapshotView &view() const { return planes; }
+
+private:
+  MappedFile file;
+  SnapshotView planes;
+
+  SnapshotFile(const SnapshotFile &original);
+  void operator=(const SnapshotFile &rhs) const;
+};
+
+/**
+ * Function: saveSnapshot
+ * ----------------------
+ * Writes the engine's current generation, ages and generation count to the
+ * named file.
+ */
+void saveSnapshot(const LifeEngine &engine, const std::string &filename);
+
+/**
+ * Function: snapshotHeader
+ * ------------------------
+ * Returns the header a snapshot of a board of the given size, saved at the
+ * given generation, starts with. The liveness and then each age plane
+ * follow it, each rows * wordsPerRow words, so a board saved in parts, as
+ * the distributed engine of life-mpi.h saves it, can be written without
+ * saveSnapshot.
+ */
+std::string snapshotHeader(int rows, int cols, long long generation);
+
+/**
+ * Function: restoreSnapshot
+ * -------------------------
+ * Loads the named snapshot into the engine, ages and generation count
+ * included.
+ */
+void restoreSnapshot(LifeEngine &engine, const std::string &filename);
@@ -0,0 +1,439 @@
+/**
+ * File: life-sparse.cpp
+ * ---------------------
+ * Implements the sparse engine. Each chunk is stepped with the word kernel
+ * of life-kernel.h over a scratch copy of its rows, padded with the facing
+ * edges of its eight neighbors. Chunks are created when live cells reach
+ * their edge and handed back to the pool once they are empty and no
+ * neighbor's live cells touch them.
+ */
+
+#include <algorithm> // for copy, fill, max, min
+using namespace std;
+
+#include "life-constants.h" // for kMaxAge
+#include "life-kernel.h"    // for stepWords, countBits, countWordBlocks
+#include "life-profile.h"   // for LIFE_PROFILE_SCOPE, LIFE_PROFILE_COUNT
+#include "life-sparse.h"
+
+static_assert(SparseLife::kChunkSize == 64, "a chunk row must be one word");
+
+// the eight neighbors of a chunk; the opposite of direction d is 7 - d
+static const int kNeighborX[8] = {-1, 0, 1, -1, 1, -1, 0, 1};
+static const int kNeighborY[8] = {-1, -1, -1, 0, 0, 1, 1, 1};
+
+/**
+ * Function: liveEdges
+ * -------------------
+ * Returns the directions, one bit each, in which the given chunk rows have
+ * live cells on the edge, and so a neighbor that could see them.
+ */
+static uint8_t liveEdges(const uint64_t *live) {
+  const int last = SparseLife::kChunkSize - 1;
+  uint64_t any = 0;
+  for (int r = 0; r <= last; ++r) {
+    any |= live[r];
+  }
+  uint64_t top = live[0];
+  uint64_t bottom = live[last];
+  return uint8_t((top & 1) << 0 | uint64_t(top != 0) << 1 | (top >> 63) << 2 |
+                 (any & 1) << 3 | (any >> 63) << 4 | (bottom & 1) << 5 |
+                 uint64_t(bottom != 0) << 6 | (bottom >> 63) << 7);
+}
+
+static int floorDiv(long long value, int divisor) {
+  return int(value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor));
+}
+
+SparseLife::SparseLife()
+    : rows(0), cols(0), livePopulation(0),
+      stepChunkFor(&SparseLife::stepChunk<ConwayRule>) {}
+
+void SparseLife::setRule(const LifeRule &rule) {
+  LifeEngine::setRule(rule);
+  stepChunkFor = dispatchRule(rule, [](auto kind) -> ChunkStepper {
+    return &SparseLife::stepChunk<decltype(kind)>;
+  });
+  for (auto &entry : chunks) {
+    entry.second->dirty = true;
+  }
+}
+
+SparseLife::Chunk *SparseLife::findChunk(int cx, int cy) const {
+  auto found = chunks.find(keyOf(cx, cy));
+  return found == chunks.end() ? nullptr : found->second;
+}
+
+SparseLife::Chunk *SparseLife::addChunk(int cx, int cy) {
+  Chunk *&slot = chunks[keyOf(cx, cy)];
+  if (slot)
+    return slot;
+  if (freeChunks.empty()) {
+    pool.emplace_back();
+    slot = &pool.back();
+    LIFE_PROFILE_COUNT(kAllocations, 1);
+  } else {
+    slot = freeChunks.back();
+    freeChunks.pop_back();
+  }
+  Chunk &chunk = *slot;
+  chunk.cx = cx;
+  chunk.cy = cy;
+  fill(begin(chunk.live), end(chunk.live), 0);
+  for (auto &plane : chunk.ages) {
+    fill(begin(plane), end(plane), 0);
+  }
+  chunk.population = 0;
+  chunk.edges = 0;
+  chunk.dirty = true;
+  chunk.anyChange = false;
+  chunk.livenessChanged = false;
+  return slot;
+}
+
+void SparseLife::freeChunk(Chunk *chunk) {
+  chunks.erase(keyOf(chunk->cx, chunk->cy));
+  freeChunks.push_back(chunk);
+}
+
+void SparseLife::resetPlane(int numRows, int numCols) {
+  rows = numRows;
+  cols = numCols;
+  livePopulation = 0;
+  chunks.clear();
+  freeChunks.clear();
+  pool.clear();
+}
+
+void SparseLife::setWord(int row, int word, uint64_t live,
+                         const uint64_t *ages) {
+  if (live == 0)
+    return;
+  Chunk *chunk = addChunk(word, floorDiv(row, kChunkSize));
+  int r = row - chunk->cy * kChunkSize;
+  int delta = countBits(live) - countBits(chunk->live[r]);
+  chunk->population += delta;
+  livePopulation += delta;
+  chunk->live[r] = live;
+  for (int b = 0; b < 4; ++b) {
+    chunk->ages[b][r] = ages[b] & live;
+  }
+  chunk->edges = liveEdges(chunk->live);
+}
+
+void SparseLife::load(const Grid<int> &grid) {
+  resetPlane(grid.numRows(), grid.numCols());
+  generationCount = 0;
+  for (int row = 0; row < rows; ++row) {
+    for (int w = 0; w * 64 < cols; ++w) {
+      uint64_t live = 0;
+      uint64_t ages[4] = {0, 0, 0, 0};
+      for (int col = w * 64; col < min(cols, w * 64 + 64); ++col) {
+        int age = min(grid[row][col], kMaxAge);
+        if (age <= 0)
+          continue;
+        uint64_t bit = uint64_t(1) << (col % 64);
+        live |= bit;
+        for (int b = 0; b < 4; ++b) {
+          if ((age >> b) & 1)
+            ages[b] |= bit;
+        }
+      }
+      setWord(row, w, live, ages);
+    }
+  }
+}
+
+void SparseLife::loadPattern(const PackedPattern &pattern) {
+  resetPlane(pattern.rows, pattern.cols);
+  generationCount = 0;
+  for (int row = 0; row < rows; ++row) {
+    const uint64_t *words =
+        pattern.bits.data() + size_t(row) * pattern.wordsPerRow;
+    for (int w = 0; w < pattern.wordsPerRow; ++w) {
+      uint64_t ages[4] = {words[w], 0, 0, 0};
+      setWord(row, w, words[w], ages);
+    }
+  }
+}
+
+void SparseLife::loadSnapshot(const SnapshotView &snapshot) {
+  resetPlane(snapshot.rows, snapshot.cols);
+  for (int row = 0; row < rows; ++row) {
+    size_t rowStart = size_t(row) * snapshot.wordsPerRow;
+    for (int w = 0; w < snapshot.wordsPerRow; ++w) {
+      uint64_t ages[4];
+      for (int b = 0; b < 4; ++b) {
+        ages[b] = snapshot.ages[b][rowStart + w];
+      }
+      setWord(row, w, snapshot.live[rowStart + w], ages);
+    }
+  }
+  generationCount = snapshot.generation;
+}
+
+void SparseLife::exportPattern(PackedPattern &pattern) const {
+  pattern.rows = rows;
+  pattern.cols = cols;
+  pattern.wordsPerRow = (cols + 63) / 64;
+  pattern.bits.assign(size_t(rows) * pattern.wordsPerRow, 0);
+  uint64_t lastWordMask =
+      cols % 64 == 0 ? ~uint64_t(0) : (uint64_t(1) << (cols % 64)) - 1;
+  for (const auto &entry : chunks) {
+    const Chunk &chunk = *entry.second;
+    if (chunk.cx < 0 || chunk.cx >= pattern.wordsPerRow)
+      continue;
+    uint64_t mask = chunk.cx == pattern.wordsPerRow - 1 ? lastWordMask
+                                                        : ~uint64_t(0);
+    for (int r = 0; r < kChunkSize; ++r) {
+      long long row = (long long)chunk.cy * kChunkSize + r;
+      if (row >= 0 && row < rows)
+        pattern.bits[size_t(row) * pattern.wordsPerRow + chunk.cx] =
+            chunk.live[r] & mask;
+    }
+  }
+}
+
+void SparseLife::exportSnapshot(SnapshotBuffer &snapshot) const {
+  uint64_t lastWordMask =
+      cols % 64 == 0 ? ~uint64_t(0) : (uint64_t(1) << (cols % 64)) - 1;
+  for (const auto &entry : chunks) {
+    const Chunk &chunk = *entry.second;
+    if (chunk.cx < 0 || chunk.cx >= snapshot.wordsPerRow)
+      continue;
+    uint64_t mask = chunk.cx == snapshot.wordsPerRow - 1 ? lastWordMask
+                                                         : ~uint64_t(0);
+    for (int r = 0; r < kChunkSize; ++r) {
+      long long row = (long long)chunk.cy * kChunkSize + r;
+      if (row < 0 || row >= rows)
+        continue;
+      size_t index = size_t(row) * snapshot.wordsPerRow + chunk.cx;
+      snapshot.live[index] = chunk.live[r] & mask;
+      for (int b = 0; b < kSnapshotAgePlanes; ++b) {
+        snapshot.ages[b][index] = chunk.ages[b][r] & mask;
+      }
+    }
+  }
+}
+
+void SparseLife::clear() { resetPlane(rows, cols); }
+
+void SparseLife::countBlocks(const BoardView &view,
+                             vector<int> &counts) const {
+  counts.assign(size_t(view.rows) * view.cols, 0);
+  int top = max(view.top, 0);
+  int bottom = min(view.top + view.rows * view.blockSize, rows);
+  int left = max(view.left, 0);
+  int right = min(view.left + view.cols * view.blockSize, cols);
+  for (const auto &entry : chunks) {
+    const Chunk *chunk = entry.second;
+    int firstRow = chunk->cy * kChunkSize;
+    int firstCol = chunk->cx * kChunkSize;
+    if (chunk->population == 0 || firstRow >= bottom ||
+        firstRow + kChunkSize <= top || firstCol >= right ||
+        firstCol + kChunkSize <= left)
+      continue;
+    // only the columns on the board
+    uint64_t mask = ~uint64_t(0);
+    if (left > firstCol)
+      mask &= ~uint64_t(0) << (left - firstCol);
+    if (right < firstCol + kChunkSize)
+      mask &= (uint64_t(1) << (right - firstCol)) - 1;
+    for (int row = max(firstRow, top);
+         row < min(firstRow + kChunkSize, bottom); ++row) {
+      int *blockRow = counts.data() +
+                      size_t((row - view.top) / view.blockSize) * view.cols;
+      countWordBlocks(chunk->live[row - firstRow] & mask, firstCol, view,
+                      blockRow);
+    }
+  }
+}
+
+void SparseLife::exportView(const BoardView &view,
+                            vector<uint8_t> &ages) const {
+  ages.assign(size_t(view.rows) * view.cols, 0);
+  int top = max(view.top, 0);
+  int bottom = min(view.top + view.rows, rows);
+  int left = max(view.left, 0);
+  int right = min(view.left + view.cols, cols);
+  for (const auto &entry : chunks) {
+    const Chunk *chunk = entry.second;
+    int firstRow = chunk->cy * kChunkSize;
+    int firstCol = chunk->cx * kChunkSize;
+    if (chunk->population == 0 || firstRow >= bottom ||
+        firstRow + kChunkSize <= top || firstCol >= right ||
+        firstCol + kChunkSize <= left)
+      continue;
+    // only the columns in view and on the board
+    uint64_t mask = ~uint64_t(0);
+    if (left > firstCol)
+      mask &= ~uint64_t(0) << (left - firstCol);
+    if (right < firstCol + kChunkSize)
+      mask &= (uint64_t(1) << (right - firstCol)) - 1;
+    for (int row = max(firstRow, top);
+         row < min(firstRow + kChunkSize, bottom); ++row) {
+      int r = row - firstRow;
+      uint8_t *rowAges = ages.data() + size_t(row - view.top) * view.cols;
+      for (uint64_t bits = chunk->live[r] & mask; bits != 0;
+           bits &= bits - 1) {
+        int bit = countTrailingZeros(bits);
+        int age = 0;
+        for (int b = 0; b < 4; ++b) {
+          age |= int((chunk->ages[b][r] >> bit) & 1) << b;
+        }
+        rowAges[firstCol + bit - view.left] = uint8_t(age);
+      }
+    }
+  }
+}
+
+int SparseLife::ageAt(int row, int col) const {
+  const Chunk *chunk =
+      findChunk(floorDiv(col, kChunkSize), floorDiv(row, kChunkSize));
+  if (!chunk)
+    return 0;
+  int r = row - chunk->cy * kChunkSize;
+  int bit = col - chunk->cx * kChunkSize;
+  int age = 0;
+  for (int b = 0; b < 4; ++b) {
+    age |= int((chunk->ages[b][r] >> bit) & 1) << b;
+  }
+  return age;
+}
+
+template <typename Rule> void SparseLife::stepChunk(Chunk &chunk) {
+  const Rule rule(lifeRule);
+  const int last = kChunkSize - 1;
+  Chunk *neighbors[8];
+  for (int d = 0; d < 8; ++d) {
+    neighbors[d] = findChunk(chunk.cx + kNeighborX[d], chunk.cy + kNeighborY[d]);
+  }
+
+  // rows -1 to 64 of the chunk, each as its west, own and east word, so the
+  // kernel sees the neighbors' edges as it would the padding of PackedLife
+  uint64_t scratch[(kChunkSize + 2) * 3];
+  auto rowOf = [&](Chunk *from, int r) -> uint64_t {
+    return from ? from->live[r] : 0;
+  };
+  scratch[0] = rowOf(neighbors[0], last);
+  scratch[1] = rowOf(neighbors[1], last);
+  scratch[2] = rowOf(neighbors[2], last);
+  for (int r = 0; r < kChunkSize; ++r) {
+    scratch[(r + 1) * 3] = rowOf(neighbors[3], r);
+    scratch[(r + 1) * 3 + 1] = chunk.live[r];
+    scratch[(r + 1) * 3 + 2] = rowOf(neighbors[4], r);
+  }
+  scratch[(kChunkSize + 1) * 3] = rowOf(neighbors[5], 0);
+  scratch[(kChunkSize + 1) * 3 + 1] = rowOf(neighbors[6], 0);
+  scratch[(kChunkSize + 1) * 3 + 2] = rowOf(neighbors[7], 0);
+
+  uint64_t changed = 0;
+  uint64_t liveness = 0;
+  long long population = 0;
+  for (int r = 0; r < kChunkSize; ++r) {
+    uint64_t *ages[4];
+    for (int b = 0; b < 4; ++b) {
+      ages[b] = chunk.ages[b] + r;
+    }
+    stepWords(rule, scratch + r * 3 + 1, scratch + (r + 1) * 3 + 1,
+              scratch + (r + 2) * 3 + 1, chunk.next + r, ages,
+              chunk.changed + r, ~uint64_t(0), true, changed, population);
+    liveness |= chunk.next[r] ^ chunk.live[r];
+  }
+  chunk.anyChange = changed != 0;
+  chunk.livenessChanged = liveness != 0;
+  livePopulation += population - chunk.population;
+  chunk.population = int(population);
+}
+
+void SparseLife::recordChunkChanges(const Chunk &chunk) {
+  long long firstCol = (long long)chunk.cx * kChunkSize;
+  if (firstCol < 0 || firstCol >= cols)
+    return;
+  for (int r = 0; r < kChunkSize; ++r) {
+    long long row = (long long)chunk.cy * kChunkSize + r;
+    if (row < 0 || row >= rows)
+      continue;
+    for (uint64_t bits = chunk.changed[r]; bits != 0; bits &= bits - 1) {
+      long long col = firstCol + countTrailingZeros(bits);
+      if (col < cols)
+        changes.push_back({int(row), int(col), ageAt(int(row), int(col))});
+    }
+  }
+}
+
+bool SparseLife::step() {
+  LIFE_PROFILE_SCOPE(kPhaseStep);
+  // grow the plane into every chunk that live cells touch
+  visit.clear();
+  for (const auto &entry : chunks) {
+    visit.push_back(entry.second);
+  }
+  for (Chunk *chunk : visit) {
+    for (int d = 0; d < 8; ++d) {
+      if ((chunk->edges >> d) & 1)
+        addChunk(chunk->cx + kNeighborX[d], chunk->cy + kNeighborY[d]);
+    }
+  }
+
+  // a chunk can only change if it did last time or a neighbor's liveness
+  // did; every other chunk is left as it is
+  visit.clear();
+  for (const auto &entry : chunks) {
+    Chunk *chunk = entry.second;
+    if (chunk->dirty) {
+      (this->*stepChunkFor)(*chunk);
+      visit.push_back(chunk);
+    } else {
+      chunk->anyChange = false;
+      chunk->livenessChanged = false;
+    }
+  }
+
+  bool changed = false;
+  if (recordChanges)
+    changes.clear();
+  for (Chunk *chunk : visit) {
+    copy(begin(chunk->next), end(chunk->next), begin(chunk->live));
+    chunk->edges = liveEdges(chunk->live);
+    changed |= chunk->anyChange;
+    if (recordChanges && chunk->anyChange)
+      recordChunkChanges(*chunk);
+  }
+  LIFE_PROFILE_COUNT(kCellsEvaluated,
+                     (long long)visit.size() * kChunkSize * kChunkSize);
+  LIFE_PROFILE_COUNT(kBytesCopied,
+                     (long long)visit.size() * sizeof(Chunk::next));
+  if (recordChanges)
+    LIFE_PROFILE_COUNT(kCellsChanged, (long long)changes.size());
+  for (const auto &entry : chunks) {
+    entry.second->dirty = entry.second->anyChange;
+  }
+  for (Chunk *chunk : visit) {
+    if (!chunk->livenessChanged)
+      continue;
+    for (int d = 0; d < 8; ++d) {
+      Chunk *neighbor =
+          findChunk(chunk->cx + kNeighborX[d], chunk->cy + kNeighborY[d]);
+      if (neighbor)
+        neighbor->dirty = true;
+    }
+  }
+
+  // hand back the empty chunks no neighbor would recreate
+  for (Chunk *chunk : visit) {
+    if (chunk->edges != 0 || chunk->anyChange)
+      continue;
+    bool empty = chunk->population == 0;
+    bool needed = false;
+    for (int d = 0; d < 8 && empty && !needed; ++d) {
+      Chunk *neighbor =
+          findChunk(chunk->cx + kNeighborX[d], chunk->cy + kNeighborY[d]);
+      needed = neighbor && ((neighbor->edges >> (7 - d)) & 1);
+    }
+    if (empty && !needed)
+      freeChunk(chunk);
+  }
+  ++generationCount;
+  return changed;
+}
@@ -0,0 +1,128 @@
+/**
+ * File: life-sparse.h
+ * -------------------
+ * Defines a sparse engine for the unbounded plane. The plane is cut into
+ * chunks of 64 x 64 cells, stored packed like the rows of PackedLife, and
+ * only chunks that hold live cells or border them exist at all: they live in
+ * a hash map keyed by chunk coordinate and are allocated from a pool as the
+ * pattern grows into them. Memory use therefore follows the live population
+ * rather than the pattern's bounding box.
+ *
+ * As with HashLife, the board loaded into the engine is a window onto the
+ * plane for import, export and display; cells that leave it keep evolving.
+ */
+
+#pragma once
+#include "grid.h"        // for Grid
+#include "life-engine.h" // for LifeEngine
+#include <cstdint>       // for uint64_t, uint8_t
+#include <deque>         // for std::deque
+#include <unordered_map> // for std::unordered_map
+#include <vector>        // for std::vector
+
+class SparseLife : public LifeEngine {
+public:
+  SparseLife();
+
+  /**
+   * Places the given grid of ages on the plane, with board cell (0, 0) at
+   * the plane's origin. Ages above kMaxAge are stored as kMaxAge.
+   */
+  void load(const Grid<int> &grid) override;
+
+  /**
+   * Pattern and snapshot words line up with chunk rows, so these copy
+   * whole words.
+   */
+  void loadPattern(const PackedPattern &pattern) override;
+  void exportPattern(PackedPattern &pattern) const override;
+  void loadSnapshot(const SnapshotView &snapshot) override;
+  void exportSnapshot(SnapshotBuffer &snapshot) const override;
+
+  /**
+   * Advances the plane by one generation, stepping only the chunks that
+   * changed in the last generation or border one whose liveness did.
+   * Returns false if no cell anywhere on the plane changed, age included.
+   */
+  bool step() override;
+
+  /**
+   * Kills every cell on the plane, keeping the board's dimensions.
+   */
+  void clear() override;
+  void setRule(const LifeRule &rule) override;
+
+  int numRows() const override { return rows; }
+  int numCols() const override { return cols; }
+  int ageAt(int row, int col) const override;
+
+  /**
+   * Returns the number of live cells on the whole plane, including those
+   * that have left the board. Each chunk's count is kept up by its step, so
+   * this is free.
+   */
+  long long population() const override { return livePopulation; }
+
+  /**
+   * These work a word at a time, walking only the chunks that exist, and
+   * only the cells on the board.
+   */
+  void countBlocks(const BoardView &view,
+                   std::vector<int> &counts) const override;
+  void exportView(const BoardView &view,
+                  std::vector<uint8_t> &ages) const override;
+
+  /**
+   * Returns the number of chunks currently allocated.
+   */
+  int chunkCount() const { return int(chunks.size()); }
+
+  static const int kChunkSize = 64; // cells a side, one word per row
+
+private:
+  struct Chunk {
+    int cx, cy; // chunk coordinates; the chunk covers plane cells
+                // x in [64cx, 64cx + 64) and y in [64cy, 64cy + 64)
+    uint64_t live[kChunkSize];
+    uint64_t next[kChunkSize];
+    uint64_t ages[4][kChunkSize];
+    uint64_t changed[kChunkSize];
+    int population;       // live cells in the chunk
+    uint8_t edges;        // the directions in which live cells touch the edge
+    bool dirty;           // may change in the next step
+    bool anyChange;       // some cell changed in the last step
+    bool livenessChanged; // some cell was born or died in the last step
+  };
+
+  struct ChunkKeyHash {
+    size_t operator()(uint64_t key) const {
+      return size_t((key * 0x9e3779b97f4a7c15ULL) >> 16);
+    }
+  };
+
+  int rows;
+  int cols;
+  std::deque<Chunk> pool;
+  std::vector<Chunk *> freeChunks;
+  std::unordered_map<uint64_t, Chunk *, ChunkKeyHash> chunks;
+  std::vector<Chunk *> visit; // scratch list of chunks for step
+  long long livePopulation;   // the sum of the chunks' populations
+
+  // the kernel stepping one chunk, instantiated for the current rule
+  typedef void (SparseLife::*ChunkStepper)(Chunk &chunk);
+  ChunkStepper stepChunkFor;
+
+  static uint64_t keyOf(int cx, int cy) {
+    return uint64_t(uint32_t(cx)) << 32 | uint32_t(cy);
+  }
+  Chunk *findChunk(int cx, int cy) const;
+  Chunk *addChunk(int cx, int cy);
+  void freeChunk(Chunk *chunk);
+  void resetPlane(int numRows, int numCols);
+  void setWord(int row, int word, uint64_t live, const uint64_t *ages);
+  template <typename Rule> void stepChunk(Chunk &chunk);
+  void recordChunkChanges(const Chunk &chunk);
+
+  SparseLife(const SparseLife &original);
+  void operator=(const SparseLife &rhs) const;
+};
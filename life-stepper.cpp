@@ -0,0 +1,443 @@
+/**
+ * File: life-stepper.cpp
+ * ----------------------
+ * Implements the double-buffered stepping engine. The stepper owns two
+ * buffers of the same size and ping-pongs between them: each generation is
+ * written into the back buffer from the front one and the two are then
+ * swapped, so stepping never allocates once the board has been loaded.
+ *
+ * The board is divided into square tiles, and each buffer stores the tiles
+ * one after the other, each as a block of rows with a ring of halo cells
+ * around it. Before a tile is stepped its halo is filled from the facing
+ * edges of its neighbors, so every cell is stepped by the same loop without
+ * a bounds check, and the three rows it reads are a few hundred bytes apart
+ * however wide the board is. With a dead border the halo facing the edge of
+ * the board stays empty; on a torus it is filled from the opposite edge, so
+ * wrapping costs nothing in the loop itself.
+ *
+ * Only tiles that changed in the last generation, or that border one that
+ * did, can change in the next, so every other tile is skipped. A skipped
+ * tile is still correct in the back buffer, because it held the same cells
+ * one generation earlier.
+ *
+ * Each row of the next generation depends only on three rows of the current
+ * one, so the board can also be cut into bands of tile rows that are stepped
+ * in parallel on a persistent thread pool.
+ */
+
+#include <algorithm> // for copy, fill, max
+#include <chrono>    // for steady_clock
+#include <utility>   // for swap
+using namespace std;
+
+#include "life-constants.h"   // for kMaxAge
+#include "life-profile.h"     // for LIFE_PROFILE_SCOPE, LIFE_PROFILE_COUNT
+#include "life-stepper.h"
+#include "life-thread-pool.h" // for class LifeThreadPool
+
+LifeStepper::LifeStepper()
+    : rows(0), cols(0), tileRows(0), tileCols(0), torus(false),
+      numThreads(1), bandTimes(1), bandChanges(1), bandGrowth(1),
+      livePopulation(0) {
+  selectKernels();
+}
+
+void LifeStepper::selectKernels() {
+  dispatchRule(lifeRule, [this](auto kind) {
+    stepTileFor[0] = &LifeStepper::stepTile<decltype(kind), false>;
+    stepTileFor[1] = &LifeStepper::stepTile<decltype(kind), true>;
+  });
+}
+
+LifeStepper::~LifeStepper() {}
+
+void LifeStepper::setThreadCount(int numThreads) {
+  this->numThreads = max(numThreads, 1);
+  pool.reset(this->numThreads > 1 ? new LifeThreadPool(this->numThreads)
+                                  : nullptr);
+  bandTimes.assign(this->numThreads, 0);
+  bandChanges.resize(this->numThreads);
+  bandGrowth.assign(this->numThreads, 0);
+  columnSums.assign(this->numThreads * kTileStride, 0);
+}
+
+void LifeStepper::setRule(const LifeRule &rule) {
+  LifeEngine::setRule(rule);
+  selectKernels();
+  fill(activeTiles.begin(), activeTiles.end(), 1);
+}
+
+bool LifeStepper::setTorus(bool torus) {
+  if (this->torus && !torus)
+    clearHalo();
+  this->torus = torus;
+  // the neighbors of the edge tiles changed, so every tile is stepped again
+  fill(activeTiles.begin(), activeTiles.end(), 1);
+  return true;
+}
+
+void LifeStepper::resize(int numRows, int numCols) {
+  rows = numRows;
+  cols = numCols;
+  generationCount = 0;
+  livePopulation = 0;
+  tileRows = (rows + kTileSize - 1) / kTileSize;
+  tileCols = (cols + kTileSize - 1) / kTileSize;
+  current.assign(size_t(tileRows) * tileCols * kTileCells, 0);
+  next.assign(size_t(tileRows) * tileCols * kTileCells, 0);
+  columnSums.assign(numThreads * kTileStride, 0);
+  activeTiles.assign(tileRows * tileCols, 1);
+  changedTiles.assign(tileRows * tileCols, 0);
+  tilePopulation.assign(tileRows * tileCols, 0);
+  LIFE_PROFILE_COUNT(kAllocations, 4);
+}
+
+void LifeStepper::load(const Grid<int> &grid) {
+  resize(grid.numRows(), grid.numCols());
+  for (int row = 0; row < rows; ++row) {
+    for (int col = 0; col < cols; ++col) {
+      current[cellIndex(row, col)] = grid[row][col];
+      livePopulation += grid[row][col] > 0;
+    }
+  }
+  countTilePopulations();
+}
+
+void LifeStepper::loadPattern(const PackedPattern &pattern) {
+  resize(pattern.rows, pattern.cols);
+  for (int row = 0; row < rows; ++row) {
+    for (int col = 0; col < cols; ++col) {
+      current[cellIndex(row, col)] = pattern.isAlive(row, col);
+      livePopulation += pattern.isAlive(row, col);
+    }
+  }
+  countTilePopulations();
+}
+
+void LifeStepper::loadSnapshot(const SnapshotView &snapshot) {
+  resize(snapshot.rows, snapshot.cols);
+  for (int row = 0; row < rows; ++row) {
+    for (int col = 0; col < cols; ++col) {
+      current[cellIndex(row, col)] = snapshot.ageAt(row, col);
+      livePopulation += snapshot.ageAt(row, col) > 0;
+    }
+  }
+  countTilePopulations();
+  generationCount = snapshot.generation;
+}
+
+void LifeStepper::clear() {
+  fill(current.begin(), current.end(), 0);
+  livePopulation = 0;
+  fill(tilePopulation.begin(), tilePopulation.end(), 0);
+  fill(activeTiles.begin(), activeTiles.end(), 1);
+}
+
+/**
+ * Function: countTilePopulations
+ * ------------------------------
+ * Counts the live cells of every tile of a board just loaded; step keeps
+ * the counts up to date from then on.
+ */
+void LifeStepper::countTilePopulations() {
+  for (int tileRow = 0; tileRow < tileRows; ++tileRow) {
+    for (int tileCol = 0; tileCol < tileCols; ++tileCol) {
+      const int *tile = &current[tileIndex(tileRow, tileCol)];
+      int count = 0;
+      for (int row = 1; row <= tileHeight(tileRow); ++row) {
+        for (int col = 1; col <= tileWidth(tileCol); ++col) {
+          count += tile[row * kTileStride + col] > 0;
+        }
+      }
+      tilePopulation[tileRow * tileCols + tileCol] = count;
+    }
+  }
+}
+
+int LifeStepper::activeTileCount() const {
+  int count = 0;
+  for (uint8_t active : activeTiles) {
+    count += active;
+  }
+  return count;
+}
+
+void LifeStepper::countBlocks(const BoardView &view,
+                              vector<int> &counts) const {
+  counts.assign(size_t(view.rows) * view.cols, 0);
+  int top = max(view.top, 0);
+  int left = max(view.left, 0);
+  int bottom = min(view.top + view.rows * view.blockSize, rows);
+  int right = min(view.left + view.cols * view.blockSize, cols);
+  if (bottom <= top || right <= left)
+    return;
+  for (int tileRow = top / kTileSize; tileRow <= (bottom - 1) / kTileSize;
+       ++tileRow) {
+    int firstRow = tileRow * kTileSize;
+    int rowBegin = max(top, firstRow);
+    int rowEnd = min(bottom, firstRow + tileHeight(tileRow));
+    for (int tileCol = left / kTileSize; tileCol <= (right - 1) / kTileSize;
+         ++tileCol) {
+      int population = tilePopulation[tileRow * tileCols + tileCol];
+      if (population == 0)
+        continue;
+      int firstCol = tileCol * kTileSize;
+      int colBegin = max(left, firstCol);
+      int colEnd = min(right, firstCol + tileWidth(tileCol));
+      int blockRow = (rowBegin - view.top) / view.blockSize;
+      int blockCol = (colBegin - view.left) / view.blockSize;
+      // a tile wholly in view and inside one block needs no visit
+      if (rowBegin == firstRow && rowEnd == firstRow + tileHeight(tileRow) &&
+          colBegin == firstCol && colEnd == firstCol + tileWidth(tileCol) &&
+          blockRow == (rowEnd - 1 - view.top) / view.blockSize &&
+          blockCol == (colEnd - 1 - view.left) / view.blockSize) {
+        counts[size_t(blockRow) * view.cols + blockCol] += population;
+        continue;
+      }
+      const int *tile = &current[tileIndex(tileRow, tileCol)];
+      for (int row = rowBegin; row < rowEnd; ++row) {
+        const int *cells = tile + (row - firstRow + 1) * kTileStride + 1 -
+                           firstCol;
+        int *blocks = counts.data() +
+                      size_t((row - view.top) / view.blockSize) * view.cols;
+        // each run of the row's cells that falls in one block is summed in
+        // a loop of its own
+        for (int col = colBegin; col < colEnd;) {
+          int block = (col - view.left) / view.blockSize;
+          int end = min(colEnd, view.left + (block + 1) * view.blockSize);
+          int count = 0;
+          for (; col < end; ++col) {
+            count += cells[col] > 0;
+          }
+          blocks[block] += count;
+        }
+      }
+    }
+  }
+}
+
+void LifeStepper::exportGrid(Grid<int> &grid) const {
+  grid.resize(rows, cols);
+  for (int row = 0; row < rows; ++row) {
+    for (int col = 0; col < cols; ++col) {
+      grid[row][col] = current[cellIndex(row, col)];
+    }
+  }
+}
+
+void LifeStepper::fillTileHalo(int tileRow, int tileCol) {
+  int height = tileHeight(tileRow);
+  int width = tileWidth(tileCol);
+  // the tile in each direction, or -1 past a dead border
+  auto neighbor = [&](int dy, int dx) {
+    int y = tileRow + dy;
+    int x = tileCol + dx;
+    if (torus) {
+      y = (y + tileRows) % tileRows;
+      x = (x + tileCols) % tileCols;
+    } else if (y < 0 || y >= tileRows || x < 0 || x >= tileCols) {
+      return -1;
+    }
+    return y * tileCols + x;
+  };
+  // the halo of a tile at the bottom or right edge of the board sits just
+  // past its last row or column, which may be inside its block
+  int *tile = &current[tileIndex(tileRow, tileCol)];
+  auto at = [](int *block, int row, int col) -> int & {
+    return block[row * kTileStride + col];
+  };
+  auto from = [&](int index, int row, int col) {
+    return index < 0 ? 0
+                     : current[size_t(index) * kTileCells + row * kTileStride +
+                               col];
+  };
+  int north = neighbor(-1, 0);
+  int south = neighbor(1, 0);
+  int northRow = north < 0 ? 0 : tileHeight(north / tileCols);
+  for (int col = 1; col <= width; ++col) {
+    at(tile, 0, col) = from(north, northRow, col);
+    at(tile, height + 1, col) = from(south, 1, col);
+  }
+  int west = neighbor(0, -1);
+  int east = neighbor(0, 1);
+  int westCol = west < 0 ? 0 : tileWidth(west % tileCols);
+  for (int row = 1; row <= height; ++row) {
+    at(tile, row, 0) = from(west, row, westCol);
+    at(tile, row, width + 1) = from(east, row, 1);
+  }
+  int northWest = neighbor(-1, -1);
+  int northEast = neighbor(-1, 1);
+  int southWest = neighbor(1, -1);
+  int southEast = neighbor(1, 1);
+  at(tile, 0, 0) = from(northWest, northRow, westCol);
+  at(tile, 0, width + 1) = from(northEast, northRow, 1);
+  at(tile, height + 1, 0) = from(southWest, 1, westCol);
+  at(tile, height + 1, width + 1) = from(southEast, 1, 1);
+}
+
+void LifeStepper::clearHalo() {
+  for (vector<int> *cells : {&current, &next}) {
+    for (int tileRow = 0; tileRow < tileRows; ++tileRow) {
+      for (int tileCol = 0; tileCol < tileCols; ++tileCol) {
+        int *tile = cells->data() + tileIndex(tileRow, tileCol);
+        int height = tileHeight(tileRow);
+        int width = tileWidth(tileCol);
+        for (int row = 0; row < kTileStride; ++row) {
+          bool inside = row >= 1 && row <= height;
+          for (int col = 0; col < kTileStride; ++col) {
+            if (!inside || col < 1 || col > width)
+              tile[row * kTileStride + col] = 0;
+          }
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Function: nextAge
+ * -----------------
+ * Applies the rule to a single cell without branching: a living cell that
+ * survives ages by one until it reaches kMaxAge, and a newborn cell goes
+ * from 0 to 1.
+ */
+template <typename Rule>
+static inline int nextAge(const Rule &rule, int cell, int numNeighborCell) {
+  int survives = nextAlive(rule, cell > 0, numNeighborCell);
+  return (cell + (cell < kMaxAge)) * survives;
+}
+
+template <typename Rule, bool Record>
+int LifeStepper::stepRow(const Rule &rule, const int *mid, int *out,
+                         int width, int row, int firstCol, int *sums,
+                         int band) {
+  // mid is the row's west halo cell, so its cells are mid[1] to mid[width]
+  const int *up = mid - kTileStride;
+  const int *down = mid + kTileStride;
+
+  // every column sum is shared by the three cells whose windows overlap it
+  for (int col = 0; col <= width + 1; ++col) {
+    sums[col] = (up[col] > 0) + (mid[col] > 0) + (down[col] > 0);
+  }
+  // the change flag, the population and the change list are all gathered
+  // in the same loop; changed cells are appended without a branch by always
+  // writing the next slot and only moving past it if the cell changed
+  int diff = 0;
+  int growth = 0;
+  CellUpdate rowChanges[kTileSize];
+  int numChanged = 0;
+  for (int col = 1; col <= width; ++col) {
+    int cell = mid[col];
+    int numNeighborCell =
+        sums[col - 1] + sums[col] + sums[col + 1] - (cell > 0);
+    int age = nextAge(rule, cell, numNeighborCell);
+    out[col] = age;
+    diff |= age ^ cell;
+    growth += (age > 0) - (cell > 0);
+    if (Record) {
+      rowChanges[numChanged] = {row, firstCol + col - 1, age};
+      numChanged += age != cell;
+    }
+  }
+  bandGrowth[band] += growth;
+  if (Record)
+    bandChanges[band].insert(bandChanges[band].end(), rowChanges,
+                             rowChanges + numChanged);
+  return diff;
+}
+
+template <typename Rule, bool Record>
+int LifeStepper::stepTile(int tileRow, int tileCol, int *sums, int band) {
+  const Rule rule(lifeRule);
+  fillTileHalo(tileRow, tileCol);
+  int height = tileHeight(tileRow);
+  int width = tileWidth(tileCol);
+  const int *from = &current[tileIndex(tileRow, tileCol)];
+  int *to = &next[tileIndex(tileRow, tileCol)];
+
+  int diff = 0;
+  for (int row = 1; row <= height; ++row) {
+    diff |= stepRow<Rule, Record>(rule, from + row * kTileStride,
+                                  to + row * kTileStride, width,
+                                  tileRow * kTileSize + row - 1,
+                                  tileCol * kTileSize, sums, band);
+  }
+  return diff;
+}
+
+void LifeStepper::stepBand(int band) {
+  auto start = chrono::steady_clock::now();
+  int firstTileRow = int((long long)tileRows * band / numThreads);
+  int lastTileRow = int((long long)tileRows * (band + 1) / numThreads);
+  int *sums = &columnSums[band * kTileStride];
+  bandChanges[band].clear();
+  bandGrowth[band] = 0;
+  TileStepper stepTile = stepTileFor[recordChanges];
+  long long evaluated = 0;
+  for (int tileRow = firstTileRow; tileRow < lastTileRow; ++tileRow) {
+    for (int tileCol = 0; tileCol < tileCols; ++tileCol) {
+      int tile = tileRow * tileCols + tileCol;
+      long long growth = bandGrowth[band];
+      changedTiles[tile] =
+          activeTiles[tile] &&
+          (this->*stepTile)(tileRow, tileCol, sums, band) != 0;
+      tilePopulation[tile] += int(bandGrowth[band] - growth);
+      evaluated += activeTiles[tile] * tileHeight(tileRow) * tileWidth(tileCol);
+    }
+  }
+  LIFE_PROFILE_COUNT(kCellsEvaluated, evaluated);
+  bandTimes[band] =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+bool LifeStepper::step() {
+  LIFE_PROFILE_SCOPE(kPhaseStep);
+  if (pool) {
+    pool->run(numThreads, [this](int band) { stepBand(band); });
+  } else {
+    stepBand(0);
+  }
+  swap(current, next);
+  ++generationCount;
+  for (long long growth : bandGrowth) {
+    livePopulation += growth;
+  }
+  if (bandChanges.size() == 1) {
+    changes.swap(bandChanges[0]);
+  } else {
+    changes.clear();
+    for (const auto &bandChanged : bandChanges) {
+      changes.insert(changes.end(), bandChanged.begin(), bandChanged.end());
+    }
+    LIFE_PROFILE_COUNT(kBytesCopied,
+                       (long long)(changes.size() * sizeof(CellUpdate)));
+  }
+  if (recordChanges)
+    LIFE_PROFILE_COUNT(kCellsChanged, (long long)changes.size());
+
+  // the tiles to visit next time are the ones that changed and their
+  // neighbors, which on a torus wrap around the edges; the board is stable
+  // once there are none
+  bool changed = false;
+  for (int tileRow = 0; tileRow < tileRows; ++tileRow) {
+    for (int tileCol = 0; tileCol < tileCols; ++tileCol) {
+      bool active = false;
+      for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+          int y = tileRow + dy;
+          int x = tileCol + dx;
+          if (torus) {
+            y = (y + tileRows) % tileRows;
+            x = (x + tileCols) % tileCols;
+          } else if (y < 0 || y >= tileRows || x < 0 || x >= tileCols) {
+            continue;
+          }
+          active |= changedTiles[y * tileCols + x] != 0;
+        }
+      }
+      activeTiles[tileRow * tileCols + tileCol] = active;
+      changed |= active;
+    }
+  }
+  return changed;
+}
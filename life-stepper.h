@@ -0,0 +1,153 @@
+/**
+ * File: life-stepper.h
+ * --------------------
+ * Defines the dense stepping engine that advances a Game of Life board from
+ * one generation to the next, storing one int age per cell. The cells are
+ * stored tile by tile rather than row by row, so the rows a tile is stepped
+ * from stay in cache however wide the board is.
+ */
+
+#pragma once
+#include "grid.h"        // for Grid
+#include "life-engine.h" // for LifeEngine
+#include <algorithm>     // for std::min
+#include <cstdint>       // for uint8_t
+#include <memory>        // for std::unique_ptr
+#include <vector>        // for std::vector
+
+class LifeThreadPool;
+
+class LifeStepper : public LifeEngine {
+public:
+  /**
+   * Constructs an empty stepper. Call load before stepping.
+   */
+  LifeStepper();
+  ~LifeStepper();
+
+  /**
+   * Copies the given grid of ages into the stepper. Both generation buffers
+   * are sized here, so this is the only place the stepper allocates.
+   */
+  void load(const Grid<int> &grid) override;
+  void loadPattern(const PackedPattern &pattern) override;
+  void loadSnapshot(const SnapshotView &snapshot) override;
+
+  /**
+   * Advances the board by one generation by computing the next generation
+   * into the back buffer and swapping it to the front. Returns true if the
+   * new generation is different from the previous one, false if the board
+   * is stable.
+   */
+  bool step() override;
+
+  /**
+   * Kills every cell on the board, keeping its dimensions.
+   */
+  void clear() override;
+
+  int numRows() const override { return rows; }
+  int numCols() const override { return cols; }
+
+  int ageAt(int row, int col) const override {
+    return current[cellIndex(row, col)];
+  }
+
+  void exportGrid(Grid<int> &grid) const override;
+
+  /**
+   * The population is kept up to date by step itself, so this is free.
+   */
+  long long population() const override { return livePopulation; }
+
+  /**
+   * Counts a tile at a time from the live cells kept for each tile as it
+   * steps: tiles with none are skipped, and a tile that lies inside a
+   * single block adds its count without visiting its cells.
+   */
+  void countBlocks(const BoardView &view,
+                   std::vector<int> &counts) const override;
+
+  bool setTorus(bool torus) override;
+  void setRule(const LifeRule &rule) override;
+
+  /**
+   * Sets the number of threads used to step the board. With more than one
+   * thread the board is split into that many bands of rows, which are
+   * stepped in parallel on a pool of threads kept alive between generations.
+   */
+  void setThreadCount(int numThreads);
+  int threadCount() const { return numThreads; }
+
+  /**
+   * Returns how long each band of rows took to step in the last generation,
+   * in seconds, indexed from the top band down. Uneven times mean the live
+   * cells are unevenly spread over the board.
+   */
+  const std::vector<double> &bandSeconds() const { return bandTimes; }
+
+  /**
+   * Returns the number of tiles the next step will evaluate. Tiles that
+   * neither changed nor border a tile that changed are skipped.
+   */
+  int activeTileCount() const;
+
+private:
+  static const int kTileSize = 64; // tiles are kTileSize x kTileSize cells
+  // each tile is stored as its own block of rows, with a ring of halo cells
+  static const int kTileStride = kTileSize + 2;
+  static const int kTileCells = kTileStride * kTileStride;
+
+  int rows;
+  int cols;
+  int tileRows;
+  int tileCols;
+  bool torus;
+  std::vector<int> current; // the generation being displayed, tile by tile
+  std::vector<int> next;    // scratch buffer the next generation is built in
+  std::vector<int> columnSums; // per band, live cells per column of a tile
+                               // in a three-row window, halo included
+  int numThreads;
+  std::unique_ptr<LifeThreadPool> pool;
+  std::vector<double> bandTimes;
+  std::vector<std::vector<CellUpdate>> bandChanges; // per band change lists
+  std::vector<long long> bandGrowth; // per band births minus deaths
+  long long livePopulation;
+  std::vector<uint8_t> activeTiles;  // tiles to evaluate in the next step
+  std::vector<uint8_t> changedTiles; // tiles that changed in the last step
+  std::vector<int> tilePopulation;   // live cells in each tile
+
+  // the kernels stepping one tile, instantiated for the current rule,
+  // without and with recording the change list
+  typedef int (LifeStepper::*TileStepper)(int tileRow, int tileCol, int *sums,
+                                          int band);
+  TileStepper stepTileFor[2];
+
+  int tileIndex(int tileRow, int tileCol) const {
+    return (tileRow * tileCols + tileCol) * kTileCells;
+  }
+  int cellIndex(int row, int col) const {
+    return tileIndex(row / kTileSize, col / kTileSize) +
+           (row % kTileSize + 1) * kTileStride + col % kTileSize + 1;
+  }
+  int tileHeight(int tileRow) const {
+    return std::min(int(kTileSize), rows - tileRow * kTileSize);
+  }
+  int tileWidth(int tileCol) const {
+    return std::min(int(kTileSize), cols - tileCol * kTileSize);
+  }
+  void resize(int numRows, int numCols);
+  void countTilePopulations();
+  void fillTileHalo(int tileRow, int tileCol);
+  void clearHalo();
+  void selectKernels();
+  template <typename Rule, bool Record>
+  int stepRow(const Rule &rule, const int *mid, int *out, int width, int row,
+              int firstCol, int *sums, int band);
+  template <typename Rule, bool Record>
+  int stepTile(int tileRow, int tileCol, int *sums, int band);
+  void stepBand(int band);
+
+  LifeStepper(const LifeStepper &original);
+  void operator=(const LifeStepper &rhs) const;
+};
@@ -0,0 +1,78 @@
+/**
+ * File: life-thread-pool.cpp
+ * --------------------------
+ * Implements the persistent worker pool. Each batch hands out task indices
+ * through an atomic counter, so threads that finish their tasks early pick
+ * up the remaining ones.
+ */
+
+using namespace std;
+
+#include "life-thread-pool.h"
+
+LifeThreadPool::LifeThreadPool(int numThreads)
+    : currentTask(nullptr), taskCount(0), nextTask(0), batch(0),
+      busyWorkers(0), stopping(false) {
+  for (int i = 1; i < numThreads; ++i) {
+    workers.emplace_back([this] { workerLoop(); });
+  }
+}
+
+LifeThreadPool::~LifeThreadPool() {
+  {
+    lock_guard<mutex> guard(lock);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+void LifeThreadPool::drainTasks() {
+  for (int i = nextTask++; i < taskCount; i = nextTask++) {
+    (*currentTask)(i);
+  }
+}
+
+void LifeThreadPool::run(int numTasks, const function<void(int)> &task) {
+  if (workers.empty()) {
+    for (int i = 0; i < numTasks; ++i) {
+      task(i);
+    }
+    return;
+  }
+  {
+    lock_guard<mutex> guard(lock);
+    currentTask = &task;
+    taskCount = numTasks;
+    nextTask = 0;
+    busyWorkers = int(workers.size());
+    ++batch;
+  }
+  wake.notify_all();
+  drainTasks();
+
+  unique_lock<mutex> guard(lock);
+  finished.wait(guard, [this] { return busyWorkers == 0; });
+  currentTask = nullptr;
+}
+
+void LifeThreadPool::workerLoop() {
+  int seenBatch = 0;
+  while (true) {
+    {
+      unique_lock<mutex> guard(lock);
+      wake.wait(guard, [&] { return stopping || batch != seenBatch; });
+      if (stopping)
+        return;
+      seenBatch = batch;
+    }
+    drainTasks();
+    {
+      lock_guard<mutex> guard(lock);
+      if (--busyWorkers == 0)
+        finished.notify_one();
+    }
+  }
+}
@@ -0,0 +1,56 @@
+/**
+ * File: life-thread-pool.h
+ * ------------------------
+ * Defines a small pool of persistent worker threads. The threads are created
+ * once and then reused for every batch of work, so callers that run a batch
+ * per generation never pay for starting or joining threads.
+ */
+
+#pragma once
+#include <atomic>             // for std::atomic
+#include <condition_variable> // for std::condition_variable
+#include <functional>         // for std::function
+#include <mutex>              // for std::mutex
+#include <thread>             // for std::thread
+#include <vector>             // for std::vector
+
+class LifeThreadPool {
+public:
+  /**
+   * Starts a pool that runs work on numThreads threads, counting the thread
+   * that calls run. A pool of one thread runs everything on the caller.
+   */
+  explicit LifeThreadPool(int numThreads);
+
+  /**
+   * Stops and joins the worker threads.
+   */
+  ~LifeThreadPool();
+
+  int numThreads() const { return int(workers.size()) + 1; }
+
+  /**
+   * Calls task(i) once for every i in [0, numTasks), spreading the calls
+   * over the pool, and returns once they have all finished. The calling
+   * thread works through tasks too, so the return acts as a barrier.
+   */
+  void run(int numTasks, const std::function<void(int)> &task);
+
+private:
+  std::vector<std::thread> workers;
+  std::mutex lock;
+  std::condition_variable wake;     // signalled when a batch starts or on stop
+  std::condition_variable finished; // signalled when the last worker is done
+  const std::function<void(int)> *currentTask;
+  int taskCount;
+  std::atomic<int> nextTask;
+  int batch;       // incremented for every batch so workers notice new work
+  int busyWorkers; // workers still inside the current batch
+  bool stopping;
+
+  void workerLoop();
+  void drainTasks();
+
+  LifeThreadPool(const LifeThreadPool &original);
+  void operator=(const LifeThreadPool &rhs) const;
+};
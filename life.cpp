@@ -4,25 +4,39 @@
  * Implements the Game of Life.
  */
 
-#include <cassert> // assert the condition
-#include <fstream>
-#include <iostream> // for cout
-#include <random>   // for random utilities
+#include <QCoreApplication> // for QCoreApplication::arguments
+#include <cassert>          // assert the condition
+#include <cctype>           // for isdigit
+#include <chrono>           // for steady_clock
+#include <iostream>         // for cout
+#include <memory>           // for unique_ptr
+#include <random>           // for random utilities
+#include <sstream>          // for istringstream
+#include <vector>           // for vector
 using namespace std;
 
 #include "console.h" // required of all files that contain the main function
-#include "gevent.h"  // for mouse event detection
+#include "error.h"   // for ErrorException
+#include "gevent.h"  // for mouse and key event detection
 #include "gtimer.h"
 #include "simpio.h" // for getLine
 #include "strlib.h"
 
-#include "life-constants.h" // for kMaxAge
-#include "life-graphics.h"  // for class LifeDisplay
+#include "life-constants.h"  // for kMaxAge, BoardView
+#include "life-cycle.h"      // for class CycleDetector
+#include "life-engine.h"     // for class LifeEngine, createEngine
+#include "life-formats.h"    // for loadPatternFile, savePatternFile
+#include "life-graphics.h"   // for class LifeDisplay
+#include "life-headless.h"   // for isHeadlessRun, runHeadless
+#include "life-patterns.h"   // for counterRandom, generateRandomPattern
+#include "life-profile.h"    // for LIFE_PROFILE_SCOPE
+#include "life-rules.h"      // for parseRule, ruleString
+#include "life-simulation.h" // for class LifeSimulation, followView
 
 static constexpr int kLowerBound = 40;
 static constexpr int kUpperBound = 60;
-
-enum CellState : int { Empty = 0, Occupied = 1 };
+static constexpr int kDisplayMs = 33; // the animation shows ~30 frames a second
+static const char *const kWindowTitle = "Game of Life";
 
 /**
  * Function: welcome
@@ -45,212 +59,496 @@ static void welcome() {
   getLine("Hit [enter] to continue....   ");
 }
 
-static Grid<int> generateRandomGrid() {
-  // Initialize the random generator
-  std::random_device rd;  // a seed source for the random number engine
-  std::mt19937 gen(rd()); // mersenne_twister_engine seeded with rd()
-  std::uniform_int_distribution<> distrib(kLowerBound, kUpperBound);
-  // Generate random height and width
-  int width = distrib(gen);
-  int height = distrib(gen);
-
-  Grid<int> grid(height, width);
-  // Mark each Cell with either empty or occupied
-  // random generator to flip either empty or occupied
-  std::uniform_int_distribution<> boolGen(0, 1);
-  // age generator between 1 and kMaxAge
-  std::uniform_int_distribution<> ageGen(1, kMaxAge);
-  for (auto &cell : grid) {
-    cell = boolGen(gen) == 1 ? ageGen(gen) : CellState::Empty;
-  }
-  return grid;
-}
-
-static Grid<int> readGridFromFile(const std::string &filename) {
-  std::ifstream file(filename);
-  if (!file) {
-    cerr << "Can not open file " << filename << endl;
-    exit(1);
-  }
-  std::string line;
-  int height;
-  int width;
-
-  while (true) {
-    std::getline(file, line);
-    if (line[0] == '#')
-      continue;
-    height = stringToInteger(line);
-    std::getline(file, line);
-    width = stringToInteger(line);
-    break;
-  }
-
-  Grid<int> grid(height, width);
-  for (int row = 0; row < grid.numRows(); ++row) {
-    std::getline(file, line);
-    for (int col = 0; col < grid.numCols(); ++col) {
-      grid[row][col] =
-          line[col] == 'X' ? CellState::Occupied : CellState::Empty;
-    }
-  }
-  return grid;
+/**
+ * Function: randomBoardForSeed
+ * -----------------
+ * Returns the random board for the given seed: its height, its width and
+ * every cell come from the seed alone, so the same seed always gives the
+ * same board.
+ */
+static PackedPattern randomBoardForSeed(uint64_t seed) {
+  int range = kUpperBound - kLowerBound + 1;
+  int width = kLowerBound + int(counterRandom(~seed, 0) % range);
+  int height = kLowerBound + int(counterRandom(~seed, 1) % range);
+  return generateRandomPattern(height, width, 0.5, seed);
 }
 
 static std::string getFileNameFromUser() {
   std::string filename;
-  cout << "Enter data file name for a grid ([enter] for random-generated "
-          "grid): ";
+  cout << "Enter data file name for a grid, in the res/files layout or as "
+          ".rle, .mc or .snap ([enter] for random-generated grid, random N "
+          "for the random grid with seed N): ";
   getline(cin, filename);
   return filename;
 }
 
-static Grid<int> newGridFromUser() {
-  Grid<int> grid;
+/**
+ * Function: loadGridFromUser
+ * -----------------
+ * Load the engine with the board the user picks. Pattern files go to the
+ * engine packed, so the board is only ever expanded by engines that need it.
+ */
+static void loadGridFromUser(LifeEngine &engine) {
   const std::string filename = getFileNameFromUser();
-  if (filename.empty()) {
-    grid = generateRandomGrid();
+  if (filename.empty() || startsWith(filename, "random ")) {
+    uint64_t seed = 0;
+    if (filename.empty()) {
+      std::random_device rd; // a seed source for a board never seen before
+      seed = uint64_t(rd()) << 32 | rd();
+    } else {
+      string digits = trim(filename.substr(7));
+      size_t used = 0;
+      try {
+        seed = stoull(digits, &used);
+      } catch (...) {
+      }
+      if (digits.empty() || used != digits.size() || !isdigit(digits[0])) {
+        cout << "The seed must be a whole number, quitting" << endl;
+        exit(1);
+      }
+    }
+    cout << "The random grid's seed is " << seed << endl;
+    engine.loadPattern(randomBoardForSeed(seed));
   } else {
-    grid = readGridFromFile(filename);
+    loadPatternFile(engine, filename);
   }
-  return grid;
 }
 
-static void drawGrid(LifeDisplay &disp, const Grid<int> &grid) {
-  for (int row = 0; row < grid.numRows(); ++row) {
-    for (int col = 0; col < grid.numCols(); ++col) {
-      disp.drawCellAt(row, col, grid[row][col]);
+static unique_ptr<LifeEngine> newEngineFromUser() {
+  std::string name;
+  cout << "Enter the engine to run the simulation with (dense, parallel, "
+          "packed, hashlife, sparse"
+#ifdef LIFE_HAVE_OPENCL
+          ", gpu"
+#endif
+          ", reference, auto, [enter] for dense): ";
+  getline(cin, name);
+  unique_ptr<LifeEngine> engine = createEngine(name);
+  if (!engine) {
+    cout << "The engine is not supported, quitting" << endl;
+    exit(1);
+  }
+  cout << "Enter torus to wrap the board around its edges ([enter] for a "
+          "dead border): ";
+  std::string boundary;
+  getline(cin, boundary);
+  if (boundary == "torus") {
+    if (!engine->setTorus(true))
+      cout << "The engine can not wrap around, using a dead border" << endl;
+  } else if (!boundary.empty()) {
+    cout << "The option is not supported, quitting" << endl;
+    exit(1);
+  }
+  cout << "Enter the rule in B/S notation, such as B36/S23 for HighLife "
+          "([enter] for B3/S23): ";
+  std::string rule;
+  getline(cin, rule);
+  if (!rule.empty()) {
+    try {
+      engine->setRule(parseRule(rule));
+    } catch (const ErrorException &ex) {
+      cout << ex.getMessage() << ", quitting" << endl;
+      exit(1);
     }
   }
-  disp.printBoard();
-  // Clear and show the grid on the windows
-  disp.repaint();
+  engine->setRecordChanges(true);
+  return engine;
 }
 
-static int countNeighborCell(const Grid<int> &grid, int row, int col) {
-  int count = 0;
-  for (int drow = -1; drow <= 1; ++drow) {
-    for (int dcol = -1; dcol <= 1; ++dcol) {
-      if (drow == 0 && dcol == 0)
-        continue;
-      int y = row + drow;
-      int x = col + dcol;
-      if (grid.inBounds(y, x) && grid[y][x] > 0)
-        count++;
-    }
+/**
+ * Function: setConsoleFromUser
+ * -----------------
+ * Ask whether the board should also be printed to the console, how often,
+ * and which part of it.
+ */
+static void setConsoleFromUser(LifeDisplay &disp) {
+  cout << "Enter a number N to also print the board to the console every N "
+          "generations ([enter] to keep the console quiet): ";
+  std::string line;
+  getline(cin, line);
+  if (line.empty())
+    return;
+  if (!stringIsInteger(line) || stringToInteger(line) <= 0) {
+    cout << "The option is not supported, quitting" << endl;
+    exit(1);
+  }
+  disp.setConsoleOutput(true, stringToInteger(line));
+  cout << "Enter the top row, left column, rows and columns of the part to "
+          "print ([enter] for the whole board): ";
+  getline(cin, line);
+  if (line.empty())
+    return;
+  istringstream fields(line);
+  int top, left, numRows, numCols;
+  string rest;
+  if (!(fields >> top >> left >> numRows >> numCols) || fields >> rest ||
+      top < 0 || left < 0 || numRows <= 0 || numCols <= 0) {
+    cout << "The viewport is not supported, quitting" << endl;
+    exit(1);
   }
-  return count;
+  disp.setConsoleViewport(top, left, numRows, numCols);
 }
 
-static Grid<int> cloneGrid(const Grid<int> &grid) {
-  Grid<int> newGrid(grid.numRows(), grid.numCols());
-  for (int row = 0; row < grid.numRows(); ++row) {
-    for (int col = 0; col < grid.numCols(); ++col) {
-      newGrid[row][col] = grid[row][col];
+/**
+ * Function: drawGrid
+ * -----------------
+ * Redraw everything in view: its cells, or when zoomed out the blocks the
+ * engine counts.
+ */
+static void drawGrid(LifeDisplay &disp, const LifeEngine &engine) {
+  const BoardView &view = disp.view();
+  if (view.blockSize > 1) {
+    vector<int> counts;
+    engine.countBlocks(view, counts);
+    disp.drawBlocks(counts);
+  } else {
+    vector<uint8_t> ages;
+    engine.exportView(view, ages);
+    vector<CellUpdate> updates;
+    updates.reserve(ages.size());
+    for (int row = 0; row < view.rows; ++row) {
+      for (int col = 0; col < view.cols; ++col) {
+        updates.push_back({view.top + row, view.left + col,
+                           ages[size_t(row) * view.cols + col]});
+      }
     }
+    disp.drawCells(updates);
   }
-  return newGrid;
+  disp.printGeneration(engine.generation());
+  // Clear and show the grid on the windows
+  disp.repaint();
 }
 
-static Grid<int> generateNextGenerationGrid(Grid<int> &grid) {
-  auto newGrid = cloneGrid(grid);
-  for (int row = 0; row < grid.numRows(); ++row) {
-    for (int col = 0; col < grid.numCols(); ++col) {
-      int numNeighborCell = countNeighborCell(grid, row, col);
-      if (numNeighborCell <= 1 || numNeighborCell > 3) {
-        // kill a cell if it is lonely or overcrowded
-        newGrid[row][col] = 0;
-      } else if (numNeighborCell == 2) {
-        // the cell remains
-        if (grid[row][col] > 0 && grid[row][col] < kMaxAge) {
-          newGrid[row][col] += 1;
-        }
-      } else {
-        // bear a new cell
-        if (grid[row][col] < kMaxAge)
-          newGrid[row][col] += 1;
+/**
+ * Function: drawChanges
+ * -----------------
+ * Redraw only the cells the engine reports as changed by its last step. A
+ * zoomed-out view has its blocks counted again instead.
+ */
+static void drawChanges(LifeDisplay &disp, const LifeEngine &engine) {
+  if (disp.view().blockSize > 1) {
+    drawGrid(disp, engine);
+    return;
+  }
+  disp.drawCells(engine.changedCells());
+  disp.printGeneration(engine.generation());
+  disp.repaint();
+}
+
+/**
+ * Function: drawFrame
+ * -----------------
+ * Redraw the view from a frame of the simulation thread. Cells already on
+ * screen in the same shade are skipped by the display. Return false,
+ * drawing nothing, if the frame was taken before the view last changed.
+ */
+static bool drawFrame(LifeDisplay &disp, const LifeFrame &frame) {
+  const BoardView &view = frame.view;
+  if (view != disp.view())
+    return false;
+  if (view.blockSize > 1) {
+    disp.drawBlocks(frame.counts);
+  } else {
+    LIFE_PROFILE_SCOPE(kPhaseDraw);
+    for (int row = 0; row < view.rows; ++row) {
+      for (int col = 0; col < view.cols; ++col) {
+        disp.drawCellAt(view.top + row, view.left + col,
+                        frame.ages[size_t(row) * view.cols + col]);
       }
     }
   }
-  return newGrid;
+  disp.printGeneration(frame.generation);
+  disp.repaint();
+  return true;
 }
 
-static bool isStableGrid(Grid<int> &currGrid, Grid<int> &newGrid) {
-  for (auto &cell : newGrid) {
-    if (cell > 0 && cell < kMaxAge) {
-      return false;
+/**
+ * Function: moveView
+ * -----------------
+ * Pan or zoom the display for a key pressed during the animation: the arrow
+ * keys pan by a quarter of the view, + and - zoom in and out around its
+ * center, and 0 shows the whole board again. Return true if the view was
+ * set again, which clears the canvas.
+ */
+static bool moveView(LifeDisplay &disp, const GEvent &ev) {
+  const BoardView &view = disp.view();
+  int rowStep = max(view.rows * view.blockSize / 4, 1);
+  int colStep = max(view.cols * view.blockSize / 4, 1);
+  int level = disp.zoomLevel();
+  int row = disp.centerRow();
+  int col = disp.centerColumn();
+  if (ev.getEventType() == KEY_PRESSED) {
+    int key = ev.getKeyCode();
+    if (key == GEvent::UP_ARROW_KEY) {
+      row -= rowStep;
+    } else if (key == GEvent::DOWN_ARROW_KEY) {
+      row += rowStep;
+    } else if (key == GEvent::LEFT_ARROW_KEY) {
+      col -= colStep;
+    } else if (key == GEvent::RIGHT_ARROW_KEY) {
+      col += colStep;
+    }
+  } else if (ev.getEventType() == KEY_TYPED) {
+    char key = ev.getKeyChar();
+    if (key == '+' || key == '=') {
+      ++level;
+    } else if (key == '-') {
+      --level;
+    } else if (key == '0') {
+      level = 0;
     }
   }
-  return currGrid == newGrid;
+  level = max(0, min(level, disp.maxZoom()));
+  if (level == disp.zoomLevel() && row == disp.centerRow() &&
+      col == disp.centerColumn())
+    return false;
+  disp.setZoom(level, row, col);
+  return true;
 }
 
 /**
  * Function: advanceGrid
  * -----------------
- * Advance the grid its next generation. Return false if the generation is
- * stable after advancing, true otherwise.
+ * Advance the grid by the given number of generations, one by default.
+ * Return false if the generation is stable or has entered a cycle after
+ * advancing, true otherwise.
  */
-static bool advanceGrid(LifeDisplay &disp, Grid<int> &grid) {
-  auto newGrid = generateNextGenerationGrid(grid);
-  bool canAdvance = !isStableGrid(grid, newGrid);
-  grid = newGrid;
-  drawGrid(disp, grid);
-  return canAdvance;
+static bool advanceGrid(LifeDisplay &disp, LifeEngine &engine,
+                        CycleDetector &cycles, long long generations = 1) {
+  bool wholeBoard = followView(engine, cycles, disp.view());
+  bool canAdvance = engine.stepBy(generations);
+  if (generations == 1) {
+    drawChanges(disp, engine);
+    if (wholeBoard)
+      cycles.update(engine.changedCells());
+  } else {
+    drawGrid(disp, engine);
+    cycles.reset(engine);
+  }
+  LIFE_PROFILE_END_GENERATION(engine.generation());
+  // a period of 1 is left to the engine, which also waits for ages to settle
+  return canAdvance && cycles.period() <= 1;
 }
 
-static void clearScreen(LifeDisplay &disp, Grid<int> &grid) {
-  for (auto &cell : grid) {
-    cell = 0;
+/**
+ * Function: reportEnd
+ * -----------------
+ * Tell the user why the simulation stopped by itself.
+ */
+static void reportEnd(const CycleDetector &cycles) {
+  if (cycles.period() > 1) {
+    cout << "The pattern repeats every " << cycles.period()
+         << " generations, stopping" << endl;
+  } else {
+    cout << "The grid is stable, stopping" << endl;
   }
-  drawGrid(disp, grid);
 }
 
+static void clearScreen(LifeDisplay &disp, LifeEngine &engine,
+                        CycleDetector &cycles) {
+  engine.clear();
+  cycles.reset(engine);
+  drawGrid(disp, engine);
+}
+
+/**
+ * Type: RateCounter
+ * -----------------
+ * Measures the generations per second the animation achieves, over windows
+ * of about a second so the number is steady enough to read.
+ */
+struct RateCounter {
+  chrono::steady_clock::time_point windowStart;
+  long long windowGeneration;
+
+  explicit RateCounter(long long generation)
+      : windowStart(chrono::steady_clock::now()),
+        windowGeneration(generation) {}
+
+  /**
+   * Returns the rate over the window that ends at the given generation
+   * once the window is a second long, starting the next one, or -1 if the
+   * window is still open.
+   */
+  double update(long long generation) {
+    auto now = chrono::steady_clock::now();
+    chrono::duration<double> elapsed = now - windowStart;
+    if (elapsed.count() < 1)
+      return -1;
+    double rate = (generation - windowGeneration) / elapsed.count();
+    windowStart = now;
+    windowGeneration = generation;
+    return rate;
+  }
+};
+
 /**
  * Function: runAnimation
  * -----------------
- * An event loop that constantly polls for 2 events: a mouse click on the
- * windows and timer. After the timer elapse, advancing the grid to the next
- * generation.
+ * Steps the grid on a simulation thread, one generation every ms
+ * milliseconds or flat out if ms is 0, while an event loop polls for 2
+ * events: a mouse click on the windows, which stops the simulation, and the
+ * display timer, which shows the latest generation the thread has finished.
+ * Keys pan and zoom the view meanwhile, see moveView.
+ * Generations that come faster than the display are skipped on screen but
+ * still simulated; with a positive generationsPerFrame each frame shows
+ * exactly that many generations later than the last. The window title
+ * shows the generations per second achieved.
  */
-static void runAnimation(LifeDisplay &disp, Grid<int> &grid, int ms) {
-  GTimer timer(ms);
+static void runAnimation(LifeDisplay &disp, LifeEngine &engine,
+                         CycleDetector &cycles, int ms,
+                         int generationsPerFrame = 0) {
+  cout << "Click the window to stop; use the arrow keys to pan, + and - to "
+          "zoom and 0 to see the whole board"
+       << endl;
+  RateCounter rate(engine.generation());
+  LifeSimulation simulation(engine, cycles);
+  simulation.setView(disp.view());
+  simulation.start(ms, generationsPerFrame);
+  GTimer timer(kDisplayMs);
   timer.start();
-  while (true) {
-    GEvent ev = waitForEvent(TIMER_EVENT + MOUSE_EVENT);
+  bool finished = false;
+  bool lastDrawn = true; // whether the last frame taken made it on screen
+  while (!finished) {
+    GEvent ev = waitForEvent(TIMER_EVENT + MOUSE_EVENT + KEY_EVENT);
     if (ev.getEventClass() == TIMER_EVENT) {
-      if (!advanceGrid(disp, grid))
-        break;
+      const LifeFrame *frame = simulation.latestFrame();
+      if (frame) {
+        double perSecond = rate.update(frame->generation);
+        if (perSecond >= 0)
+          disp.setTitle(string(kWindowTitle) + " - generation " +
+                        to_string(frame->generation) + ", " +
+                        to_string((long long)(perSecond + 0.5)) +
+                        " generations/sec");
+        lastDrawn = drawFrame(disp, *frame);
+        finished = frame->finished;
+      }
+    } else if (ev.getEventClass() == KEY_EVENT) {
+      if (moveView(disp, ev))
+        simulation.setView(disp.view());
     } else if (ev.getEventType() == MOUSE_PRESSED) {
       break;
     }
   }
   timer.stop();
+  simulation.stop();
+  disp.setTitle(kWindowTitle);
+  // the thread may have got ahead of the last frame shown, or the view may
+  // have changed after it
+  if (!finished || !lastDrawn)
+    drawGrid(disp, engine);
+  if (finished)
+    reportEnd(cycles);
 }
 
-static void runManualAnimation(LifeDisplay &disp, Grid<int> &grid) {
+/**
+ * Function: saveGrid
+ * -----------------
+ * Save the current generation to the named file, telling the user if it
+ * can not be written.
+ */
+static void saveGrid(const LifeEngine &engine, const string &filename) {
+  try {
+    savePatternFile(engine, filename);
+    cout << "Saved the grid to " << filename << endl;
+  } catch (const ErrorException &ex) {
+    cout << ex.getMessage() << endl;
+  }
+}
+
+/**
+ * Function: viewCommand
+ * -----------------
+ * Carry out a manual-mode command that moves the view: zoom in, zoom out,
+ * zoom fit, or center and a row and column. Return false if the line is no
+ * such command.
+ */
+static bool viewCommand(LifeDisplay &disp, const string &line) {
+  istringstream fields(line);
+  string command, rest;
+  fields >> command;
+  if (command == "zoom") {
+    string how;
+    fields >> how;
+    if (fields >> rest)
+      return false;
+    if (how == "in") {
+      disp.setZoom(disp.zoomLevel() + 1, disp.centerRow(), disp.centerColumn());
+    } else if (how == "out") {
+      disp.setZoom(disp.zoomLevel() - 1, disp.centerRow(), disp.centerColumn());
+    } else if (how == "fit") {
+      disp.setZoom(0, disp.centerRow(), disp.centerColumn());
+    } else {
+      return false;
+    }
+    return true;
+  } else if (command == "center") {
+    int row, col;
+    if (!(fields >> row >> col) || fields >> rest)
+      return false;
+    disp.setZoom(disp.zoomLevel(), row, col);
+    return true;
+  }
+  return false;
+}
+
+static void runManualAnimation(LifeDisplay &disp, LifeEngine &engine,
+                               CycleDetector &cycles) {
   string line;
   while (true) {
-    cout << "Press enter to advance the grid, type quit to stop the "
-            "simulation: ";
+    cout << "Press enter to advance the grid, type a number of generations "
+            "to jump ahead, save and a .snap, .rle or .mc file name to save "
+            "the grid, zoom in, zoom out, zoom fit or center ROW COL to move "
+            "the view, type quit to stop the simulation: ";
     getline(cin, line);
+    if (startsWith(line, "save ")) {
+      saveGrid(engine, trim(line.substr(5)));
+      continue;
+    }
+    if (viewCommand(disp, line)) {
+      drawGrid(disp, engine);
+      continue;
+    }
     bool isEnter = line.empty();
-    bool cond = isEnter && !advanceGrid(disp, grid);
-    if (cond || line == "quit") {
+    bool isJump = stringIsInteger(line) && stringToInteger(line) > 0;
+    if (line == "quit") {
       break;
-    } else if (!isEnter) {
+    } else if (!isEnter && !isJump) {
       cout << "Command not support, quitting" << endl;
       exit(0);
+    } else if (!advanceGrid(disp, engine, cycles,
+                            isJump ? stringToInteger(line) : 1)) {
+      reportEnd(cycles);
+      break;
     }
   }
 }
 
-static void initializeGridAndDisplay(LifeDisplay &disp, Grid<int> &grid) {
-  grid = newGridFromUser();
-  cout << "Grid's width is " << grid.numRows() << endl;
-  cout << "Grid's height is " << grid.numCols() << endl;
-  disp.setDimensions(grid.numRows(), grid.numCols());
+static void initializeGridAndDisplay(LifeDisplay &disp, LifeEngine &engine,
+                                     CycleDetector &cycles) {
+  loadGridFromUser(engine);
+  cout << "Grid's width is " << engine.numRows() << endl;
+  cout << "Grid's height is " << engine.numCols() << endl;
+  cout << "The rule is " << ruleString(engine.rule()) << endl;
+  cycles.reset(engine);
+  disp.setDimensions(engine.numRows(), engine.numCols());
   //  Write the grid out of the console and draw the grid
-  drawGrid(disp, grid);
+  drawGrid(disp, engine);
+}
+
+/**
+ * Function: commandLineArguments
+ * ------------------------------
+ * Returns the arguments the program was started with, without the program
+ * name. The library wrapper owns the real argv, so they come from Qt.
+ */
+static vector<string> commandLineArguments() {
+  vector<string> args;
+  const auto arguments = QCoreApplication::arguments();
+  for (int i = 1; i < int(arguments.size()); ++i) {
+    args.push_back(arguments[i].toStdString());
+  }
+  return args;
 }
 
 /**
@@ -259,11 +557,17 @@ static void initializeGridAndDisplay(LifeDisplay &disp, Grid<int> &grid) {
  * Provides the entry point of the entire program.
  */
 int main() {
+  vector<string> args = commandLineArguments();
+  if (isHeadlessRun(args))
+    return runHeadless(args);
+
   LifeDisplay display;
-  display.setTitle("Game of Life");
+  display.setTitle(kWindowTitle);
   welcome();
-  Grid<int> currGrid;
-  initializeGridAndDisplay(display, currGrid);
+  unique_ptr<LifeEngine> engine = newEngineFromUser();
+  setConsoleFromUser(display);
+  CycleDetector cycles;
+  initializeGridAndDisplay(display, *engine, cycles);
 
   // The loop of the simulation
   string line;
@@ -272,14 +576,18 @@ int main() {
             "automatically: ";
     getline(cin, line);
     if (line == "manual") {
-      runManualAnimation(display, currGrid);
+      runManualAnimation(display, *engine, cycles);
     } else {
       int speed = 0;
+      int generationsPerFrame = 0;
       cout << "Enter the simulation speed: " << endl;
       cout << "1. slow" << endl;
       cout << "2. medium" << endl;
       cout << "3. fast" << endl;
-      cout << "Pick either 1, 2, or 3 to choose the simulation speed: ";
+      cout << "4. max speed, showing the latest generation each frame"
+           << endl;
+      cout << "5. a fixed number of generations per frame" << endl;
+      cout << "Pick either 1, 2, 3, 4 or 5 to choose the simulation speed: ";
       getline(cin, line);
       if (line == "1") {
         speed = 1000;
@@ -287,19 +595,34 @@ int main() {
         speed = 500;
       } else if (line == "3") {
         speed = 100;
+      } else if (line == "4") {
+        speed = 0;
+      } else if (line == "5") {
+        cout << "Enter the number of generations per frame: ";
+        getline(cin, line);
+        if (!stringIsInteger(line) || stringToInteger(line) <= 0) {
+          cout << "The option is not supported, quitting" << endl;
+          exit(1);
+        }
+        generationsPerFrame = stringToInteger(line);
       } else {
         cout << "The option is not supported, quitting" << endl;
         exit(1);
       }
-      runAnimation(display, currGrid, speed);
+      runAnimation(display, *engine, cycles, speed, generationsPerFrame);
     }
 
-    clearScreen(display, currGrid);
+    cout << "Enter a .snap, .rle or .mc file name to save the grid before "
+            "it is cleared ([enter] to skip): ";
+    getline(cin, line);
+    if (!line.empty())
+      saveGrid(*engine, line);
+    clearScreen(display, *engine, cycles);
     cout << "Press enter to start a new simulation, type quit to stop the "
             "simulation: ";
     getline(cin, line);
     if (line.empty()) {
-      initializeGridAndDisplay(display, currGrid);
+      initializeGridAndDisplay(display, *engine, cycles);
       continue;
     } else if (line == "quit") {
       break;